@@ -142,3 +142,11 @@ float FastAligner::GetBackwardProbability(wid_t source, wid_t target) {
     return (float) backwardModel->GetProbability(target, source);
 }
 
+bool FastAligner::ExportLexicalTables(LexicalTable &outForward, LexicalTable &outBackward) {
+    // backward model rows are already indexed by target word
+    forwardModel->Export(outForward);
+    backwardModel->Export(outBackward);
+
+    return true;
+}
+
@@ -56,6 +56,8 @@ namespace mmt {
                 return GetForwardProbability(kAlignerNullWord, target);
             };
 
+            virtual bool ExportLexicalTables(LexicalTable &outForward, LexicalTable &outBackward) override;
+
             virtual ~FastAligner() override;
 
         private:
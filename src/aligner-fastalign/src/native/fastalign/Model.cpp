@@ -2,6 +2,7 @@
 // Created by Davide  Caroselli on 23/08/16.
 //
 
+#include <algorithm>
 #include <mmt/aligner/Aligner.h>
 #include "Model.h"
 #include "DiagonalAlignment.h"
@@ -113,6 +114,22 @@ void Model::Prune(double threshold) {
     }
 }
 
+void Model::Export(LexicalTable &outTable) const {
+    outTable = LexicalTable((float) kNullProbability);
+
+    vector<pair<wid_t, double>> entries;
+
+    for (wid_t row = 0; row < translation_table.size(); ++row) {
+        const unordered_map<wid_t, double> &cells = translation_table[row];
+
+        entries.assign(cells.begin(), cells.end());
+        sort(entries.begin(), entries.end());
+
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+            outTable.AppendEntry(row, entry->first, (float) entry->second);
+    }
+}
+
 double Model::ComputeAlignments(const vector<pair<vector<wid_t>, vector<wid_t>>> &batch, ttable_t *outTable,
                                 vector<alignment_t> *outAlignments) {
     double emp_feat = 0.0;
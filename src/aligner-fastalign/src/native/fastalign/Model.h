@@ -11,6 +11,7 @@
 #include <vector>
 #include <unordered_map>
 #include <mmt/sentence.h>
+#include <mmt/aligner/LexicalTable.h>
 
 using namespace std;
 
@@ -53,6 +54,8 @@ namespace mmt {
 
             void Prune(double threshold = 1e-20);
 
+            void Export(LexicalTable &outTable) const;
+
         private:
             ttable_t translation_table;
 
@@ -0,0 +1,106 @@
+//
+// Created by Davide  Caroselli on 22/06/17.
+//
+
+#ifndef MMT_DOMAINTOMBSTONES_H
+#define MMT_DOMAINTOMBSTONES_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <mmt/sentence.h>
+
+namespace mmt {
+
+    // Set of the deleted domains, shared by the readers and the compaction filter
+    // of the ILM and SAPT storages.
+    //
+    // Domain ids are dense, so they are stored in a bitset of atomic words: lookups are
+    // lock-free and deletions only set bits, so the memory never exceeds the size of the
+    // bitset (2 MB), however many deletions are received. The bitset is split in chunks
+    // allocated on first use. The few ids exceeding kMaxDenseDomain are stored in a sorted
+    // vector instead: every update publishes a new copy and the old one is released as
+    // soon as its last reader is done with it.
+    class DomainTombstones {
+    public:
+        DomainTombstones() : sparse(std::make_shared<const std::vector<domain_t>>()) {
+            for (size_t i = 0; i < kChunkCount; ++i)
+                chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~DomainTombstones() {
+            for (size_t i = 0; i < kChunkCount; ++i)
+                delete[] chunks[i].load(std::memory_order_relaxed);
+        }
+
+        inline bool Contains(domain_t domain) const {
+            if (domain < kMaxDenseDomain) {
+                const std::atomic<uint64_t> *chunk = chunks[domain >> kChunkShift].load(std::memory_order_acquire);
+                if (chunk == nullptr)
+                    return false;
+
+                size_t bit = domain & (kChunkBits - 1);
+                return ((chunk[bit >> 6].load(std::memory_order_acquire) >> (bit & 63)) & 1) != 0;
+            } else {
+                std::shared_ptr<const std::vector<domain_t>> version = std::atomic_load(&sparse);
+                return std::binary_search(version->begin(), version->end(), domain);
+            }
+        }
+
+        void Add(const std::vector<domain_t> &domains) {
+            if (domains.empty())
+                return;
+
+            std::lock_guard<std::mutex> lock(access);
+
+            std::vector<domain_t> *sparseVersion = nullptr;
+
+            for (auto domain = domains.begin(); domain != domains.end(); ++domain) {
+                if (*domain < kMaxDenseDomain) {
+                    std::atomic<uint64_t> *chunk = chunks[*domain >> kChunkShift].load(std::memory_order_relaxed);
+
+                    if (chunk == nullptr) {
+                        chunk = new std::atomic<uint64_t>[kChunkWords];
+                        for (size_t i = 0; i < kChunkWords; ++i)
+                            chunk[i].store(0, std::memory_order_relaxed);
+
+                        chunks[*domain >> kChunkShift].store(chunk, std::memory_order_release);
+                    }
+
+                    size_t bit = *domain & (kChunkBits - 1);
+                    chunk[bit >> 6].fetch_or(1ULL << (bit & 63), std::memory_order_release);
+                } else {
+                    if (sparseVersion == nullptr)
+                        sparseVersion = new std::vector<domain_t>(*std::atomic_load(&sparse));
+
+                    sparseVersion->push_back(*domain);
+                }
+            }
+
+            if (sparseVersion) {
+                std::sort(sparseVersion->begin(), sparseVersion->end());
+                sparseVersion->erase(std::unique(sparseVersion->begin(), sparseVersion->end()),
+                                     sparseVersion->end());
+
+                std::atomic_store(&sparse, std::shared_ptr<const std::vector<domain_t>>(sparseVersion));
+            }
+        }
+
+    private:
+        static const domain_t kMaxDenseDomain = 1 << 24;
+        static const size_t kChunkShift = 16;
+        static const size_t kChunkBits = 1 << kChunkShift;
+        static const size_t kChunkWords = kChunkBits / 64;
+        static const size_t kChunkCount = kMaxDenseDomain >> kChunkShift;
+
+        std::atomic<std::atomic<uint64_t> *> chunks[kChunkCount];
+        std::shared_ptr<const std::vector<domain_t>> sparse;
+
+        std::mutex access;
+    };
+
+}
+
+#endif //MMT_DOMAINTOMBSTONES_H
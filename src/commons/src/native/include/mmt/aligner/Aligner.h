@@ -6,6 +6,7 @@
 #define MMT_COMMON_INTERFACES_ALIGNER_H
 
 #include <mmt/sentence.h>
+#include "LexicalTable.h"
 
 namespace mmt {
 
@@ -55,6 +56,14 @@ namespace mmt {
         // P(NULL | target)
         virtual float GetTargetNullProbability(wid_t target) = 0;
 
+        // Exports a snapshot of the lexical probabilities: rows of "outForward" are
+        // source words (P(target | source)), rows of "outBackward" are target words
+        // (P(source | target)); NULL probabilities use kAlignerNullWord as row or column.
+        // Returns false if the aligner does not support the export.
+        virtual bool ExportLexicalTables(LexicalTable &outForward, LexicalTable &outBackward) {
+            return false;
+        }
+
         virtual ~Aligner() {};
 
     };
@@ -0,0 +1,56 @@
+//
+// Created by Davide  Caroselli on 14/06/17.
+//
+
+#ifndef MMT_COMMON_INTERFACES_LEXICALTABLE_H
+#define MMT_COMMON_INTERFACES_LEXICALTABLE_H
+
+#include <algorithm>
+#include <mmt/sentence.h>
+
+namespace mmt {
+
+    // Immutable snapshot of a lexical translation table stored in a flat layout:
+    // the entries of row "w" are in [offsets[w], offsets[w + 1]), sorted by column word.
+    class LexicalTable {
+    public:
+        LexicalTable(float defaultProbability = 0.f) : defaultProbability(defaultProbability) {};
+
+        // Rows must be appended in increasing order with columns already sorted
+        void AppendEntry(wid_t row, wid_t column, float probability) {
+            if (offsets.empty())
+                offsets.push_back(0);
+            while (offsets.size() <= (size_t) row + 1)
+                offsets.push_back(columns.size());
+
+            columns.push_back(column);
+            probabilities.push_back(probability);
+            offsets.back() = columns.size();
+        }
+
+        inline float Get(wid_t row, wid_t column) const {
+            if ((size_t) row + 1 >= offsets.size())
+                return defaultProbability;
+
+            const wid_t *begin = columns.data() + offsets[row];
+            const wid_t *end = columns.data() + offsets[row + 1];
+            const wid_t *entry = std::lower_bound(begin, end, column);
+
+            return (entry != end && *entry == column) ? probabilities[entry - columns.data()] : defaultProbability;
+        }
+
+        bool empty() const {
+            return columns.empty();
+        }
+
+    private:
+        float defaultProbability;
+
+        std::vector<size_t> offsets;
+        std::vector<wid_t> columns;
+        std::vector<float> probabilities;
+    };
+
+}
+
+#endif //MMT_COMMON_INTERFACES_LEXICALTABLE_H
@@ -0,0 +1,75 @@
+//
+// Created by Davide  Caroselli on 21/06/17.
+//
+
+#ifndef MMT_IO_SORTEDRUN_H
+#define MMT_IO_SORTEDRUN_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+
+namespace mmt {
+
+    // Sorted runs are files of key-value pairs sorted by key (bytewise, like the
+    // rocksdb default comparator); they are the intermediate format of the bulk
+    // loaders, that sort data larger than memory with an external merge sort.
+
+    class SortedRunWriter {
+    public:
+        SortedRunWriter(const std::string &path);
+
+        // Keys must be appended in ascending order; I/O errors are thrown as runtime_error
+        void Append(const std::string &key, const std::string &value);
+
+        // Must be called to check that the whole run has been written
+        void Close();
+
+    private:
+        const std::string path;
+        std::ofstream output;
+    };
+
+    class SortedRunReader {
+    public:
+        SortedRunReader(const std::string &path);
+
+        // Returns false at the end of the run, throws runtime_error if the run is truncated
+        bool Next(std::string *outKey, std::string *outValue);
+
+    private:
+        const std::string path;
+        std::ifstream input;
+    };
+
+    // Merges the content of "value" into "existing", both values of "key"
+    typedef std::function<void(const std::string &key, std::string &existing, const std::string &value)> run_merge_t;
+
+    // Reads a set of sorted runs as a single sorted sequence,
+    // values with the same key are combined with "merge"
+    class SortedRunMerger {
+    public:
+        SortedRunMerger(const std::vector<std::string> &paths, run_merge_t merge);
+
+        ~SortedRunMerger();
+
+        bool Next(std::string *outKey, std::string *outValue);
+
+    private:
+        struct head_t {
+            SortedRunReader *reader;
+            std::string key;
+            std::string value;
+        };
+
+        run_merge_t merge;
+        std::vector<head_t> heads;
+        std::vector<size_t> heap; // min-heap of the heads not yet exhausted
+
+        bool Pop(std::string *outKey, std::string *outValue);
+    };
+
+}
+
+#endif //MMT_IO_SORTEDRUN_H
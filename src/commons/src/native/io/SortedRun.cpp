@@ -0,0 +1,146 @@
+//
+// Created by Davide  Caroselli on 21/06/17.
+//
+
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <mmt/io/SortedRun.h>
+
+using namespace std;
+using namespace mmt;
+
+// Strings are prefixed by their length, a 32-bit little-endian integer
+
+static inline void WriteString(ofstream &output, const string &str) {
+    uint32_t size = (uint32_t) str.size();
+
+    char header[4];
+    header[0] = (char) (size & 0xFF);
+    header[1] = (char) ((size >> 8) & 0xFF);
+    header[2] = (char) ((size >> 16) & 0xFF);
+    header[3] = (char) ((size >> 24) & 0xFF);
+
+    output.write(header, 4);
+    output.write(str.data(), str.size());
+}
+
+// Returns false only at the clean end of the run, i.e. if not even a byte of the header is left
+static inline bool ReadString(ifstream &input, const string &path, string *outStr) {
+    char header[4];
+    if (!input.read(header, 4)) {
+        if (input.gcount() == 0 && input.eof() && !input.bad())
+            return false;
+
+        throw runtime_error("Truncated sorted run " + path);
+    }
+
+    outStr->resize((header[0] & 0xFFUL) +
+                   ((header[1] & 0xFFUL) << 8) +
+                   ((header[2] & 0xFFUL) << 16) +
+                   ((header[3] & 0xFFUL) << 24));
+
+    if (!input.read(&(*outStr)[0], outStr->size()))
+        throw runtime_error("Truncated sorted run " + path);
+
+    return true;
+}
+
+/* SortedRunWriter */
+
+SortedRunWriter::SortedRunWriter(const string &path) : path(path), output(path, ios::binary | ios::trunc) {
+    if (!output)
+        throw runtime_error("Unable to write file " + path);
+}
+
+void SortedRunWriter::Append(const string &key, const string &value) {
+    WriteString(output, key);
+    WriteString(output, value);
+
+    if (!output)
+        throw runtime_error("Unable to write file " + path);
+}
+
+void SortedRunWriter::Close() {
+    output.close();
+
+    if (!output)
+        throw runtime_error("Unable to write file " + path);
+}
+
+/* SortedRunReader */
+
+SortedRunReader::SortedRunReader(const string &path) : path(path), input(path, ios::binary) {
+    if (!input)
+        throw runtime_error("Unable to read file " + path);
+}
+
+bool SortedRunReader::Next(string *outKey, string *outValue) {
+    if (!ReadString(input, path, outKey))
+        return false;
+
+    // a key without its value is a truncated record
+    if (!ReadString(input, path, outValue))
+        throw runtime_error("Truncated sorted run " + path);
+
+    return true;
+}
+
+/* SortedRunMerger */
+
+SortedRunMerger::SortedRunMerger(const vector<string> &paths, run_merge_t merge) : merge(merge) {
+    heads.resize(paths.size());
+    heap.reserve(paths.size());
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        heads[i].reader = new SortedRunReader(paths[i]);
+
+        if (heads[i].reader->Next(&heads[i].key, &heads[i].value))
+            heap.push_back(i);
+    }
+
+    make_heap(heap.begin(), heap.end(), [this](size_t a, size_t b) {
+        return heads[a].key > heads[b].key;
+    });
+}
+
+SortedRunMerger::~SortedRunMerger() {
+    for (auto head = heads.begin(); head != heads.end(); ++head)
+        delete head->reader;
+}
+
+bool SortedRunMerger::Pop(string *outKey, string *outValue) {
+    auto comparator = [this](size_t a, size_t b) {
+        return heads[a].key > heads[b].key;
+    };
+
+    if (heap.empty())
+        return false;
+
+    pop_heap(heap.begin(), heap.end(), comparator);
+    head_t &head = heads[heap.back()];
+
+    outKey->swap(head.key);
+    outValue->swap(head.value);
+
+    if (head.reader->Next(&head.key, &head.value))
+        push_heap(heap.begin(), heap.end(), comparator);
+    else
+        heap.pop_back();
+
+    return true;
+}
+
+bool SortedRunMerger::Next(string *outKey, string *outValue) {
+    if (!Pop(outKey, outValue))
+        return false;
+
+    // Runs are sorted, so all the values of the key are on top of the heap
+    string key, value;
+    while (!heap.empty() && heads[heap.front()].key == *outKey) {
+        Pop(&key, &value);
+        merge(*outKey, *outValue, value);
+    }
+
+    return true;
+}
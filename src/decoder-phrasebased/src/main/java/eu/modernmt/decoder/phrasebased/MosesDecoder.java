@@ -18,6 +18,7 @@ import org.apache.logging.log4j.Logger;
 import java.io.File;
 import java.io.IOException;
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.Collection;
 import java.util.HashMap;
 import java.util.Map;
@@ -156,6 +157,64 @@ public class MosesDecoder implements Decoder, DataListenerProvider {
 
     private native TranslationXObject translate(String text, int[] contextKeys, float[] contextValues, int nbest);
 
+    /**
+     * Translates a batch of sentences sharing the same context, i.e. the segments of a document.
+     * The sentences are decoded in parallel by the native decoder, that processes the context only once.
+     */
+    public DecoderTranslation[] translate(Sentence[] sentences, ContextVector contextVector, int nbest) {
+        DecoderTranslation[] translations = new DecoderTranslation[sentences.length];
+
+        int[] indexes = new int[sentences.length];
+        int[] offsets = new int[sentences.length + 1];
+        int size = 0;
+        int length = 0;
+
+        for (int i = 0; i < sentences.length; i++) {
+            Word[] sourceWords = sentences[i].getWords();
+
+            if (sourceWords.length == 0) {
+                translations[i] = new DecoderTranslation(new Word[0], sentences[i], null);
+            } else {
+                indexes[size++] = i;
+                length += sourceWords.length;
+                offsets[size] = length;
+            }
+        }
+
+        if (size == 0)
+            return translations;
+
+        int[] words = new int[length];
+        for (int i = 0; i < size; i++) {
+            int[] ids = XUtils.encode(sentences[indexes[i]].getWords());
+            System.arraycopy(ids, 0, words, offsets[i], ids.length);
+        }
+
+        ContextXObject context = ContextXObject.build(contextVector);
+
+        long start = System.currentTimeMillis();
+        TranslationBatchXObject xbatch = this.translateBatch(words, Arrays.copyOf(offsets, size + 1),
+                context == null ? null : context.keys,
+                context == null ? null : context.values,
+                nbest);
+
+        long elapsed = System.currentTimeMillis() - start;
+
+        for (int i = 0; i < size; i++) {
+            Sentence sentence = sentences[indexes[i]];
+
+            translations[indexes[i]] = xbatch.getTranslation(i, sentence);
+        }
+
+        logger.info("Translation of " + size + " sentences (" + length + " words) took " +
+                (((double) elapsed) / 1000.) + "s");
+
+        return translations;
+    }
+
+    private native TranslationBatchXObject translateBatch(int[] words, int[] offsets,
+                                                          int[] contextKeys, float[] contextValues, int nbest);
+
     // DataListenerProvider
 
     @Override
@@ -0,0 +1,71 @@
+package eu.modernmt.decoder.phrasebased;
+
+import eu.modernmt.decoder.DecoderTranslation;
+import eu.modernmt.decoder.TranslationHypothesis;
+import eu.modernmt.model.Sentence;
+import eu.modernmt.model.Word;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Created by davide on 26/06/17.
+ * <p>
+ * Translations of a batch of sentences, stored in flat arrays: the data of
+ * the i-th translation is in the range [offsets[i], offsets[i + 1]) of each array,
+ * while elapsedTimes[i] is its decoding time in milliseconds.
+ */
+class TranslationBatchXObject {
+
+    public int[] textOffsets;
+    public int[] words;
+    public int[] alignmentOffsets;
+    public int[] alignments;
+    public long[] elapsedTimes;
+
+    public int[] nbestOffsets;
+    public String[] hypothesesTexts;
+    public float[] hypothesesScores;
+    public String[] hypothesesFvals;
+
+    public TranslationBatchXObject(int[] textOffsets, int[] words, int[] alignmentOffsets, int[] alignments,
+                                   long[] elapsedTimes, int[] nbestOffsets, String[] hypothesesTexts,
+                                   float[] hypothesesScores, String[] hypothesesFvals) {
+        this.textOffsets = textOffsets;
+        this.words = words;
+        this.alignmentOffsets = alignmentOffsets;
+        this.alignments = alignments;
+        this.elapsedTimes = elapsedTimes;
+        this.nbestOffsets = nbestOffsets;
+        this.hypothesesTexts = hypothesesTexts;
+        this.hypothesesScores = hypothesesScores;
+        this.hypothesesFvals = hypothesesFvals;
+    }
+
+    public int size() {
+        return textOffsets.length - 1;
+    }
+
+    public DecoderTranslation getTranslation(int i, Sentence source) {
+        Word[] words = XUtils.explode(this.words, textOffsets[i], textOffsets[i + 1]);
+
+        DecoderTranslation translation = new DecoderTranslation(words, source,
+                XUtils.decode(alignments, alignmentOffsets[i], alignmentOffsets[i + 1]));
+        translation.setElapsedTime(elapsedTimes[i]);
+
+        if (nbestOffsets != null && nbestOffsets[i + 1] > nbestOffsets[i]) {
+            List<TranslationHypothesis> nbest = new ArrayList<>(nbestOffsets[i + 1] - nbestOffsets[i]);
+
+            for (int h = nbestOffsets[i]; h < nbestOffsets[i + 1]; h++) {
+                TranslationXObject.Hypothesis hyp = new TranslationXObject.Hypothesis(
+                        hypothesesTexts[h], hypothesesScores[h], hypothesesFvals[h]);
+                nbest.add(hyp.getTranslationHypothesis(source));
+            }
+
+            translation.setNbest(nbest);
+        }
+
+        return translation;
+    }
+
+}
@@ -40,6 +40,20 @@ class XUtils {
         return new Alignment(source, target);
     }
 
+    public static Alignment decode(int[] encoded, int from, int to) {
+        int size = (to - from) / 2;
+        if (size == 0)
+            return null;
+
+        int[] source = new int[size];
+        int[] target = new int[size];
+
+        System.arraycopy(encoded, from, source, 0, size);
+        System.arraycopy(encoded, from + size, target, 0, size);
+
+        return new Alignment(source, target);
+    }
+
     public static String join(Word[] words) {
         StringBuilder text = new StringBuilder();
 
@@ -53,6 +67,17 @@ class XUtils {
         return text.toString();
     }
 
+    public static Word[] explode(int[] ids, int from, int to) {
+        Word[] words = new Word[to - from];
+
+        for (int i = 0; i < words.length; i++) {
+            String rightSpace = i < words.length - 1 ? " " : null;
+            words[i] = new Word(ids[from + i], rightSpace);
+        }
+
+        return words;
+    }
+
     public static Word[] explode(String text) {
         if (text.isEmpty())
             return new Word[0];
@@ -0,0 +1,126 @@
+//
+// Created by Davide  Caroselli on 28/06/17.
+//
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "moses/ScoreComponentCollection.h"
+
+using namespace std;
+using namespace Moses;
+
+namespace {
+    const size_t ERROR_IN_COMMAND_LINE = 1;
+    const size_t GENERIC_ERROR = 2;
+    const size_t SUCCESS = 0;
+
+    struct args_t {
+        size_t features = 16;
+        size_t options = 1000;
+        size_t iterations = 10000;
+        size_t updates = 4;
+    };
+} // namespace
+
+namespace po = boost::program_options;
+
+bool ParseArgs(int argc, const char *argv[], args_t *args) {
+    po::options_description desc("Measure the throughput of the score vector operations performed by the decoder "
+                                         "for every hypothesis expansion");
+    desc.add_options()
+            ("help,h", "print this help message")
+            ("features,f", po::value<size_t>(), "number of dense feature scores (default is 16)")
+            ("options,o", po::value<size_t>(), "number of distinct translation options (default is 1000)")
+            ("iterations,i", po::value<size_t>(), "number of passes over all the options (default is 10000)")
+            ("updates,u", po::value<size_t>(), "number of feature updates per expansion (default is 4)");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return false;
+        }
+
+        po::notify(vm);
+
+        if (vm.count("features"))
+            args->features = vm["features"].as<size_t>();
+        if (vm.count("options"))
+            args->options = vm["options"].as<size_t>();
+        if (vm.count("iterations"))
+            args->iterations = vm["iterations"].as<size_t>();
+        if (vm.count("updates"))
+            args->updates = vm["updates"].as<size_t>();
+    } catch (po::error &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void GenerateScores(size_t features, size_t count, mt19937 &random, vector<ScoreComponentCollection> &outScores) {
+    uniform_real_distribution<float> uniform(-10.f, 0.f);
+
+    outScores.assign(count, ScoreComponentCollection(features));
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t f = 0; f < features; ++f)
+            outScores[i].Assign(f, uniform(random));
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    args_t args;
+
+    if (!ParseArgs(argc, argv, &args))
+        return ERROR_IN_COMMAND_LINE;
+
+    if (args.features == 0 || args.options == 0 || args.iterations == 0) {
+        cerr << "ERROR: invalid arguments" << endl;
+        return GENERIC_ERROR;
+    }
+
+    mt19937 random(1);
+
+    vector<ScoreComponentCollection> weights, options, updates;
+    GenerateScores(args.features, 1, random, weights);
+    GenerateScores(args.features, args.options, random, options);
+    GenerateScores(args.features, args.updates, random, updates);
+
+    // Every expansion does what Hypothesis does when it is created and evaluated:
+    // copies the scores of the translation option, adds the scores of the features
+    // evaluated on the new hypothesis and computes the weighted score.
+    double checksum = 0.;
+    auto begin = chrono::steady_clock::now();
+
+    for (size_t it = 0; it < args.iterations; ++it) {
+        for (size_t o = 0; o < args.options; ++o) {
+            ScoreComponentCollection breakdown(options[o]);
+
+            for (size_t u = 0; u < args.updates; ++u)
+                breakdown.PlusEquals(updates[u]);
+
+            checksum += breakdown.GetWeightedScore(weights[0]);
+        }
+    }
+
+    double time = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    size_t expansions = args.options * args.iterations;
+
+#ifdef MAX_NUM_DENSE_FEATURES
+    cout << "Score vectors: dense-only (MAX_NUM_DENSE_FEATURES=" << MAX_NUM_DENSE_FEATURES << ")" << endl;
+#else
+    cout << "Score vectors: dense and sparse" << endl;
+#endif
+    cout << "Features: " << args.features << ", " << expansions << " expansions" << endl;
+    cout << "Time: " << time << "s (" << (expansions / time) << " expansions/s)" << endl;
+    cout << "Checksum: " << checksum << endl;
+
+    return SUCCESS;
+}
@@ -3,9 +3,11 @@
 //
 
 #include "JTranslation.h"
+#include <cstdlib>
 
 #define JTranslationClass "eu/modernmt/decoder/phrasebased/TranslationXObject"
 #define JHypothesisClass JTranslationClass"$Hypothesis"
+#define JTranslationBatchClass "eu/modernmt/decoder/phrasebased/TranslationBatchXObject"
 
 JTranslation::JTranslation(JNIEnv *jvm) : _class(jvm->FindClass(JTranslationClass)) {
     constructor = jvm->GetMethodID(_class, "<init>", "(Ljava/lang/String;[L" JHypothesisClass ";[I)V");
@@ -52,3 +54,126 @@ jobject JHypothesis::create(JNIEnv *jvm, std::string &text, float totalScore, st
 
     return jhypothesis;
 }
+
+static jintArray NewIntArray(JNIEnv *jvm, const std::vector<jint> &values) {
+    jsize size = (jsize) values.size();
+
+    jintArray jarray = jvm->NewIntArray(size);
+    jvm->SetIntArrayRegion(jarray, 0, size, values.data());
+
+    return jarray;
+}
+
+static jlongArray NewLongArray(JNIEnv *jvm, const std::vector<jlong> &values) {
+    jsize size = (jsize) values.size();
+
+    jlongArray jarray = jvm->NewLongArray(size);
+    jvm->SetLongArrayRegion(jarray, 0, size, values.data());
+
+    return jarray;
+}
+
+static jobjectArray NewStringArray(JNIEnv *jvm, const std::vector<std::string *> &values) {
+    jclass stringClass = jvm->FindClass("java/lang/String");
+    jobjectArray jarray = jvm->NewObjectArray((jsize) values.size(), stringClass, nullptr);
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        jstring jvalue = jvm->NewStringUTF(values[i]->c_str());
+        jvm->SetObjectArrayElement(jarray, (jsize) i, jvalue);
+        jvm->DeleteLocalRef(jvalue);
+    }
+
+    jvm->DeleteLocalRef(stringClass);
+
+    return jarray;
+}
+
+JTranslationBatch::JTranslationBatch(JNIEnv *jvm) : _class(jvm->FindClass(JTranslationBatchClass)) {
+    constructor = jvm->GetMethodID(_class, "<init>", "([I[I[I[I[J[I[Ljava/lang/String;[F[Ljava/lang/String;)V");
+}
+
+jobject JTranslationBatch::create(JNIEnv *jvm, std::vector<translation_t> &translations, bool nbest) {
+    std::vector<jint> textOffsets(1, 0);
+    std::vector<jint> words;
+    std::vector<jint> alignmentOffsets(1, 0);
+    std::vector<jint> alignments;
+    std::vector<jlong> elapsedTimes;
+
+    std::vector<jint> nbestOffsets(1, 0);
+    std::vector<std::string *> hypothesesTexts;
+    std::vector<jfloat> hypothesesScores;
+    std::vector<std::string *> hypothesesFvals;
+
+    for (auto translation = translations.begin(); translation != translations.end(); ++translation) {
+        // The translation text is a sequence of space-separated word ids
+        const char *cursor = translation->text.c_str();
+        char *end;
+
+        for (unsigned long id = strtoul(cursor, &end, 10); end != cursor; id = strtoul(cursor, &end, 10)) {
+            words.push_back((jint) (uint32_t) id);
+            cursor = end;
+        }
+
+        textOffsets.push_back((jint) words.size());
+
+        // Same encoding of JTranslation::getAlignment()
+        size_t hsize = translation->alignment.size();
+        alignments.resize(alignments.size() + hsize * 2);
+
+        jint *alignment = alignments.data() + alignments.size() - hsize * 2;
+        for (size_t i = 0; i < hsize; ++i) {
+            alignment[i] = (jint) translation->alignment[i].first;
+            alignment[i + hsize] = (jint) translation->alignment[i].second;
+        }
+
+        alignmentOffsets.push_back((jint) alignments.size());
+        elapsedTimes.push_back((jlong) translation->elapsed);
+
+        for (auto hypothesis = translation->hypotheses.begin();
+             hypothesis != translation->hypotheses.end(); ++hypothesis) {
+            hypothesesTexts.push_back(&hypothesis->text);
+            hypothesesScores.push_back((jfloat) hypothesis->score);
+            hypothesesFvals.push_back(&hypothesis->fvals);
+        }
+
+        nbestOffsets.push_back((jint) hypothesesScores.size());
+    }
+
+    jintArray jtextOffsets = NewIntArray(jvm, textOffsets);
+    jintArray jwords = NewIntArray(jvm, words);
+    jintArray jalignmentOffsets = NewIntArray(jvm, alignmentOffsets);
+    jintArray jalignments = NewIntArray(jvm, alignments);
+    jlongArray jelapsedTimes = NewLongArray(jvm, elapsedTimes);
+
+    jintArray jnbestOffsets = NULL;
+    jobjectArray jhypothesesTexts = NULL;
+    jfloatArray jhypothesesScores = NULL;
+    jobjectArray jhypothesesFvals = NULL;
+
+    if (nbest) {
+        jnbestOffsets = NewIntArray(jvm, nbestOffsets);
+        jhypothesesTexts = NewStringArray(jvm, hypothesesTexts);
+        jhypothesesFvals = NewStringArray(jvm, hypothesesFvals);
+
+        jhypothesesScores = jvm->NewFloatArray((jsize) hypothesesScores.size());
+        jvm->SetFloatArrayRegion(jhypothesesScores, 0, (jsize) hypothesesScores.size(), hypothesesScores.data());
+    }
+
+    jobject jbatch = jvm->NewObject(_class, constructor, jtextOffsets, jwords, jalignmentOffsets, jalignments,
+                                    jelapsedTimes, jnbestOffsets, jhypothesesTexts, jhypothesesScores, jhypothesesFvals);
+
+    jvm->DeleteLocalRef(jtextOffsets);
+    jvm->DeleteLocalRef(jwords);
+    jvm->DeleteLocalRef(jalignmentOffsets);
+    jvm->DeleteLocalRef(jalignments);
+    jvm->DeleteLocalRef(jelapsedTimes);
+
+    if (nbest) {
+        jvm->DeleteLocalRef(jnbestOffsets);
+        jvm->DeleteLocalRef(jhypothesesTexts);
+        jvm->DeleteLocalRef(jhypothesesScores);
+        jvm->DeleteLocalRef(jhypothesesFvals);
+    }
+
+    return jbatch;
+}
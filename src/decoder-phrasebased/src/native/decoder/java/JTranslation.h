@@ -8,6 +8,7 @@
 #include <jni.h>
 #include <string>
 #include <vector>
+#include "../moses/MosesDecoder.h"
 
 class JTranslation {
     jmethodID constructor;
@@ -33,5 +34,17 @@ public:
     jobject create(JNIEnv *jvm, std::string &text, float totalScore, std::string &fvals);
 };
 
+class JTranslationBatch {
+    jmethodID constructor;
+
+public:
+    const jclass _class;
+
+    JTranslationBatch(JNIEnv *);
+
+    // Builds the batch result with a fixed number of Java arrays, independently of the number of translations
+    jobject create(JNIEnv *jvm, std::vector<translation_t> &translations, bool nbest);
+};
+
 
 #endif //JNIMOSES_JTRANSLATION_H
@@ -174,6 +174,51 @@ Java_eu_modernmt_decoder_phrasebased_MosesDecoder_translate(JNIEnv *jvm, jobject
     return jtranslation;
 }
 
+/*
+ * Class:     eu_modernmt_decoder_phrasebased_MosesDecoder
+ * Method:    translateBatch
+ * Signature: ([I[I[I[FI)Leu/modernmt/decoder/phrasebased/TranslationBatchXObject;
+ */
+JNIEXPORT jobject JNICALL
+Java_eu_modernmt_decoder_phrasebased_MosesDecoder_translateBatch(JNIEnv *jvm, jobject jself, jintArray jwords,
+                                                                 jintArray jtextOffsets, jintArray contextKeys,
+                                                                 jfloatArray contextValues, jint nbest) {
+    MosesDecoder *instance = jni_gethandle<MosesDecoder>(jvm, jself);
+
+    // Sentence i is made of the word ids words[offsets[i], offsets[i + 1])
+    jsize size = jvm->GetArrayLength(jtextOffsets) - 1;
+    vector<string> sentences((size_t) (size > 0 ? size : 0));
+
+    jint *words = jvm->GetIntArrayElements(jwords, 0);
+    jint *offsets = jvm->GetIntArrayElements(jtextOffsets, 0);
+
+    for (jsize i = 0; i < size; ++i) {
+        string &sentence = sentences[i];
+
+        for (jint w = offsets[i]; w < offsets[i + 1]; ++w) {
+            if (w > offsets[i])
+                sentence.push_back(' ');
+            sentence.append(std::to_string((uint32_t) words[w]));
+        }
+    }
+
+    jvm->ReleaseIntArrayElements(jwords, words, JNI_ABORT);
+    jvm->ReleaseIntArrayElements(jtextOffsets, offsets, JNI_ABORT);
+
+    vector<translation_t> translations;
+    if (contextKeys != NULL) {
+        map<string, float> context;
+        ParseContext(jvm, contextKeys, contextValues, context);
+
+        translations = instance->translateBatch(sentences, &context, (size_t) nbest);
+    } else {
+        translations = instance->translateBatch(sentences, NULL, (size_t) nbest);
+    }
+
+    JTranslationBatch TranslationBatch(jvm);
+    return TranslationBatch.create(jvm, translations, nbest > 0);
+}
+
 /*
  * Class:     eu_modernmt_decoder_moses_MosesDecoder
  * Method:    getNativeDataListeners
@@ -0,0 +1,75 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+//
+// Created by Davide  Caroselli on 27/06/17.
+//
+
+#ifndef moses_ArenaObject_h
+#define moses_ArenaObject_h
+
+#include <cstddef>
+#include <new>
+#include "util/pool.hh"
+
+namespace Moses
+{
+
+/** Base class of the sentence-scoped decoder objects (hypotheses, translation
+ * options, target phrases) that can be allocated in the arena of a Manager.
+ *
+ * Objects are created with "new (arena) T(...)": if the arena is NULL they are
+ * allocated on the heap as usual. In both cases they are destroyed with "delete":
+ * the destructor always runs, but the memory of the objects allocated in the arena
+ * is released all at once, when the arena itself is destroyed together with its
+ * Manager. Every allocation is preceded by a small header that records its origin,
+ * so that the owner of an object does not need to know where it was allocated.
+ */
+class ArenaObject
+{
+  // Keeps the objects aligned as the ones returned by malloc()
+  static const size_t kHeaderSize = 16;
+  static const size_t kArenaTag = 1;
+  static const size_t kHeapTag = 0;
+
+  static size_t AlignedSize(size_t size) {
+    return (size + kHeaderSize - 1) & ~(kHeaderSize - 1);
+  }
+
+  static void *Tag(void *ptr, size_t tag) {
+    *static_cast<size_t *>(ptr) = tag;
+    return static_cast<char *>(ptr) + kHeaderSize;
+  }
+
+public:
+  static void *operator new(size_t size) {
+    return Tag(::operator new(kHeaderSize + size), kHeapTag);
+  }
+
+  static void *operator new(size_t size, util::Pool *arena) {
+    if (arena == NULL)
+      return Tag(::operator new(kHeaderSize + size), kHeapTag);
+    else
+      return Tag(arena->Allocate(kHeaderSize + AlignedSize(size)), kArenaTag);
+  }
+
+  static void operator delete(void *ptr) {
+    if (ptr == NULL)
+      return;
+
+    void *header = static_cast<char *>(ptr) - kHeaderSize;
+    if (*static_cast<size_t *>(header) == kHeapTag)
+      ::operator delete(header);
+  }
+
+  // Called only if the constructor of an object created with "new (arena)" throws
+  static void operator delete(void *ptr, util::Pool *arena) {
+    ArenaObject::operator delete(ptr);
+  }
+
+  // Arrays are not allocated in the arena
+  static void *operator new[](size_t size) = delete;
+  static void operator delete[](void *ptr) = delete;
+};
+
+}
+
+#endif
@@ -28,64 +28,98 @@ namespace Moses
 TO_STRING_BODY(Bitmap);
 
 Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
-  :m_bitmap(initializer.begin(), initializer.end())
+  :m_size(size)
+  ,m_firstGap(0)
+  ,m_numWordsCovered(0)
 {
-
-  // The initializer may not be of the same length.  Change to the desired
-  // length.  If we need to add any elements, initialize them to false.
-  m_bitmap.resize(size, false);
-
-  m_numWordsCovered = std::count(m_bitmap.begin(), m_bitmap.end(), true);
-
-  // Find the first gap, and cache it.
-  std::vector<char>::const_iterator first_gap = std::find(
-        m_bitmap.begin(), m_bitmap.end(), false);
-  m_firstGap = (
-                 (first_gap == m_bitmap.end()) ?
-                 NOT_FOUND : first_gap - m_bitmap.begin());
+  std::fill(m_words, m_words + kNumWords, word_t(0));
+
+  if (IsWordBased()) {
+    // The initializer may not be of the same length: missing elements are false.
+    for (size_t pos = 0; pos < size && pos < initializer.size(); ++pos) {
+      if (initializer[pos])
+        m_words[pos / kWordBits] |= word_t(1) << (pos % kWordBits);
+    }
+
+    for (size_t w = 0; w < kNumWords; ++w)
+      m_numWordsCovered += __builtin_popcountll(m_words[w]);
+
+    m_firstGap = size == 0 ? NOT_FOUND : FindFirst(0, size - 1, false);
+  } else {
+    m_bitmap.assign(initializer.begin(), initializer.end());
+
+    // The initializer may not be of the same length.  Change to the desired
+    // length.  If we need to add any elements, initialize them to false.
+    m_bitmap.resize(size, false);
+
+    m_numWordsCovered = std::count(m_bitmap.begin(), m_bitmap.end(), true);
+
+    // Find the first gap, and cache it.
+    std::vector<char>::const_iterator first_gap = std::find(
+          m_bitmap.begin(), m_bitmap.end(), false);
+    m_firstGap = (
+                   (first_gap == m_bitmap.end()) ?
+                   NOT_FOUND : first_gap - m_bitmap.begin());
+  }
 }
 
 //! Create Bitmap of length size and initialise.
 Bitmap::Bitmap(size_t size)
-  :m_bitmap(size, false)
+  :m_size(size)
   ,m_firstGap(0)
   ,m_numWordsCovered(0)
-
 {
+  std::fill(m_words, m_words + kNumWords, word_t(0));
+  if (!IsWordBased())
+    m_bitmap.assign(size, false);
 }
 
 //! Deep copy.
 Bitmap::Bitmap(const Bitmap &copy)
   :m_bitmap(copy.m_bitmap)
+  ,m_size(copy.m_size)
   ,m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  std::copy(copy.m_words, copy.m_words + kNumWords, m_words);
 }
 
 Bitmap::Bitmap(const Bitmap &copy, const Range &range)
   :m_bitmap(copy.m_bitmap)
+  ,m_size(copy.m_size)
   ,m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  std::copy(copy.m_words, copy.m_words + kNumWords, m_words);
   SetValueNonOverlap(range);
 }
 
 // for unordered_set in stack
 size_t Bitmap::hash() const
 {
+  if (IsWordBased()) {
+    size_t ret = m_size;
+    boost::hash_range(ret, m_words, m_words + kNumWords);
+    return ret;
+  }
+
   size_t ret = boost::hash_value(m_bitmap);
   return ret;
 }
 
 bool Bitmap::operator==(const Bitmap& other) const
 {
+  if (m_size != other.m_size)
+    return false;
+  if (IsWordBased())
+    return std::equal(m_words, m_words + kNumWords, other.m_words);
   return m_bitmap == other.m_bitmap;
 }
 
 // friend
 std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap)
 {
-  for (size_t i = 0 ; i < bitmap.m_bitmap.size() ; i++) {
+  for (size_t i = 0 ; i < bitmap.GetSize() ; i++) {
     out << int(bitmap.GetValue(i));
   }
   return out;
@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <stdint.h>
 #include "TypeDef.h"
 #include "Range.h"
 
@@ -38,36 +39,90 @@ typedef unsigned long WordsBitmapID;
 
 /** Vector of boolean to represent whether a word has been translated or not.
  *
- * Implemented using a vector of char, which is usually the same representation
- * for the elements that a C array of bool would use.  A vector of bool, or a
- * Boost dynamic_bitset, could be much more efficient in theory.  Unfortunately
- * algorithms like std::find() are not optimized for vector<bool> on gcc or
- * clang, and dynamic_bitset lacks all the optimized search operations we want.
- * Only benchmarking will tell what works best.  Perhaps dynamic_bitset could
- * still be a dramatic improvement, if we flip the meaning of the bits around
- * so we can use its find_first() and find_next() for the most common searches.
+ * Sentences of up to kMaxWordsSize words (almost all of them) are stored as a
+ * fixed array of 64-bit machine words, so that copies never allocate and the
+ * searches used by the decoder inner loop (gaps, edges, overlaps) are a handful
+ * of mask, popcount and count-leading/trailing-zeros operations. Longer
+ * sentences fall back to a vector of char, one element per word.
  */
 class Bitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap);
+public:
+  //! Maximum sentence length stored as machine words
+  static const size_t kMaxWordsSize = 128;
+
 private:
-  std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done.
+  typedef uint64_t word_t;
+  static const size_t kWordBits = 64;
+  static const size_t kNumWords = kMaxWordsSize / kWordBits;
+
+  std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done (long sentences only).
+  word_t m_words[kNumWords]; //! Ticks of words in sentence that have been done (short sentences only).
+  size_t m_size;
   size_t m_firstGap; //! Cached position of first gap, or NOT_FOUND.
   size_t m_numWordsCovered;
 
   Bitmap(); // not implemented
   Bitmap& operator= (const Bitmap& other);
 
+  bool IsWordBased() const {
+    return m_size <= kMaxWordsSize;
+  }
+
+  //! bits of word w that fall in the positions [startPos, endPos]
+  static word_t RangeMask(size_t w, size_t startPos, size_t endPos) {
+    size_t first = w * kWordBits;
+    size_t last = first + kWordBits - 1;
+    if (endPos < first || startPos > last)
+      return 0;
+
+    size_t lo = startPos > first ? startPos - first : 0;
+    size_t hi = endPos < last ? endPos - first : kWordBits - 1;
+    word_t mask = (hi == kWordBits - 1) ? ~word_t(0) : ((word_t(1) << (hi + 1)) - 1);
+    return mask & (~word_t(0) << lo);
+  }
+
+  //! bits of word w that correspond to a position of the sentence
+  word_t ValidMask(size_t w) const {
+    return m_size == 0 ? 0 : RangeMask(w, 0, m_size - 1);
+  }
+
+  //! lowest position in [startPos, endPos] with the given value, or NOT_FOUND
+  size_t FindFirst(size_t startPos, size_t endPos, bool value) const {
+    for (size_t w = startPos / kWordBits; w <= endPos / kWordBits; ++w) {
+      word_t bits = (value ? m_words[w] : ~m_words[w]) & RangeMask(w, startPos, endPos);
+      if (bits)
+        return w * kWordBits + __builtin_ctzll(bits);
+    }
+    return NOT_FOUND;
+  }
+
+  //! highest position in [startPos, endPos] with the given value, or NOT_FOUND
+  size_t FindLast(size_t startPos, size_t endPos, bool value) const {
+    for (size_t w = endPos / kWordBits + 1; w-- > startPos / kWordBits; ) {
+      word_t bits = (value ? m_words[w] : ~m_words[w]) & RangeMask(w, startPos, endPos);
+      if (bits)
+        return w * kWordBits + (kWordBits - 1 - __builtin_clzll(bits));
+    }
+    return NOT_FOUND;
+  }
+
   /** Update the first gap, when bits are flipped */
   void UpdateFirstGap(size_t startPos, size_t endPos, bool value) {
     if (value) {
       //may remove gap
       if (startPos <= m_firstGap && m_firstGap <= endPos) {
         m_firstGap = NOT_FOUND;
-        for (size_t i = endPos + 1 ; i < m_bitmap.size(); ++i) {
-          if (!m_bitmap[i]) {
-            m_firstGap = i;
-            break;
+        if (IsWordBased()) {
+          if (endPos + 1 < m_size)
+            m_firstGap = FindFirst(endPos + 1, m_size - 1, false);
+        } else {
+          for (size_t i = endPos + 1 ; i < m_bitmap.size(); ++i) {
+            if (!m_bitmap[i]) {
+              m_firstGap = i;
+              break;
+            }
           }
         }
       }
@@ -86,8 +141,13 @@ private:
     size_t startPos = range.GetStartPos();
     size_t endPos = range.GetEndPos();
 
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = true;
+    if (IsWordBased()) {
+      for (size_t w = startPos / kWordBits; w <= endPos / kWordBits; ++w)
+        m_words[w] |= RangeMask(w, startPos, endPos);
+    } else {
+      for(size_t pos = startPos ; pos <= endPos ; pos++) {
+        m_bitmap[pos] = true;
+      }
     }
 
     m_numWordsCovered += range.GetNumWordsCovered();
@@ -119,6 +179,9 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
+    if (IsWordBased())
+      return m_size == 0 ? NOT_FOUND : FindLast(0, m_size - 1, false);
+
     for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
       if (!m_bitmap[pos]) {
         return pos;
@@ -131,6 +194,9 @@ public:
 
   //! position of last translated word
   size_t GetLastPos() const {
+    if (IsWordBased())
+      return m_size == 0 ? NOT_FOUND : FindLast(0, m_size - 1, true);
+
     for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
       if (m_bitmap[pos]) {
         return pos;
@@ -142,15 +208,20 @@ public:
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
+    if (IsWordBased())
+      return (m_words[pos / kWordBits] >> (pos % kWordBits)) & 1;
     return bool(m_bitmap[pos]);
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    bool origValue = m_bitmap[pos];
+    bool origValue = GetValue(pos);
     if (origValue == value) {
       // do nothing
     } else {
-      m_bitmap[pos] = value;
+      if (IsWordBased())
+        m_words[pos / kWordBits] ^= word_t(1) << (pos % kWordBits);
+      else
+        m_bitmap[pos] = value;
       UpdateFirstGap(pos, pos, value);
       if (value) {
         ++m_numWordsCovered;
@@ -166,6 +237,16 @@ public:
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const Range &compare) const {
+    if (IsWordBased()) {
+      size_t startPos = compare.GetStartPos();
+      size_t endPos = compare.GetEndPos();
+      for (size_t w = startPos / kWordBits; w <= endPos / kWordBits; ++w) {
+        if (m_words[w] & RangeMask(w, startPos, endPos))
+          return true;
+      }
+      return false;
+    }
+
     for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
       if (m_bitmap[pos])
         return true;
@@ -174,11 +255,15 @@ public:
   }
   //! number of elements
   size_t GetSize() const {
-    return m_bitmap.size();
+    return m_size;
   }
 
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
+    if (IsWordBased()) {
+      size_t pos = FindLast(0, l - 1, true);
+      return pos == NOT_FOUND ? 0 : pos + 1;
+    }
     while (l && !m_bitmap[l-1]) {
       --l;
     }
@@ -186,7 +271,11 @@ public:
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
-    if (r+1 == m_bitmap.size()) return r;
+    if (r+1 == m_size) return r;
+    if (IsWordBased()) {
+      size_t pos = FindFirst(r + 1, m_size - 1, true);
+      return (pos == NOT_FOUND ? m_size : pos) - 1;
+    }
     return (
              std::find(m_bitmap.begin() + r + 1, m_bitmap.end(), true) -
              m_bitmap.begin()
@@ -196,10 +285,10 @@ public:
 
   //! converts bitmap into an integer ID: it consists of two parts: the first 16 bit are the pattern between the first gap and the last word-1, the second 16 bit are the number of filled positions. enforces a sentence length limit of 65535 and a max distortion of 16
   WordsBitmapID GetID() const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -214,10 +303,10 @@ public:
 
   //! converts bitmap into an integer ID, with an additional span covered
   WordsBitmapID GetIDPlus( size_t startPos, size_t endPos ) const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
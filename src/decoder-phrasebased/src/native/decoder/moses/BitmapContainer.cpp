@@ -230,7 +230,8 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
     hypothesis.GetManager().GetSentenceStats().StartTimeBuildHyp();
   }
   const Bitmap &bitmap = m_parent.GetWordsBitmap();
-  Hypothesis *newHypo = new Hypothesis(hypothesis, transOpt, bitmap, hypothesis.GetManager().GetNextHypoId());
+  Manager &manager = hypothesis.GetManager();
+  Hypothesis *newHypo = new (manager.GetArena()) Hypothesis(hypothesis, transOpt, bitmap, manager.GetNextHypoId());
   IFVERBOSE(2) {
     hypothesis.GetManager().GetSentenceStats().StopTimeBuildHyp();
   }
@@ -1,4 +1,5 @@
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
 #include "Bitmaps.h"
 #include "Util.h"
 
@@ -7,15 +8,16 @@ using namespace std;
 namespace Moses
 {
 Bitmaps::Bitmaps(size_t inputSize, const std::vector<bool> &initSourceCompleted)
+  : m_transitions(1024)
+  , m_numTransitions(0)
 {
   m_initBitmap = new Bitmap(inputSize, initSourceCompleted);
-  m_coll[m_initBitmap];
+  m_coll.insert(m_initBitmap);
 }
 
 Bitmaps::~Bitmaps()
 {
-  BOOST_FOREACH (const Coll::value_type& myPair, m_coll) {
-    const Bitmap *bm = myPair.first;
+  BOOST_FOREACH (const Bitmap *bm, m_coll) {
     delete bm;
   }
 }
@@ -26,33 +28,75 @@ const Bitmap &Bitmaps::GetNextBitmap(const Bitmap &bm, const Range &range)
 
   Coll::const_iterator iter = m_coll.find(newBM);
   if (iter == m_coll.end()) {
-    m_coll[newBM] = NextBitmaps();
+    m_coll.insert(newBM);
     return *newBM;
   } else {
     delete newBM;
-    return *iter->first;
+    return **iter;
+  }
+}
+
+size_t Bitmaps::GetSlot(const Bitmap *bm, size_t startPos, size_t endPos) const
+{
+  size_t seed = boost::hash_value(bm);
+  boost::hash_combine(seed, startPos);
+  boost::hash_combine(seed, endPos);
+
+  size_t mask = m_transitions.size() - 1;
+  size_t slot = seed & mask;
+
+  while (true) {
+    const Transition &transition = m_transitions[slot];
+    if (transition.prev == NULL ||
+        (transition.prev == bm && transition.startPos == startPos && transition.endPos == endPos))
+      return slot;
+
+    slot = (slot + 1) & mask;
+  }
+}
+
+void Bitmaps::GrowTransitions()
+{
+  std::vector<Transition> transitions(m_transitions.size() * 2);
+  transitions.swap(m_transitions);
+
+  BOOST_FOREACH (const Transition &transition, transitions) {
+    if (transition.prev != NULL)
+      m_transitions[GetSlot(transition.prev, transition.startPos, transition.endPos)] = transition;
   }
 }
 
 const Bitmap &Bitmaps::GetBitmap(const Bitmap &bm, const Range &range)
 {
-  Coll::iterator iter = m_coll.find(&bm);
-  assert(iter != m_coll.end());
-
-  const Bitmap *newBM;
-  NextBitmaps &next = iter->second;
-  NextBitmaps::const_iterator iterNext = next.find(range);
-  if (iterNext == next.end()) {
-    // not seen the link yet.
-    newBM = &GetNextBitmap(bm, range);
-    next[range] = newBM;
-  } else {
+#ifdef WITH_THREADS
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+#endif
+
+  size_t startPos = range.GetStartPos();
+  size_t endPos = range.GetEndPos();
+
+  size_t slot = GetSlot(&bm, startPos, endPos);
+  Transition &transition = m_transitions[slot];
+
+  if (transition.prev != NULL) {
     // link exist
-    //std::cerr << "link exists" << endl;
-    newBM = iterNext->second;
+    return *transition.next;
   }
+
+  // not seen the link yet.
+  assert(m_coll.find(&bm) != m_coll.end());
+  const Bitmap *newBM = &GetNextBitmap(bm, range);
+
+  transition.prev = &bm;
+  transition.startPos = startPos;
+  transition.endPos = endPos;
+  transition.next = newBM;
+
+  // keep the load factor under 1/2
+  if (++m_numTransitions * 2 > m_transitions.size())
+    GrowTransitions();
+
   return *newBM;
 }
 
 }
-
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <boost/unordered_set.hpp>
-#include <boost/unordered_map.hpp>
-#include <set>
+#include <vector>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#endif
 #include "Bitmap.h"
 #include "Util.h"
 
@@ -11,13 +14,33 @@ namespace Moses
 
 class Bitmaps
 {
-  typedef boost::unordered_map<Range, const Bitmap*> NextBitmaps;
-  typedef boost::unordered_map<const Bitmap*, NextBitmaps, UnorderedComparer<Bitmap>, UnorderedComparer<Bitmap> > Coll;
-  //typedef std::set<const Bitmap*, OrderedComparer<Bitmap> > Coll;
+  typedef boost::unordered_set<const Bitmap*, UnorderedComparer<Bitmap>, UnorderedComparer<Bitmap> > Coll;
+
+  //! Link from an interned bitmap to the one obtained covering a range.
+  struct Transition {
+    const Bitmap *prev;
+    size_t startPos;
+    size_t endPos;
+    const Bitmap *next;
+  };
+
   Coll m_coll;
   const Bitmap *m_initBitmap;
 
+  // Flat open-addressing table of the transitions (linear probing, power of two capacity):
+  // a lookup hashes two words and a pointer instead of the whole coverage vector
+  std::vector<Transition> m_transitions;
+  size_t m_numTransitions;
+
+#ifdef WITH_THREADS
+  // GetBitmap() is called concurrently by the SearchWorkers
+  boost::mutex m_mutex;
+#endif
+
   const Bitmap &GetNextBitmap(const Bitmap &bm, const Range &range);
+
+  size_t GetSlot(const Bitmap *bm, size_t startPos, size_t endPos) const;
+  void GrowTransitions();
 public:
   Bitmaps(size_t inputSize, const std::vector<bool> &initSourceCompleted);
   virtual ~Bitmaps();
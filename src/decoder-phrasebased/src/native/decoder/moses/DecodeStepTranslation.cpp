@@ -53,7 +53,7 @@ void DecodeStepTranslation::Process(const TranslationOption &inputPartialTranslO
 {
   if (inputPartialTranslOpt.GetTargetPhrase().GetSize() == 0) {
     // word deletion
-    outputPartialTranslOptColl.Add(new TranslationOption(inputPartialTranslOpt));
+    outputPartialTranslOptColl.Add(new (toc->GetArena()) TranslationOption(inputPartialTranslOpt));
     return;
   }
 
@@ -86,7 +86,7 @@ void DecodeStepTranslation::Process(const TranslationOption &inputPartialTranslO
       outPhrase.Merge(targetPhrase, m_newOutputFactors);
       outPhrase.EvaluateInIsolation(inputPath.GetPhrase(), m_featuresToApply); // need to do this as all non-transcores would be screwed up
 
-      TranslationOption *newTransOpt = new TranslationOption(sourceWordsRange, outPhrase);
+      TranslationOption *newTransOpt = new (toc->GetArena()) TranslationOption(sourceWordsRange, outPhrase);
       assert(newTransOpt != NULL);
 
       newTransOpt->SetInputPath(inputPath);
@@ -107,7 +107,8 @@ ProcessInitialTranslation(InputType const& source,
                           size_t startPos, size_t endPos,
                           bool adhereTableLimit,
                           InputPath const& inputPath,
-                          TargetPhraseCollection::shared_ptr phraseColl) const
+                          TargetPhraseCollection::shared_ptr phraseColl,
+                          util::Pool *arena) const
 {
   const PhraseDictionary* phraseDictionary = GetPhraseDictionaryFeature();
   const size_t tableLimit = phraseDictionary->GetTableLimit();
@@ -128,7 +129,7 @@ ProcessInitialTranslation(InputType const& source,
 
     for (iterTargetPhrase = phraseColl->begin() ; iterTargetPhrase != iterEnd ; ++iterTargetPhrase) {
       const TargetPhrase	&targetPhrase = **iterTargetPhrase;
-      TranslationOption *transOpt = new TranslationOption(range, targetPhrase);
+      TranslationOption *transOpt = new (arena) TranslationOption(range, targetPhrase);
 
       transOpt->SetInputPath(inputPath);
 
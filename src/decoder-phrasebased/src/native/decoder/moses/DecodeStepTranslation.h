@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DecodeStep.h"
 #include "TranslationModel/PhraseDictionary.h"
 #include "InputPath.h"
+#include "util/pool.hh"
 
 namespace Moses
 {
@@ -58,7 +59,8 @@ public:
                                  , PartialTranslOptColl &outputPartialTranslOptColl
                                  , size_t startPos, size_t endPos, bool adhereTableLimit
                                  , const InputPath &inputPath
-                                 , TargetPhraseCollection::shared_ptr phraseColl) const;
+                                 , TargetPhraseCollection::shared_ptr phraseColl
+                                 , util::Pool *arena = NULL) const;
 
   // legacy
   void
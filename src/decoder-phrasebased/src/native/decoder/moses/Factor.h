@@ -48,12 +48,14 @@ class Factor
   // This is mutable so the pointer can be changed to pool-backed memory.
   mutable StringPiece m_string;
   size_t			m_id;
+  // numeric value of the string, if it is a non-negative integer (NOT_FOUND otherwise)
+  size_t			m_numericValue;
 
   //! protected constructor. only friend class, FactorCollection, is allowed to create Factor objects
   Factor() {}
 
   // Needed for STL containers.  They'll delegate through FactorFriend, which is never exposed publicly.
-  Factor(const Factor &factor) : m_string(factor.m_string), m_id(factor.m_id) {}
+  Factor(const Factor &factor) : m_string(factor.m_string), m_id(factor.m_id), m_numericValue(factor.m_numericValue) {}
 
   // Not implemented.  Shouldn't be called.
   Factor &operator=(const Factor &factor);
@@ -68,6 +70,16 @@ public:
     return m_id;
   }
 
+  //! true if the string is a non-negative integer, like the word ids of MMT models
+  inline bool IsNumeric() const {
+    return m_numericValue != NOT_FOUND;
+  }
+
+  //! integer value of the string, NOT_FOUND if the factor is not numeric
+  inline size_t GetNumericValue() const {
+    return m_numericValue;
+  }
+
   /** transitive comparison between 2 factors.
   *	-1 = less than
   *	+1 = more than
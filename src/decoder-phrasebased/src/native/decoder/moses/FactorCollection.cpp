@@ -35,6 +35,25 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
+// numeric factors with a larger value are not indexed
+static const size_t kMaxNumericFactorValue = 1 << 24;
+
+static size_t ParseNumericValue(const StringPiece &str)
+{
+  if (str.empty() || str.size() > 18)
+    return NOT_FOUND;
+
+  size_t value = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    char c = str.data()[i];
+    if (c < '0' || c > '9')
+      return NOT_FOUND;
+    value = value * 10 + (c - '0');
+  }
+
+  return value;
+}
+
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
 {
   FactorFriend to_ins;
@@ -51,11 +70,21 @@ const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool
   }
   boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
 #endif // WITH_THREADS
+  to_ins.in.m_numericValue = ParseNumericValue(factorString);
   std::pair<Set::iterator, bool> ret(set.insert(to_ins));
   if (ret.second) {
     ret.first->in.m_string.set(
       memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
       factorString.size());
+
+    // only canonical representations are indexed, i.e. "12" but not "012"
+    size_t value = to_ins.in.m_numericValue;
+    if (!isNonTerminal && value < kMaxNumericFactorValue && (factorString.size() == 1 || factorString[0] != '0')) {
+      if (value >= m_numericFactors.size())
+        m_numericFactors.resize(std::max(value + 1, m_numericFactors.size() * 2), NULL);
+      m_numericFactors[value] = &ret.first->in;
+    }
+
     if (isNonTerminal) {
       m_factorIdNonTerminal++;
       UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
@@ -83,6 +112,18 @@ const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool
   return NULL;
 }
 
+const Factor *FactorCollection::AddNumericFactor(size_t value)
+{
+  if (value < kMaxNumericFactorValue) {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+#endif // WITH_THREADS
+    if (value < m_numericFactors.size() && m_numericFactors[value] != NULL)
+      return m_numericFactors[value];
+  }
+
+  return AddFactor(SPrint(value));
+}
 
 FactorCollection::~FactorCollection() {}
 
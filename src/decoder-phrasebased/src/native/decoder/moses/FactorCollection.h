@@ -89,6 +89,8 @@ class FactorCollection
   mutable boost::shared_mutex m_accessLock;
 #endif
 
+  std::vector<const Factor *> m_numericFactors; /**< numeric terminal factors, indexed by value */
+
   size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
   size_t m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
 
@@ -116,6 +118,11 @@ public:
 
   const Factor *GetFactor(const StringPiece &factorString, bool isNonTerminal = false);
 
+  /** returns the terminal factor whose string is the decimal representation of value;
+  *	it avoids the string conversion and the hash lookup if the factor already exists
+  */
+  const Factor *AddNumericFactor(size_t value);
+
   // TODO: remove calls to this function, replacing them with the simpler AddFactor(factorString)
   const Factor *AddFactor(FactorDirection /*direction*/, FactorType /*factorType*/, const StringPiece &factorString, bool isNonTerminal = false) {
     return AddFactor(factorString, isNonTerminal);
@@ -166,7 +166,7 @@ FVector::FVector(size_t coreFeatures) : m_coreFeatures(coreFeatures) {}
 
 void FVector::resize(size_t newsize)
 {
-  valarray<FValue> oldValues(m_coreFeatures);
+  FCoreValues oldValues(m_coreFeatures);
   m_coreFeatures.resize(newsize);
   for (size_t i = 0; i < min(m_coreFeatures.size(), oldValues.size()); ++i) {
     m_coreFeatures[i] = oldValues[i];
@@ -176,7 +176,9 @@ void FVector::resize(size_t newsize)
 void FVector::clear()
 {
   m_coreFeatures.resize(m_coreFeatures.size(), 0);
+#ifndef MAX_NUM_DENSE_FEATURES
   m_features.clear();
+#endif
 }
 
 bool FVector::load(const std::string& filename)
@@ -351,7 +353,15 @@ void FVector::capMin(FValue minValue)
 
 void FVector::set(const FName& name, const FValue& value)
 {
-  m_features[name] = value;
+  sparse(name) = value;
+}
+
+FValue& FVector::sparse(const FName& name)
+{
+#ifdef MAX_NUM_DENSE_FEATURES
+  UTIL_THROW2("Sparse feature " << name << " is not supported, the decoder is built with MAX_NUM_DENSE_FEATURES");
+#endif
+  return m_features[name];
 }
 
 void FVector::printCoreFeatures()
@@ -370,10 +380,16 @@ FVector& FVector::operator+= (const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
+#ifdef MAX_NUM_DENSE_FEATURES
+  // the tail of both arrays is zero: add them whole
+  for (size_t i = 0; i < FCoreValues::kCapacity; ++i)
+    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+#else
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     set(i->first, get(i->first) + i->second);
   for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
     m_coreFeatures[i] += rhs.m_coreFeatures[i];
+#endif
   return *this;
 }
 
@@ -389,8 +405,13 @@ void FVector::corePlusEquals(const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
+#ifdef MAX_NUM_DENSE_FEATURES
+  for (size_t i = 0; i < FCoreValues::kCapacity; ++i)
+    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+#else
   for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
     m_coreFeatures[i] += rhs.m_coreFeatures[i];
+#endif
 }
 
 // assign only core features
@@ -806,12 +827,18 @@ FValue FVector::inner_product(const FVector& rhs) const
 {
   assert(m_coreFeatures.size() == rhs.m_coreFeatures.size());
   FValue product = 0.0;
+#ifdef MAX_NUM_DENSE_FEATURES
+  for (size_t i = 0; i < FCoreValues::kCapacity; ++i) {
+    product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
+  }
+#else
   for (const_iterator i = cbegin(); i != cend(); ++i) {
     product += ((i->second)*(rhs.get(i->first)));
   }
   for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
     product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
   }
+#endif
   return product;
 }
 
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef FEATUREVECTOR_H
 #define FEATUREVECTOR_H
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -44,6 +45,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/thread/shared_mutex.hpp>
 #endif
 
+#if defined(MPI_ENABLE) && defined(MAX_NUM_DENSE_FEATURES)
+#error "MAX_NUM_DENSE_FEATURES does not support serialization"
+#endif
+
 #include "util/exception.hh"
 #include "util/string_piece.hh"
 
@@ -121,8 +126,88 @@ struct FNameHash
 
 class ProxyFVector;
 
+#ifdef MAX_NUM_DENSE_FEATURES
+/**
+ * Fixed-capacity replacement of std::valarray for the core features, used when
+ * the decoder is built with MAX_NUM_DENSE_FEATURES. The values live inline in the
+ * vector (no heap allocation on copy) and the unused tail is always zero, so the
+ * element-wise operations can run on the whole array with a loop of fixed length
+ * that the compiler vectorizes.
+ **/
+class DenseFValues
+{
+public:
+  static const size_t kCapacity = MAX_NUM_DENSE_FEATURES;
+
+  explicit DenseFValues(size_t size = 0) : m_size(0) {
+    std::fill(m_values, m_values + kCapacity, FValue(0));
+    resize(size);
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+
+  FValue &operator[](size_t index) {
+    return m_values[index];
+  }
+
+  FValue operator[](size_t index) const {
+    return m_values[index];
+  }
+
+  const FValue *data() const {
+    return m_values;
+  }
+
+  FValue *data() {
+    return m_values;
+  }
+
+  /** Same semantics of std::valarray::resize(): all the values are set to "value" */
+  void resize(size_t size, FValue value = 0) {
+    UTIL_THROW_IF2(size > kCapacity, "Too many dense features (" << size
+                   << "), rebuild with MAX_NUM_DENSE_FEATURES >= " << size);
+    std::fill(m_values, m_values + size, value);
+    std::fill(m_values + size, m_values + kCapacity, FValue(0));
+    m_size = size;
+  }
+
+  FValue sum() const {
+    FValue sum = 0;
+    for (size_t i = 0; i < kCapacity; ++i)
+      sum += m_values[i];
+    return sum;
+  }
+
+  DenseFValues &operator*=(FValue value) {
+    for (size_t i = 0; i < m_size; ++i)
+      m_values[i] *= value;
+    return *this;
+  }
+
+  DenseFValues &operator/=(FValue value) {
+    for (size_t i = 0; i < m_size; ++i)
+      m_values[i] /= value;
+    return *this;
+  }
+
+private:
+  FValue m_values[kCapacity];
+  size_t m_size;
+};
+
+typedef DenseFValues FCoreValues;
+#else
+typedef std::valarray<FValue> FCoreValues;
+#endif
+
 /**
  * A sparse feature (or weight) vector.
+ *
+ * If the decoder is built with MAX_NUM_DENSE_FEATURES the vector is dense-only:
+ * the core features are stored in a DenseFValues and any attempt to set a sparse
+ * feature throws.
  **/
 class FVector
 {
@@ -131,7 +216,9 @@ public:
   FVector(size_t coreFeatures = 0);
 
   FVector& operator=( const FVector& rhs ) {
+#ifndef MAX_NUM_DENSE_FEATURES
     m_features = rhs.m_features;
+#endif
     m_coreFeatures = rhs.m_coreFeatures;
     return *this;
   }
@@ -184,7 +271,7 @@ public:
     return m_coreFeatures.size();
   }
 
-  const std::valarray<FValue> &getCoreFeatures() const {
+  const FCoreValues &getCoreFeatures() const {
     return m_coreFeatures;
   }
 
@@ -271,9 +358,10 @@ private:
   const FValue& get(const FName& name) const;
   FValue getBackoff(const FName& name, float backoff) const;
   void set(const FName& name, const FValue& value);
+  FValue& sparse(const FName& name);
 
   FNVmap m_features;
-  std::valarray<FValue> m_coreFeatures;
+  FCoreValues m_coreFeatures;
 
 #ifdef MPI_ENABLE
   //serialization
@@ -314,7 +402,10 @@ private:
 
 inline void swap(FVector &first, FVector &second)
 {
+  using std::swap;
+#ifndef MAX_NUM_DENSE_FEATURES
   swap(first.m_features, second.m_features);
+#endif
   swap(first.m_coreFeatures, second.m_coreFeatures);
 }
 
@@ -367,15 +458,15 @@ public:
    }*/
 
   FValue operator++() {
-    return ++m_fv->m_features[m_name];
+    return ++m_fv->sparse(m_name);
   }
 
   FValue operator +=(FValue lhs) {
-    return (m_fv->m_features[m_name] += lhs);
+    return (m_fv->sparse(m_name) += lhs);
   }
 
   FValue operator -=(FValue lhs) {
-    return (m_fv->m_features[m_name] -= lhs);
+    return (m_fv->sparse(m_name) -= lhs);
   }
 
 private:
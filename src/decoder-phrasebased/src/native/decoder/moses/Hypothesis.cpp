@@ -95,6 +95,17 @@ Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const
   m_wordDeleted = transOpt.IsDeletionOption();
 }
 
+void
+Hypothesis::
+CreateScoreBreakdown() const
+{
+  m_scoreBreakdown.reset(new (m_manager.GetArena()) ScoreComponentCollection);
+  m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
+  if (m_prevHypo) {
+    m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
+  }
+}
+
 Hypothesis::
 ~Hypothesis()
 {
@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
 #include "ObjectPool.h"
+#include "ArenaObject.h"
 #include "xmlrpc-c.h"
 
 namespace Moses
@@ -61,8 +62,11 @@ typedef std::vector<Hypothesis*> ArcList;
 
 		The expansion of hypotheses is handled in the class Manager, which
     stores active hypothesis in the search in hypothesis stacks.
+
+    Hypotheses are allocated in the arena of their Manager:
+    new (manager.GetArena()) Hypothesis(...)
 ***/
-class Hypothesis
+class Hypothesis : public ArenaObject
 {
   friend std::ostream& operator<<(std::ostream&, const Hypothesis&);
 protected:
@@ -85,6 +89,8 @@ protected:
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
 
+  void CreateScoreBreakdown() const;
+
 public:
   /*! used by initial seeding of the translation process */
   Hypothesis(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt, const Bitmap &bitmap, int id);
@@ -209,13 +215,8 @@ public:
     return m_arcList;
   }
   const ScoreComponentCollection& GetScoreBreakdown() const {
-    if (!m_scoreBreakdown) {
-      m_scoreBreakdown.reset(new ScoreComponentCollection);
-      m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
-      if (m_prevHypo) {
-        m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
-      }
-    }
+    if (!m_scoreBreakdown)
+      CreateScoreBreakdown();
     return *(m_scoreBreakdown.get());
   }
   float GetFutureScore() const {
@@ -33,6 +33,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #define ParseWord(w) (boost::lexical_cast<wid_t>((w)))
 
+// Word ids are parsed once, when the factor is created
+static inline wid_t GetWordId(const Moses::Factor *factor) {
+    size_t value = factor->GetNumericValue();
+    return value <= std::numeric_limits<wid_t>::max() ? (wid_t) value : ParseWord(factor->GetString().as_string());
+}
+
 using namespace std;
 using namespace Moses;
 
@@ -45,32 +51,38 @@ namespace Moses {
 
     public:
         size_t hash() const {
-            return state->hash();
+            return state.hash();
         }
 
         bool operator==(const FFState &o) const {
             const ILMState &other = static_cast<const ILMState &>(o);
-            return (*state == *(other.state));
+            return state == other.state;
         }
 
-        ILMState(HistoryKey *st) : state(st) {}
+        ILMState(const context_t *context) : context(context) {}
 
-        ILMState(shared_ptr<HistoryKey> &st) : state(st) {}
+        ILMState(const HistoryKey &st, const context_t *context) : state(st), context(context) {}
 
     private:
-        shared_ptr<HistoryKey> state;
+        HistoryKey state;
+
+        // The context of the sentence, owned by the thread that started its translation:
+        // it is propagated through the states because the hypotheses can be expanded
+        // by other threads (see SearchWorkers)
+        const context_t *context;
     };
 
     // friend
     ostream &operator<<(ostream &out, const ILMState &obj) {
-        out << " obj.state:|" << obj.state << "|";
+        out << " obj.state:|" << obj.state.hash() << "|";
         return out;
     }
 
 }
 
 
-MMTInterpolatedLM::MMTInterpolatedLM(const std::string &line) : LanguageModelSingleFactor(line) {
+MMTInterpolatedLM::MMTInterpolatedLM(const std::string &line) : LanguageModelSingleFactor(line), m_lm(NULL),
+                                                               m_cached_lm(NULL) {
     // must be 0 as default if 'order' not overridden from feature line.
     this->m_nGramOrder = 0;
 
@@ -89,6 +101,7 @@ MMTInterpolatedLM::MMTInterpolatedLM(const std::string &line) : LanguageModelSin
 }
 
 MMTInterpolatedLM::~MMTInterpolatedLM() {
+    delete m_cached_lm;
     delete m_lm;
 }
 
@@ -105,12 +118,16 @@ void MMTInterpolatedLM::Load(AllOptions::ptr const &opts) {
         m_nGramOrder = min(m_nGramOrder, (size_t) lm_options.order);
 
     m_lm = new InterpolatedLM(m_modelPath, lm_options);
+    m_cached_lm = new CachedLM(m_lm, 5);
 }
 
 const FFState *MMTInterpolatedLM::EmptyHypothesisState(const InputType &/*input*/) const {
     vector<wid_t> phrase(1);
     phrase[0] = kVocabularyStartSymbol;
-    return new ILMState(m_lm->MakeHistoryKey(phrase));
+
+    ILMState *state = new ILMState(t_context_vec.get());
+    m_lm->MakeHistoryKey(phrase, &state->state);
+    return state;
 }
 
 void
@@ -120,7 +137,7 @@ MMTInterpolatedLM::TransformPhrase(const Phrase &phrase, std::vector<wid_t> &phr
         phrase_vec.push_back(kVocabularyStartSymbol); //insert start symbol
     }
     for (size_t i = 0; i < phrase.GetSize(); ++i) {
-        wid_t id = ParseWord(phrase.GetWord(i).GetString(m_factorType).as_string());
+        wid_t id = GetWordId(phrase.GetWord(i)[m_factorType]);
         phrase_vec.push_back(id);
     }
     for (size_t i = 0; i < endGaps; ++i) {
@@ -136,7 +153,7 @@ MMTInterpolatedLM::SetWordVector(const Hypothesis &hypo, std::vector<wid_t> &phr
     }
 
     for (size_t position = from; position < to; ++position) {
-        phrase_vec.push_back(ParseWord(hypo.GetWord(position).GetString(m_factorType).as_string()));
+        phrase_vec.push_back(GetWordId(hypo.GetWord(position)[m_factorType]));
     }
 
     for (size_t i = 0; i < endGaps; ++i) {
@@ -189,15 +206,14 @@ MMTInterpolatedLM::CalcScore(const Phrase &phrase, float &fullScore, float &ngra
                         context_vec->size() << "|" << std::endl);
     }
 
-    CachedLM *lm = t_cached_lm.get();
+    CachedLM *lm = m_cached_lm;
 
-    HistoryKey *cursorHistoryKey = lm->MakeEmptyHistoryKey();
-    for (size_t position = 0; position < phrase_vec.size(); ++position) {
-        HistoryKey *outHistoryKey = NULL;
-        double prob = lm->ComputeProbability(phrase_vec.at(position), cursorHistoryKey, context_vec, &outHistoryKey);
+    HistoryKey cursorHistoryKey;
+    lm->MakeEmptyHistoryKey(&cursorHistoryKey);
 
-        delete cursorHistoryKey;
-        cursorHistoryKey = outHistoryKey;
+    for (size_t position = 0; position < phrase_vec.size(); ++position) {
+        double prob = lm->ComputeProbability(phrase_vec.at(position), &cursorHistoryKey, context_vec,
+                                             &cursorHistoryKey);
 
         fullScore += prob;
         if (position >= boundary) {
@@ -205,8 +221,6 @@ MMTInterpolatedLM::CalcScore(const Phrase &phrase, float &fullScore, float &ngra
         }
     }
 
-    delete cursorHistoryKey;
-
     if (OOVFeatureEnabled()) {
         for (size_t position = 0; position < phrase_vec.size(); ++position) {
             // verifying whether the actual word is an OOV, and in case increase the oovCount
@@ -222,10 +236,10 @@ FFState *MMTInterpolatedLM::EvaluateWhenApplied(const Hypothesis &hypo, const FF
             "FFState* MMTInterpolatedLM::EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const"
                     << std::endl);
 
-    if (hypo.GetCurrTargetLength() == 0) {
-        ILMState *inState = (ILMState *) ps;
-        return new ILMState(inState->state);
-    }
+    const ILMState *inState = static_cast<const ILMState *>(ps);
+
+    if (hypo.GetCurrTargetLength() == 0)
+        return new ILMState(inState->state, inState->context);
 
     //[begin, end) in STL-like fashion.
     const int begin = (const int) hypo.GetCurrTargetWordsRange().GetStartPos();
@@ -240,7 +254,7 @@ FFState *MMTInterpolatedLM::EvaluateWhenApplied(const Hypothesis &hypo, const FF
     std::vector<wid_t> phrase_vec;
     SetWordVector(hypo, phrase_vec, 0, 0, begin, adjust_end);
 
-    context_t *context_vec = t_context_vec.get();
+    const context_t *context_vec = inState->context;
     if (context_vec == nullptr) {
         VERBOSE(4, "void MMTInterpolatedLM::EvaluateWhenApplied(const Phrase &phrase, ...) const context is null"
                 << std::endl);
@@ -255,21 +269,16 @@ FFState *MMTInterpolatedLM::EvaluateWhenApplied(const Hypothesis &hypo, const FF
                         context_vec->size() << "|" << std::endl);
     }
 
-    CachedLM *lm = t_cached_lm.get();
+    CachedLM *lm = m_cached_lm;
     double score = 0.0;
 
-    const ILMState *inState = static_cast<const ILMState *>(ps);
-    HistoryKey *initialState = inState->state.get();
-    HistoryKey *cursorHistoryKey = NULL;
+    // The state is computed in place, inside the new FFState
+    ILMState *outState = new ILMState(inState->state, context_vec);
+    HistoryKey &cursorHistoryKey = outState->state;
 
     for (size_t position = 0; position < phrase_vec.size(); ++position) {
-        HistoryKey *outHistoryKey;
-        double prob = lm->ComputeProbability(phrase_vec.at(position),
-                                             cursorHistoryKey ? cursorHistoryKey : initialState,
-                                             context_vec, &outHistoryKey);
-        if (cursorHistoryKey)
-            delete cursorHistoryKey;
-        cursorHistoryKey = outHistoryKey;
+        double prob = lm->ComputeProbability(phrase_vec.at(position), &cursorHistoryKey, context_vec,
+                                             &cursorHistoryKey);
         score += prob;
     }
 
@@ -287,15 +296,9 @@ FFState *MMTInterpolatedLM::EvaluateWhenApplied(const Hypothesis &hypo, const FF
         //if the phrase is too short, one StartSentenceSymbol (see startGaps) is added
         SetWordVector(hypo, ngram_vec, startGaps, 0, adjust_begin, end);
 
-        HistoryKey *outHistoryKey;
-
-        HistoryKey *tmpHistoryKey = lm->MakeHistoryKey(ngram_vec);
-        score += lm->ComputeProbability(kVocabularyEndSymbol, tmpHistoryKey, t_context_vec.get(), &outHistoryKey);
-        delete tmpHistoryKey;
-
-        if (cursorHistoryKey)
-            delete cursorHistoryKey;
-        cursorHistoryKey = outHistoryKey;
+        HistoryKey tmpHistoryKey;
+        lm->MakeHistoryKey(ngram_vec, &tmpHistoryKey);
+        score += lm->ComputeProbability(kVocabularyEndSymbol, &tmpHistoryKey, context_vec, &cursorHistoryKey);
     } else {
         // need to set the LM state
         if (adjust_end < end) { // the LMstate of this target phrase refers to the last m_lmtb_size-1 words
@@ -310,23 +313,21 @@ FFState *MMTInterpolatedLM::EvaluateWhenApplied(const Hypothesis &hypo, const FF
             // the relevant words for the state contain the StartSentenceSymbol
             SetWordVector(hypo, ngram_vec, 0, 0, adjust_begin, end);
 
-            if (cursorHistoryKey)
-                delete cursorHistoryKey;
-            cursorHistoryKey = lm->MakeHistoryKey(ngram_vec);
+            lm->MakeHistoryKey(ngram_vec, &cursorHistoryKey);
         }
     }
 
     out->PlusEquals(this, score); // score is already expressed as natural log probability
 
-    return new ILMState(cursorHistoryKey);
+    return outState;
 }
 
 void MMTInterpolatedLM::InitializeForInput(ttasksptr const &ttask) {
 #ifdef TRACE_CACHE
     m_lmtb->sentence_id++;
 #endif
-    // we assume here that translation is run in one single thread for each ttask
-    // (no parallelization at a finer granularity involving MMT InterpolatedLM)
+    // the context is thread-specific: the hypotheses expanded by other threads
+    // (see SearchWorkers) find it in the states, see EmptyHypothesisState()
 
     // This function is called prior to actual translation and allows the class
     // to set up thread-specific information such as context weights
@@ -337,22 +338,27 @@ void MMTInterpolatedLM::InitializeForInput(ttasksptr const &ttask) {
     SPTR<weightmap_t const> weights = scope->GetContextWeights();
 
     if (weights) {
-        context_t *context_vec = new context_t;
+        // The normalized context is stored in the scope, so that the sentences of a batch
+        // (that share the same scope) normalize it only once
+        SPTR<context_t> normalized = scope->get<context_t>(this);
 
-        for (weightmap_t::const_iterator it = weights->begin(); it != weights->end(); ++it) {
-            context_vec->push_back(cscore_t(ParseWord(it->first), it->second));
+        if (!normalized) {
+            normalized.reset(new context_t);
+
+            for (weightmap_t::const_iterator it = weights->begin(); it != weights->end(); ++it) {
+                normalized->push_back(cscore_t(ParseWord(it->first), it->second));
+            }
+
+            m_lm->NormalizeContext(normalized.get());
+            scope->set(this, normalized);
         }
 
-        m_lm->NormalizeContext(context_vec);
-        t_context_vec.reset(context_vec);
+        t_context_vec.reset(new context_t(*normalized));
     }
-
-    t_cached_lm.reset(new CachedLM(m_lm, 5));
 }
 
 void MMTInterpolatedLM::CleanUpAfterSentenceProcessing(const InputType &source) {
     t_context_vec.reset();
-    t_cached_lm.reset();
 }
 
 void MMTInterpolatedLM::SetParameter(const std::string &key, const std::string &value) {
@@ -362,6 +368,10 @@ void MMTInterpolatedLM::SetParameter(const std::string &key, const std::string &
     } else if (key == "adaptivity-ratio") {
         lm_options.adaptivity_ratio = Scan<float>(value);
         VERBOSE(3, "lm_options.adaptivity_ratio:" << lm_options.adaptivity_ratio << std::endl);
+    } else if (key == "hot-tier-domains") {
+        lm_options.hot_tier_domains = Scan<size_t>(value);
+    } else if (key == "cache-size") {
+        lm_options.cache_size = Scan<size_t>(value);
     } else if (key == "quantization") {
         lm_options.static_lm.quantization_bits = (uint8_t) Scan<unsigned>(value);
     } else if (key == "compression") {
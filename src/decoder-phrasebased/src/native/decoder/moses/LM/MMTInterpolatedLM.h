@@ -52,12 +52,12 @@ namespace Moses {
 
     protected:
         InterpolatedLM *m_lm;
+        CachedLM *m_cached_lm;
         string m_modelPath;
         mmt::ilm::Options lm_options;
 
 #ifdef WITH_THREADS
         boost::thread_specific_ptr<context_t> t_context_vec;
-        boost::thread_specific_ptr<CachedLM> t_cached_lm;
 #else
         boost::scoped_ptr<context_t> *t_context_vec;
 #endif
@@ -64,11 +64,17 @@ using namespace std;
 namespace Moses
 {
 
+thread_local util::Pool *Manager::s_workerArena = NULL;
+
 Manager::Manager(ttasksptr const& ttask)
   : BaseManager(ttask)
   , interrupted_flag(0)
   , m_hypoId(0)
 {
+  // the objects created for this sentence by the phrase tables
+  // and the translation options collection go in the arena
+  ttask->SetArena(&m_arena);
+
   boost::shared_ptr<InputType> source = ttask->GetSource();
   m_transOptColl = source->CreateTranslationOptionCollection(ttask);
 
@@ -90,7 +96,12 @@ Manager::~Manager()
 {
   delete m_transOptColl;
   delete m_search;
-  StaticData::Instance().CleanUpAfterSentenceProcessing(m_ttask.lock());
+
+  ttasksptr ttask = m_ttask.lock();
+  StaticData::Instance().CleanUpAfterSentenceProcessing(ttask);
+
+  if (ttask)
+    ttask->SetArena(NULL);
 }
 
 const InputType&
@@ -1427,7 +1438,8 @@ const Hypothesis *Manager::GetBestHypothesis() const
 
 int Manager::GetNextHypoId()
 {
-  GetSentenceStats().AddCreated(); // count created hypotheses
+  // may be called concurrently by SearchWorkers, that are disabled with verbose >= 2
+  IFVERBOSE(2) GetSentenceStats().AddCreated(); // count created hypotheses
   return m_hypoId++;
 }
 
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_Manager_h
 #define moses_Manager_h
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <list>
@@ -36,6 +37,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Search.h"
 #include "SearchCubePruning.h"
 #include "BaseManager.h"
+#include "util/pool.hh"
 #include "MosesDecoder.h"
 
 namespace Moses
@@ -114,13 +116,19 @@ private:
 
 protected:
   // data
+  // owns the memory of the hypotheses, translation options and target phrases of
+  // this sentence: it is released all at once, after all of them have been destroyed
+  util::Pool m_arena;
   TranslationOptionCollection *m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   Search *m_search;
 
   HypothesisStack* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
   size_t interrupted_flag;
   std::unique_ptr<SentenceStats> m_sentenceStats;
-  int m_hypoId; //used to number the hypos as they are created.
+  std::atomic<int> m_hypoId; //used to number the hypos as they are created.
+
+  // arena of the thread expanding hypotheses on behalf of SearchWorkers, if any
+  static thread_local util::Pool *s_workerArena;
 
   void GetConnectedGraph(
     std::map< int, bool >* pConnected,
@@ -178,6 +186,15 @@ public:
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
 
+  // the helper threads of a parallel search (see SearchWorkers) have their own arena
+  util::Pool *GetArena() {
+    return s_workerArena ? s_workerArena : &m_arena;
+  }
+
+  static void SetWorkerArena(util::Pool *arena) {
+    s_workerArena = arena;
+  }
+
   void OutputLatticeMBRNBest(std::ostream& out, const std::vector<LatticeMBRSolution>& solutions,long translationId) const;
   void OutputBestHypo(const std::vector<Moses::Word>&  mbrBestHypo, std::ostream& out) const;
   void OutputBestHypo(const Moses::TrellisPath &path, std::ostream &out) const;
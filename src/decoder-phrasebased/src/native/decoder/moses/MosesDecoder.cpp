@@ -2,7 +2,10 @@
 // Created by Davide  Caroselli on 03/12/15.
 //
 
+#include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <unordered_map>
 
 #include "MosesDecoder.h"
@@ -12,6 +15,7 @@
 #include "ContextScope.h"
 #include "Manager.h"
 #include "IOWrapper.h"
+#include "ThreadPool.h"
 #include "FF/StatefulFeatureFunction.h"
 
 using namespace std;
@@ -24,6 +28,7 @@ namespace mmt {
         class MosesDecoderImpl : public MosesDecoder {
             std::vector<feature_t> m_features;
             std::vector<IncrementalModel *> m_incrementalModels;
+            Moses::ThreadPool m_pool;
 
         public:
 
@@ -40,6 +45,10 @@ namespace mmt {
                                             const std::map<std::string, float> *translationContext,
                                             size_t nbestListSize) override;
 
+            virtual std::vector<translation_t> translateBatch(const std::vector<std::string> &texts,
+                                                              const std::map<std::string, float> *translationContext,
+                                                              size_t nbestListSize) override;
+
             virtual const vector<IncrementalModel *> &GetIncrementalModels() const override;
         };
     }
@@ -61,7 +70,8 @@ MosesDecoder *MosesDecoder::createInstance(const char *inifile, Aligner *aligner
     return new MosesDecoderImpl(params);
 }
 
-MosesDecoderImpl::MosesDecoderImpl(Moses::Parameter &param) : m_features() {
+MosesDecoderImpl::MosesDecoderImpl(Moses::Parameter &param)
+        : m_features(), m_pool((size_t) Moses::StaticData::Instance().ThreadCount()) {
     const std::vector<const Moses::StatelessFeatureFunction *> &slf = Moses::StatelessFeatureFunction::GetStatelessFeatureFunctions();
     for (size_t i = 0; i < slf.size(); ++i) {
         const Moses::FeatureFunction *feature = slf[i];
@@ -120,7 +130,10 @@ void MosesDecoderImpl::setDefaultFeatureWeights(const std::map<std::string, std:
 }
 
 static void
-DoTranslate(translation_request_t const &request, boost::shared_ptr<Moses::ContextScope> scope, translation_t &result) {
+DoTranslate(translation_request_t const &request, boost::shared_ptr<Moses::ContextScope> scope,
+            Moses::ThreadPool *pool, translation_t &result) {
+    auto begin = std::chrono::steady_clock::now();
+
     boost::shared_ptr<Moses::AllOptions> opts(new Moses::AllOptions());
     *opts = *Moses::StaticData::Instance().options();
 
@@ -134,6 +147,7 @@ DoTranslate(translation_request_t const &request, boost::shared_ptr<Moses::Conte
     boost::shared_ptr<Moses::IOWrapper> ioWrapperNone;
 
     boost::shared_ptr<Moses::TranslationTask> ttask = Moses::TranslationTask::create(source, ioWrapperNone, scope);
+    ttask->SetThreadPool(pool); // idle threads help to expand the hypotheses of long sentences
 
     // note: ~Manager() must run while we still own TranslationTask (because it only has a weak_ptr)
     {
@@ -146,11 +160,12 @@ DoTranslate(translation_request_t const &request, boost::shared_ptr<Moses::Conte
         if (manager.GetSource().options()->nbest.nbest_size)
             manager.OutputNBest(result.hypotheses);
     }
+
+    result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - begin).count();
 }
 
-translation_t MosesDecoderImpl::translate(const std::string &text,
-                                          const std::map<std::string, float> *translationContext,
-                                          size_t nbestListSize) {
+static boost::shared_ptr<Moses::ContextScope> CreateScope(const std::map<std::string, float> *translationContext) {
     boost::shared_ptr<Moses::ContextScope> scope(
             new Moses::ContextScope(Moses::StaticData::Instance().GetAllWeightsNew()));
 
@@ -159,6 +174,14 @@ translation_t MosesDecoderImpl::translate(const std::string &text,
         scope->SetContextWeights(cw);
     }
 
+    return scope;
+}
+
+translation_t MosesDecoderImpl::translate(const std::string &text,
+                                          const std::map<std::string, float> *translationContext,
+                                          size_t nbestListSize) {
+    boost::shared_ptr<Moses::ContextScope> scope = CreateScope(translationContext);
+
     // Execute translation request
 
     translation_request_t request;
@@ -167,11 +190,88 @@ translation_t MosesDecoderImpl::translate(const std::string &text,
     request.sourceSent = text;
     request.nBestListSize = nbestListSize;
 
-    DoTranslate(request, scope, response);
+    DoTranslate(request, scope, &m_pool, response);
 
     return response;
 }
 
+namespace {
+
+    // Tracks the sentences of a batch still in progress and the first error raised by them
+    struct batch_state_t {
+        std::mutex mutex;
+        std::condition_variable completed;
+        size_t pending;
+        std::exception_ptr error;
+    };
+
+    class BatchTranslationTask : public Moses::Task {
+    public:
+        BatchTranslationTask(const translation_request_t &request, boost::shared_ptr<Moses::ContextScope> scope,
+                             Moses::ThreadPool *pool, translation_t *result, batch_state_t *state)
+                : request(request), scope(scope), pool(pool), result(result), state(state) {}
+
+        virtual void Run() override {
+            std::exception_ptr error;
+
+            try {
+                DoTranslate(request, scope, pool, *result);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+
+            if (error && !state->error)
+                state->error = error;
+
+            if (--state->pending == 0)
+                state->completed.notify_all();
+        }
+
+    private:
+        const translation_request_t request;
+        const boost::shared_ptr<Moses::ContextScope> scope;
+        Moses::ThreadPool *pool;
+        translation_t *result;
+        batch_state_t *state;
+    };
+
+}
+
+std::vector<translation_t> MosesDecoderImpl::translateBatch(const std::vector<std::string> &texts,
+                                                            const std::map<std::string, float> *translationContext,
+                                                            size_t nbestListSize) {
+    std::vector<translation_t> responses(texts.size());
+
+    if (texts.empty())
+        return responses;
+
+    // A single scope for the whole batch: the features store in it the state that depends
+    // only on the context (i.e. the normalized context weights), computed by the first sentence
+    boost::shared_ptr<Moses::ContextScope> scope = CreateScope(translationContext);
+
+    batch_state_t state;
+    state.pending = texts.size();
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+        translation_request_t request;
+        request.sourceSent = texts[i];
+        request.nBestListSize = nbestListSize;
+
+        m_pool.Submit(boost::shared_ptr<Moses::Task>(new BatchTranslationTask(request, scope, &m_pool, &responses[i],
+                                                                                &state)));
+    }
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.completed.wait(lock, [&state] { return state.pending == 0; });
+
+    if (state.error)
+        std::rethrow_exception(state.error);
+
+    return responses;
+}
+
 const vector<IncrementalModel *> &MosesDecoderImpl::GetIncrementalModels() const {
     return m_incrementalModels;
 }
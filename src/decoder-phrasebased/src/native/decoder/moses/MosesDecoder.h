@@ -33,6 +33,7 @@ typedef struct {
     int64_t session;
     std::vector<hypothesis_t> hypotheses;
     std::vector<std::pair<size_t, size_t> > alignment;
+    int64_t elapsed; //< decoding time in milliseconds
 } translation_t;
 
 typedef struct {
@@ -75,6 +76,21 @@ namespace mmt {
                                             const std::map<std::string, float> *translationContext,
                                             size_t nbestListSize) = 0;
 
+            /**
+             * Translate a batch of sentences sharing the same context.
+             *
+             * The sentences are decoded in parallel by the decoder's own thread pool; all of them
+             * share a single context scope, so the context is parsed and normalized only once.
+             *
+             * @param texts               source sentences with space-separated tokens
+             * @param translationContext  context weights, shared by all the sentences
+             * @param nbestListSize       if non-zero, produce an n-best list of this size in every translation_t result
+             * @return the translations, in the same order of texts
+             */
+            virtual std::vector<translation_t> translateBatch(const std::vector<std::string> &texts,
+                                                              const std::map<std::string, float> *translationContext,
+                                                              size_t nbestListSize) = 0;
+
             /**
              * Returns the list of internal incremental models.
              *
@@ -87,6 +87,8 @@ Parameter::Parameter()
   AddParam(search_opts,"early-discarding-threshold", "edt", "threshold for constructing hypotheses based on estimate cost");
   AddParam(search_opts,"stack", "s", "maximum stack size for histogram pruning. 0 = unlimited stack size");
   AddParam(search_opts,"stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
+  AddParam(search_opts,"search-threads", "number of threads expanding the hypotheses of a single sentence (default 1, no intra-sentence parallelism)");
+  AddParam(search_opts,"search-threads-min-length", "minimum sentence length for which search-threads are used (default 40)");
 
   // feature weight-related options
   AddParam(search_opts,"weight-file", "wf", "feature weights file. Do *not* put weights for 'core' features in here - they go in moses.ini");
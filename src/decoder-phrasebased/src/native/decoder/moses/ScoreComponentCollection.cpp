@@ -73,6 +73,11 @@ RegisterScoreProducer(FeatureFunction* scoreProducer)
 {
   size_t start = s_denseVectorSize;
   s_denseVectorSize = scoreProducer->SetIndex(s_denseVectorSize);
+#ifdef MAX_NUM_DENSE_FEATURES
+  UTIL_THROW_IF2(s_denseVectorSize > FCoreValues::kCapacity,
+                 "Feature " << scoreProducer->GetScoreProducerDescription() << " exceeds MAX_NUM_DENSE_FEATURES ("
+                 << FCoreValues::kCapacity << " < " << s_denseVectorSize << ")");
+#endif
   VERBOSE(1, "FeatureFunction: "
           << scoreProducer->GetScoreProducerDescription()
           << " start: " << start
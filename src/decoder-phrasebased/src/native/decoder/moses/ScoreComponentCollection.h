@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "Util.h"
 #include "util/exception.hh"
+#include "ArenaObject.h"
 
 namespace Moses
 {
@@ -84,7 +85,7 @@ struct ScorePair {
  * representing that score must extend the ScoreProducer abstract base class.  For an example
  * refer to the DistortionScoreProducer class.
  */
-class ScoreComponentCollection
+class ScoreComponentCollection : public ArenaObject
 {
   friend std::ostream& operator<<(std::ostream& os, const ScoreComponentCollection& rhs);
   friend void swap(ScoreComponentCollection &first, ScoreComponentCollection &second);
@@ -154,7 +155,7 @@ public:
     return m_scores;
   }
 
-  const std::valarray<FValue> &getCoreFeatures() const {
+  const FCoreValues &getCoreFeatures() const {
     return m_scores.getCoreFeatures();
   }
 
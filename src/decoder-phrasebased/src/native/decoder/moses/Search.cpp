@@ -14,6 +14,8 @@ Search::Search(Manager& manager)
   , m_inputPath()
   , m_initialTransOpt(manager.GetTtask())
   , m_bitmaps(manager.GetSource().GetSize(), manager.GetSource().m_sourceCompleted)
+  , m_workers(manager, manager.GetSource().GetSize() >= m_options.search.threads_min_length ?
+              m_options.search.threads : 1)
   , interrupted_flag(0)
 {
   m_initialTransOpt.SetInputPath(m_inputPath);
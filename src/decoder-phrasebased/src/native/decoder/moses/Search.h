@@ -7,6 +7,7 @@
 #include "Phrase.h"
 #include "InputPath.h"
 #include "Bitmaps.h"
+#include "SearchWorkers.h"
 
 namespace Moses
 {
@@ -46,6 +47,7 @@ protected:
   InputPath m_inputPath; // for initial hypo
   TranslationOption m_initialTransOpt; /**< used to seed 1st hypo */
   Bitmaps m_bitmaps;
+  SearchWorkers m_workers; //! threads expanding the hypotheses (see search-threads)
 
   /** flag indicating that decoder ran out of time (see switch -time-out) */
   size_t interrupted_flag;
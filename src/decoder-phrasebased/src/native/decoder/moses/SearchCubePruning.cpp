@@ -4,6 +4,7 @@
 #include "StaticData.h"
 #include "InputType.h"
 #include "TranslationOptionCollection.h"
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 using namespace std;
 
@@ -78,7 +79,7 @@ void SearchCubePruning::Decode()
 {
   // initial seed hypothesis: nothing translated, no words produced
   const Bitmap &initBitmap = m_bitmaps.GetInitialBitmap();
-  Hypothesis *hypo = new Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
+  Hypothesis *hypo = new (m_manager.GetArena()) Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
 
   HypothesisStackCubePruning &firstStack
   = *static_cast<HypothesisStackCubePruning*>(m_hypoStackColl.front());
@@ -114,7 +115,22 @@ void SearchCubePruning::Decode()
     _BMType::const_iterator bmIter;
     const _BMType &accessor = sourceHypoColl.GetBitmapAccessor();
 
+    // the containers are independent: build their first hypotheses with the SearchWorkers
+    if (m_workers.GetNumWorkers() > 1) {
+      std::vector<BitmapContainer*> containers;
+      for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter)
+        containers.push_back(bmIter->second);
+
+      m_workers.Run(containers.size(), boost::bind(&SearchCubePruning::InitializeEdges,
+                    boost::cref(containers), _1));
+    }
+
     for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter) {
+      if (m_workers.GetNumWorkers() > 1) {
+        BCQueue.push(bmIter->second);
+        continue;
+      }
+
       // build the first hypotheses
       IFVERBOSE(2) {
         m_manager.GetSentenceStats().StartTimeOtherScore();
@@ -192,6 +208,11 @@ void SearchCubePruning::Decode()
   }
 }
 
+void SearchCubePruning::InitializeEdges(const std::vector<BitmapContainer*> &containers, size_t index)
+{
+  containers[index]->InitializeEdges();
+}
+
 void SearchCubePruning::CreateForwardTodos(HypothesisStackCubePruning &stack)
 {
   const _BMType &bitmapAccessor = stack.GetBitmapAccessor();
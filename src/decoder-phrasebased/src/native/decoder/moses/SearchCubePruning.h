@@ -22,6 +22,9 @@ protected:
   // no of elements = no of words in source + 1
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
 
+  //! build the first hypotheses of a bitmap container (job of the SearchWorkers)
+  static void InitializeEdges(const std::vector<BitmapContainer*> &containers, size_t index);
+
   //! go thru all bitmaps in 1 stack & create backpointers to bitmaps in the stack
   void CreateForwardTodos(HypothesisStackCubePruning &stack);
   //! create a back pointer to this bitmap, with edge that has this words range translation
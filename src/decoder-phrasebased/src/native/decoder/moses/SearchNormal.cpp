@@ -4,6 +4,7 @@
 #include "SentenceStats.h"
 #include "TranslationTask.h"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
 using namespace std;
@@ -60,14 +61,51 @@ ProcessOneStack(HypothesisStack* hstack)
   sourceHypoColl.CleanupArcList();
   IFVERBOSE(2)  stats.StopTimeStack();
 
+  if (m_workers.GetNumWorkers() > 1) {
+    ExpandStackInParallel(sourceHypoColl);
+    return true;
+  }
+
   // go through each hypothesis on the stack and try to expand it
   // BOOST_FOREACH(Hypothesis* h, sourceHypoColl)
   HypothesisStackNormal::const_iterator h;
   for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h)
-    ProcessOneHypothesis(**h);
+    ProcessOneHypothesis(**h, NULL);
   return true;
 }
 
+/**
+ * Expand the hypotheses of a stack with the SearchWorkers: every hypothesis
+ * collects its expansions in its own list of candidates, then the candidates
+ * are added to the stacks (with recombination and pruning) in the same order
+ * of the sequential search.
+ */
+void
+SearchNormal::
+ExpandStackInParallel(const HypothesisStackNormal &hstack)
+{
+  std::vector<const Hypothesis*> hypotheses(hstack.begin(), hstack.end());
+  std::vector<Candidates> candidates(hypotheses.size());
+
+  m_workers.Run(hypotheses.size(), boost::bind(&SearchNormal::ExpandCandidates, this,
+                boost::cref(hypotheses), boost::ref(candidates), _1));
+
+  BOOST_FOREACH(const Candidates &list, candidates) {
+    BOOST_FOREACH(Hypothesis *newHypo, list) {
+      size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
+      m_hypoStackColl[wordsTranslated]->AddPrune(newHypo);
+    }
+  }
+}
+
+void
+SearchNormal::
+ExpandCandidates(const std::vector<const Hypothesis*> &hypotheses,
+                 std::vector<Candidates> &candidates, size_t index)
+{
+  ProcessOneHypothesis(*hypotheses[index], &candidates[index]);
+}
+
 
 /**
  * Main decoder loop that translates a sentence by expanding
@@ -77,7 +115,7 @@ void SearchNormal::Decode()
 {
   // initial seed hypothesis: nothing translated, no words produced
   const Bitmap &initBitmap = m_bitmaps.GetInitialBitmap();
-  Hypothesis *hypo = new Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
+  Hypothesis *hypo = new (m_manager.GetArena()) Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
 
   m_hypoStackColl[0]->AddPrune(hypo);
 
@@ -97,7 +135,7 @@ void SearchNormal::Decode()
  */
 void
 SearchNormal::
-ProcessOneHypothesis(const Hypothesis &hypothesis)
+ProcessOneHypothesis(const Hypothesis &hypothesis, Candidates *candidates)
 {
   // since we check for reordering limits, its good to have that limit handy
   bool isWordLattice = m_source.GetType() == WordLatticeInput;
@@ -125,7 +163,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
         }
 
         //TODO: does this method include incompatible WordLattice hypotheses?
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, candidates);
       }
     }
     return; // done with special case (no reordering limit)
@@ -202,7 +240,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
       if (isLeftMostEdge) {
         // any length extension is okay if starting at left-most edge
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, candidates);
       } else { // starting somewhere other than left-most edge, use caution
         // the basic idea is this: we would like to translate a phrase
         // starting from a position further right than the left-most
@@ -218,7 +256,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
             > m_options.reordering.max_distortion) continue;
 
         // everything is fine, we're good to go
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, candidates);
       }
     }
   }
@@ -234,7 +272,8 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
 void
 SearchNormal::
-ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos)
+ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos,
+                    Candidates *candidates)
 {
   // early discarding: check if hypothesis is too bad to build
   // this idea is explained in (Moore&Quirk, MT Summit 2007)
@@ -264,7 +303,7 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
   TranslationOptionList::const_iterator iter;
   for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
     const TranslationOption &transOpt = **iter;
-    ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap);
+    ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap, candidates);
   }
 }
 
@@ -281,7 +320,8 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
                                     const TranslationOption &transOpt,
                                     float expectedScore,
                                     float estimatedScore,
-                                    const Bitmap &bitmap)
+                                    const Bitmap &bitmap,
+                                    Candidates *candidates)
 {
   SentenceStats &stats = m_manager.GetSentenceStats();
 
@@ -291,7 +331,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     IFVERBOSE(2) {
       stats.StartTimeBuildHyp();
     }
-    newHypo = new Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
+    newHypo = new (m_manager.GetArena()) Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
     IFVERBOSE(2) {
       stats.StopTimeBuildHyp();
     }
@@ -342,7 +382,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     IFVERBOSE(2) {
       stats.StartTimeBuildHyp();
     }
-    newHypo = new Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
+    newHypo = new (m_manager.GetArena()) Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
     if (newHypo==NULL) return;
     IFVERBOSE(2) {
       stats.StopTimeBuildHyp();
@@ -364,6 +404,11 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     newHypo->PrintHypothesis();
   }
 
+  if (candidates) {
+    candidates->push_back(newHypo);
+    return;
+  }
+
   // add to hypothesis stack
   size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
   IFVERBOSE(2) {
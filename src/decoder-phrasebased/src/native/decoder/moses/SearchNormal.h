@@ -30,23 +30,36 @@ protected:
   /** pre-computed list of translation options for the phrases in this sentence */
   const TranslationOptionCollection &m_transOptColl;
 
+  /** hypotheses created by a worker, added to the stacks once the whole stack is expanded */
+  typedef std::vector<Hypothesis*> Candidates;
+
   // functions for creating hypotheses
+  // (if "candidates" is NULL the new hypotheses are added to the stacks right away)
 
   virtual bool
   ProcessOneStack(HypothesisStack* hstack);
 
+  void
+  ExpandStackInParallel(const HypothesisStackNormal &hstack);
+
+  void
+  ExpandCandidates(const std::vector<const Hypothesis*> &hypotheses,
+                   std::vector<Candidates> &candidates, size_t index);
+
   virtual void
-  ProcessOneHypothesis(const Hypothesis &hypothesis);
+  ProcessOneHypothesis(const Hypothesis &hypothesis, Candidates *candidates);
 
   virtual void
-  ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
+  ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos,
+                      Candidates *candidates);
 
   virtual void
   ExpandHypothesis(const Hypothesis &hypothesis,
                    const TranslationOption &transOpt,
                    float expectedScore,
                    float estimatedScore,
-                   const Bitmap &bitmap);
+                   const Bitmap &bitmap,
+                   Candidates *candidates);
 
 public:
   SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl);
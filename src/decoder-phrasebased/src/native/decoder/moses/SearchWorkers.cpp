@@ -0,0 +1,174 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+//
+// Created by Davide  Caroselli on 30/06/17.
+//
+
+#include <algorithm>
+#include <exception>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+#include "SearchWorkers.h"
+#include "Manager.h"
+#include "ThreadPool.h"
+#include "TranslationTask.h"
+
+namespace Moses
+{
+
+//! State of a step, shared with the helpers that may start after it is over
+struct SearchWorkers::Step {
+  Job job;
+  size_t count;
+  util::Pool **arenas;
+
+  std::atomic<size_t> nextJob;
+  std::atomic<size_t> nextWorker;
+
+#ifdef WITH_THREADS
+  boost::mutex mutex;
+  boost::condition_variable completed;
+#endif
+  size_t done;
+  std::exception_ptr error;
+
+  Step(const Job &job, size_t count, util::Pool **arenas)
+    : job(job), count(count), arenas(arenas), nextJob(0), nextWorker(1), done(0) {}
+
+  //! run the job "first" (already taken) and then the others until none is left,
+  //! return the number of jobs run
+  size_t Work(size_t worker, size_t first) {
+    size_t executed = 0;
+
+    for (size_t i = first; i < count; i = nextJob++) {
+      try {
+        job(i, worker);
+      } catch (...) {
+#ifdef WITH_THREADS
+        boost::lock_guard<boost::mutex> lock(mutex);
+#endif
+        if (!error)
+          error = std::current_exception();
+      }
+
+      ++executed;
+    }
+
+    return executed;
+  }
+
+  void Complete(size_t executed) {
+    if (executed == 0)
+      return;
+
+#ifdef WITH_THREADS
+    boost::lock_guard<boost::mutex> lock(mutex);
+    done += executed;
+    if (done == count)
+      completed.notify_all();
+#else
+    done += executed;
+#endif
+  }
+};
+
+#ifdef WITH_THREADS
+class SearchWorkers::Helper : public Task
+{
+public:
+  Helper(const boost::shared_ptr<Step> &step, const boost::shared_ptr<std::atomic<size_t> > &queued)
+    : m_step(step), m_queued(queued) {}
+
+  virtual void Run() {
+    --*m_queued;
+
+    // nothing left to do: the step may already be over, do not touch the arenas
+    size_t first = m_step->nextJob++;
+    if (first >= m_step->count)
+      return;
+
+    // the step can not end before the job "first" is done
+    size_t worker = m_step->nextWorker++;
+
+    Manager::SetWorkerArena(m_step->arenas[worker]);
+    size_t executed = m_step->Work(worker, first);
+    Manager::SetWorkerArena(NULL);
+
+    m_step->Complete(executed);
+  }
+
+private:
+  const boost::shared_ptr<Step> m_step;
+  const boost::shared_ptr<std::atomic<size_t> > m_queued;
+};
+#endif
+
+SearchWorkers::SearchWorkers(Manager &manager, size_t numWorkers)
+  : m_pool(NULL)
+  , m_numWorkers(1)
+  , m_queuedHelpers(new std::atomic<size_t>(0))
+{
+#ifdef WITH_THREADS
+  ttasksptr ttask = manager.GetTtask();
+  m_pool = ttask ? ttask->GetThreadPool() : NULL;
+
+  // sentence statistics (verbose >= 2) are not thread safe
+  IFVERBOSE(2) m_pool = NULL;
+
+  if (m_pool != NULL && numWorkers > 1)
+    m_numWorkers = numWorkers;
+
+  // worker 0 (the calling thread) uses the arena of the Manager
+  m_arenas.resize(m_numWorkers, NULL);
+  for (size_t i = 1; i < m_numWorkers; ++i)
+    m_arenas[i] = new util::Pool();
+#endif
+}
+
+SearchWorkers::~SearchWorkers()
+{
+  for (size_t i = 0; i < m_arenas.size(); ++i)
+    delete m_arenas[i];
+}
+
+void SearchWorkers::Run(size_t count, const Job &job)
+{
+  if (count == 0)
+    return;
+
+  if (m_numWorkers == 1 || count == 1) {
+    for (size_t i = 0; i < count; ++i)
+      job(i, 0);
+    return;
+  }
+
+#ifdef WITH_THREADS
+  boost::shared_ptr<Step> step(new Step(job, count, &m_arenas[0]));
+
+  // do not flood the pool if the helpers of the previous steps are still queued
+  size_t helpers = std::min(m_numWorkers, count) - 1;
+  size_t queued = *m_queuedHelpers;
+  helpers = helpers > queued ? helpers - queued : 0;
+
+  for (size_t i = 0; i < helpers; ++i) {
+    ++*m_queuedHelpers;
+    m_pool->Submit(boost::shared_ptr<Task>(new Helper(step, m_queuedHelpers)));
+  }
+
+  step->Complete(step->Work(0, step->nextJob++));
+
+  // wait only for the jobs already taken by the helpers
+  {
+    boost::unique_lock<boost::mutex> lock(step->mutex);
+    while (step->done < step->count)
+      step->completed.wait(lock);
+  }
+
+  if (step->error)
+    std::rethrow_exception(step->error);
+#endif
+}
+
+}
@@ -0,0 +1,62 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+//
+// Created by Davide  Caroselli on 30/06/17.
+//
+
+#ifndef moses_SearchWorkers_h
+#define moses_SearchWorkers_h
+
+#include <atomic>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include "util/pool.hh"
+
+namespace Moses
+{
+
+class Manager;
+class ThreadPool;
+
+/** Runs the independent jobs of a search step (e.g. the expansion of all the
+ * hypotheses of a stack) on several threads, for a single sentence.
+ *
+ * The thread decoding the sentence always takes part in the step. The other
+ * workers are tasks submitted to the ThreadPool that translates the sentences:
+ * they take jobs only if they start while the step is still running, so the
+ * search never waits for a thread that is busy with another sentence. Every
+ * helper allocates its hypotheses in its own arena (see Manager::GetArena()).
+ */
+class SearchWorkers
+{
+public:
+  //! job(index, worker): worker 0 is the calling thread
+  typedef boost::function<void(size_t, size_t)> Job;
+
+  SearchWorkers(Manager &manager, size_t numWorkers);
+  ~SearchWorkers();
+
+  //! number of threads running a step, including the calling one
+  size_t GetNumWorkers() const {
+    return m_numWorkers;
+  }
+
+  //! run job(i, worker) for every i in [0, count) and wait for all of them
+  void Run(size_t count, const Job &job);
+
+private:
+  struct Step;
+  class Helper;
+
+  ThreadPool *m_pool;
+  size_t m_numWorkers;
+  std::vector<util::Pool *> m_arenas; //! arena of each helper, indexed by worker
+  boost::shared_ptr<std::atomic<size_t> > m_queuedHelpers; //! helpers submitted but not started yet
+
+  SearchWorkers(const SearchWorkers &);
+  SearchWorkers &operator=(const SearchWorkers &);
+};
+
+}
+
+#endif
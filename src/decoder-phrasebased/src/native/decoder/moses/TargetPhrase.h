@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "AlignmentInfo.h"
 #include "AlignmentInfoCollection.h"
+#include "ArenaObject.h"
 #include "util/string_piece.hh"
 //#include "TranslationTask.h"
 
@@ -47,7 +48,7 @@ class PhraseDictionary;
 
 /** represents an entry on the target side of a phrase table (scores, translation, alignment)
  */
-class TargetPhrase: public Phrase
+class TargetPhrase: public Phrase, public ArenaObject
 {
 public:
   typedef std::map<FeatureFunction const*, boost::shared_ptr<Scores> > ScoreCache_t;
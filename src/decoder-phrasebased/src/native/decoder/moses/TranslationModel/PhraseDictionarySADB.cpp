@@ -1,9 +1,16 @@
 // vim:tabstop=2
+#include <limits>
 #include "PhraseDictionarySADB.h"
 #include "StaticData.h"
 #include "TranslationTask.h"
 
-#define ParseWord(w) (boost::lexical_cast<wid_t>((w)))
+#define ParseWord(w) (boost::lexical_cast<mmt::wid_t>((w)))
+
+// Word ids are parsed once, when the factor is created
+static inline mmt::wid_t GetWordId(const Moses::Factor *factor) {
+    size_t value = factor->GetNumericValue();
+    return value <= std::numeric_limits<mmt::wid_t>::max() ? (mmt::wid_t) value : ParseWord(factor->GetString().as_string());
+}
 
 using namespace std;
 using namespace Moses;
@@ -154,7 +161,7 @@ namespace Moses {
         vector<wid_t> result(phrase.GetSize());
 
         for (size_t i = 0; i < phrase.GetSize(); i++) {
-            result[i] = ParseWord(phrase.GetWord(i).GetString(m_input, false));
+            result[i] = GetWordId(phrase.GetWord(i)[m_input[0]]);
         }
 
         return result;
@@ -185,6 +192,10 @@ namespace Moses {
     PhraseDictionarySADB::MakeTargetPhraseCollection(ttasksptr const &ttask, Phrase const &sourcePhrase,
                                                      const vector<mmt::sapt::TranslationOption> &options) const {
         TargetPhraseCollection *tpc = new TargetPhraseCollection();
+        FactorCollection &factorCollection = FactorCollection::Instance();
+
+        // target phrases live as long as the translation options collection of the sentence
+        util::Pool *arena = ttask->GetArena();
 
         auto target_options_it = options.begin();
 
@@ -193,11 +204,11 @@ namespace Moses {
         for (target_options_it = options.begin();
              target_options_it != options.end(); ++target_options_it) {
 
-            TargetPhrase *tp = new TargetPhrase(ttask, this);
+            TargetPhrase *tp = new (arena) TargetPhrase(ttask, this);
             for (auto word_it = target_options_it->targetPhrase.begin();
                  word_it != target_options_it->targetPhrase.end(); ++word_it) {
                 Word w;
-                w.CreateFromString(Output, m_output, to_string(*word_it), false);
+                w.SetFactor(m_output[0], factorCollection.AddNumericFactor(*word_it));
                 tp->AddWord(w);
             }
             std::set<std::pair<size_t, size_t> > aln;
@@ -243,6 +254,12 @@ namespace Moses {
         } else if (key == "sample-limit") {
             pt_options.samples = Scan<int>(value);
             VERBOSE(3, "pt_options.sample:" << pt_options.samples << std::endl);
+        } else if (key == "lookup-threads") {
+            pt_options.lookup_threads = Scan<size_t>(value);
+            VERBOSE(3, "pt_options.lookup_threads:" << pt_options.lookup_threads << std::endl);
+        } else if (key == "options-cache-size") {
+            pt_options.cache_size = Scan<size_t>(value);
+            VERBOSE(3, "pt_options.cache_size:" << pt_options.cache_size << std::endl);
         } else if (key == "lr-func") {
             m_lr_func_name = Scan<std::string>(value);
             VERBOSE(3, "m_lr_func_name:" << m_lr_func_name << std::endl);
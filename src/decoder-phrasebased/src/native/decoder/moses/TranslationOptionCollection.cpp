@@ -59,6 +59,7 @@ TranslationOptionCollection(ttasksptr const& ttask,
   , m_maxNoTransOptPerCoverage(ttask->options()->search.max_trans_opt_per_cov)
   , m_translationOptionThreshold(ttask->options()->search.trans_opt_threshold)
   , m_max_phrase_length(ttask->options()->search.max_phrase_length)
+  , m_arena(ttask->GetArena())
 {
   // create 2-d vector
   size_t size = src.GetSize();
@@ -234,7 +235,7 @@ ProcessOneUnknownWord(const InputPath &inputPath, size_t sourcePos,
 
   targetPhrase.EvaluateInIsolation(sourcePhrase);
 
-  TranslationOption *transOpt = new TranslationOption(range, targetPhrase);
+  TranslationOption *transOpt = new (m_arena) TranslationOption(range, targetPhrase);
   transOpt->SetInputPath(inputPath);
   Add(transOpt);
 
@@ -402,7 +403,7 @@ CreateTranslationOptionsForRange
     TargetPhraseCollection::shared_ptr targetPhrases = inputPath.GetTargetPhrases(pdict);
 
     static_cast<const Tstep&>(dstep).ProcessInitialTranslation
-    (m_source, *oldPtoc, sPos, ePos, adhereTableLimit, inputPath, targetPhrases);
+    (m_source, *oldPtoc, sPos, ePos, adhereTableLimit, inputPath, targetPhrases, m_arena);
 
     SetInputScore(inputPath, *oldPtoc);
 
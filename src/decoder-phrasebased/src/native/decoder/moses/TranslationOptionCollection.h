@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "PartialTranslOptColl.h"
 #include "DecodeStep.h"
 #include "InputPath.h"
+#include "util/pool.hh"
 
 namespace Moses
 {
@@ -74,6 +75,7 @@ protected:
   size_t m_max_phrase_length;
   std::vector<const Phrase*> m_unksrcs;
   InputPathList m_inputPathQueue;
+  util::Pool *m_arena; /*< arena of the Manager, translation options are allocated in it */
 
   TranslationOptionCollection(ttasksptr const& ttask, InputType const& src);
 
@@ -127,6 +129,10 @@ protected:
 public:
   virtual ~TranslationOptionCollection();
 
+  util::Pool *GetArena() const {
+    return m_arena;
+  }
+
   //! input sentence/confusion network
   const InputType& GetSource() const {
     return m_source;
@@ -54,7 +54,7 @@ TranslationTask
 TranslationTask
 ::TranslationTask(boost::shared_ptr<InputType> const& source,
                   boost::shared_ptr<IOWrapper> const& ioWrapper)
-  : m_source(source) , m_ioWrapper(ioWrapper)
+  : m_arena(NULL), m_threadPool(NULL), m_source(source) , m_ioWrapper(ioWrapper)
 {
 }
 
@@ -22,6 +22,7 @@ namespace Moses
 {
 class InputType;
 class OutputCollector;
+class ThreadPool;
 
 
 /** Translates a sentence.
@@ -46,7 +47,7 @@ protected:
 // #endif
 
   // pointer to ContextScope, which stores context-specific information
-  TranslationTask() { } ;
+  TranslationTask() : m_arena(NULL), m_threadPool(NULL) { } ;
   TranslationTask(boost::shared_ptr<Moses::InputType> const& source,
                   boost::shared_ptr<Moses::IOWrapper> const& ioWrapper);
   // Yes, the constructor is protected.
@@ -65,6 +66,8 @@ protected:
   // task stays alive till it's done with it.
 
   boost::shared_ptr<std::vector<std::string> > m_context;
+  util::Pool *m_arena; // arena of the Manager translating this task, if any
+  ThreadPool *m_threadPool; // pool whose idle threads can help the search, if any
   // SPTR<std::map<std::string, float> const> m_context_weights;
 public:
 
@@ -124,6 +127,26 @@ public:
 
   AllOptions::ptr const& options() const;
 
+  // Sentence-scoped objects (see ArenaObject) can be allocated in the returned arena,
+  // that is NULL if no Manager is currently translating this task
+  util::Pool *GetArena() const {
+    return m_arena;
+  }
+
+  void SetArena(util::Pool *arena) {
+    m_arena = arena;
+  }
+
+  // The idle threads of the returned pool (if not NULL) can expand the hypotheses
+  // of this task, see SearchWorkers
+  ThreadPool *GetThreadPool() const {
+    return m_threadPool;
+  }
+
+  void SetThreadPool(ThreadPool *pool) {
+    m_threadPool = pool;
+  }
+
 protected:
   boost::shared_ptr<Moses::InputType> m_source;
   boost::shared_ptr<Moses::IOWrapper> m_ioWrapper;
@@ -15,6 +15,8 @@ namespace Moses
     , max_partial_trans_opt(DEFAULT_MAX_PART_TRANS_OPT_SIZE)
     , beam_width(DEFAULT_BEAM_WIDTH)
     , timeout(0)
+    , threads(1)
+    , threads_min_length(DEFAULT_SEARCH_THREADS_MIN_LENGTH)
     , consensus(false)
     , early_discarding_threshold(DEFAULT_EARLY_DISCARDING_THRESHOLD)
     , trans_opt_threshold(DEFAULT_TRANSLATION_OPTION_THRESHOLD)
@@ -38,6 +40,9 @@ namespace Moses
     param.SetParameter(early_discarding_threshold, "early-discarding-threshold", 
                        DEFAULT_EARLY_DISCARDING_THRESHOLD);
     param.SetParameter(timeout, "time-out", 0);
+    param.SetParameter(threads, "search-threads", size_t(1));
+    param.SetParameter(threads_min_length, "search-threads-min-length",
+                       DEFAULT_SEARCH_THREADS_MIN_LENGTH);
     param.SetParameter(max_phrase_length, "max-phrase-length", 
                        DEFAULT_MAX_PHRASE_LENGTH);
     param.SetParameter(trans_opt_threshold, "translation-option-threshold", 
@@ -26,6 +26,11 @@ namespace Moses
 
     int timeout;
 
+    // intra-sentence parallelism: number of threads expanding the hypotheses
+    // of the sentences with at least threads_min_length words (1 = disabled)
+    size_t threads;
+    size_t threads_min_length;
+
     bool consensus; //! Use Consensus decoding  (DeNero et al 2009)
     
     // reordering options
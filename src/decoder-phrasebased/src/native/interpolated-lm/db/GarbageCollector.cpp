@@ -2,6 +2,7 @@
 // Created by Davide  Caroselli on 17/02/17.
 //
 
+#include <limits>
 #include <util/chrono.h>
 #include "GarbageCollector.h"
 #include "dbkv.h"
@@ -11,8 +12,14 @@ using namespace std;
 using namespace mmt;
 using namespace mmt::ilm;
 
-GarbageCollector::GarbageCollector(rocksdb::DB *db, double timeout) : BackgroundPollingThread(timeout), db(db) {
+// Value of the deletion key of a domain whose key range has been compacted
+static const string kCompactedDomainValue = "C";
+
+GarbageCollector::GarbageCollector(rocksdb::DB *db, DomainTombstones *tombstones, double timeout)
+        : BackgroundPollingThread(timeout), db(db), tombstones(tombstones), deletedCount(0) {
     // Deleted domains
+    vector<domain_t> deleted;
+
     Iterator *it = db->NewIterator(ReadOptions());
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
@@ -21,12 +28,18 @@ GarbageCollector::GarbageCollector(rocksdb::DB *db, double timeout) : Background
             break;
 
         domain_t domain = GetDomainFromDeletionKey(key.data(), key.size());
-        if (domain > 0)
-            queue.insert(domain);
+        if (domain > 0) {
+            deleted.push_back(domain);
+
+            if (it->value().compare(kCompactedDomainValue) != 0)
+                queue.insert(domain);
+        }
     }
 
     delete it;
 
+    tombstones->Add(deleted);
+
     // Starting background thread
     Start();
 }
@@ -36,6 +49,13 @@ GarbageCollector::~GarbageCollector() {
 }
 
 void GarbageCollector::MarkForDeletion(const std::vector<domain_t> &domains) {
+    if (domains.empty())
+        return;
+
+    tombstones->Add(domains);
+
+    deletedCount.fetch_add(domains.size(), memory_order_release);
+
     queueAccess.lock();
     queue.insert(domains.begin(), domains.end());
     queueAccess.unlock();
@@ -52,49 +72,40 @@ void GarbageCollector::BackgroundThreadRun() {
     LogInfo(logger) << "Started cleaning process";
     double beginTime = GetTime();
 
-    try {
-        for (auto domain = domains.begin(); domain != domains.end(); ++domain) {
-            Delete(*domain);
-
-            db->Delete(WriteOptions(), MakeDomainDeletionKey(*domain));
-
-            queueAccess.lock();
-            queue.erase(*domain);
-            queueAccess.unlock();
+    for (auto domain = domains.begin(); domain != domains.end(); ++domain) {
+        if (!IsRunning()) {
+            LogInfo(logger) << "Cleaning process interrupted after " << GetElapsedTime(beginTime) << "s";
+            return;
         }
 
-        LogInfo(logger) << "Cleaning process completed in " << GetElapsedTime(beginTime) << "s";
-    } catch (interrupted_exception &e) {
-        LogInfo(logger) << "Cleaning process interrupted after " << GetElapsedTime(beginTime) << "s";
+        Compact(*domain);
+
+        queueAccess.lock();
+        queue.erase(*domain);
+        queueAccess.unlock();
     }
-}
 
-void GarbageCollector::Delete(domain_t domain) throw(interrupted_exception) {
-    if (!IsRunning())
-        throw interrupted_exception();
+    LogInfo(logger) << "Cleaning process completed in " << GetElapsedTime(beginTime) << "s";
+}
 
+void GarbageCollector::Compact(domain_t domain) {
     double beginTime = GetTime();
-    LogInfo(logger) << "Deleting domain " << domain;
 
-    WriteOptions writeOptions;
+    // Keys start with the domain, so all the n-grams of a domain are a contiguous range:
+    // only the tables overlapping the range are rewritten, without the keys of the domain
+    string beginKey = MakeNGramKey(domain, 0);
+    string endKey = MakeNGramKey(domain, numeric_limits<ngram_hash_t>::max());
 
-    string entryKey = MakeNGramKey(domain, 0);
-    Iterator *it = db->NewIterator(ReadOptions());
-
-    for (it->Seek(entryKey); it->Valid(); it->Next()) {
-        Slice key = it->key();
+    Slice begin(beginKey);
+    Slice end(endKey);
 
-        domain_t keyDomain;
-        ngram_hash_t keyHash;
-        GetNGramKeyData(key.data(), key.size(), &keyDomain, &keyHash);
+    Status status = db->CompactRange(CompactRangeOptions(), &begin, &end);
 
-        if (domain != keyDomain)
-            break;
-
-        db->Delete(writeOptions, key);
-    }
-
-    delete it;
+    if (status.ok())
+        status = db->Put(WriteOptions(), MakeDomainDeletionKey(domain), kCompactedDomainValue);
 
-    LogInfo(logger) << "Deletion of domain " << domain << " completed in " << GetElapsedTime(beginTime) << "s";
+    if (status.ok())
+        LogInfo(logger) << "Domain " << domain << " compacted in " << GetElapsedTime(beginTime) << "s";
+    else
+        LogInfo(logger) << "Unable to compact domain " << domain << ": " << status.ToString();
 }
@@ -10,34 +10,43 @@
 #include <rocksdb/db.h>
 #include <mmt/sentence.h>
 #include <unordered_set>
+#include <atomic>
+#include <mmt/DomainTombstones.h>
 
 namespace mmt {
     namespace ilm {
 
+        // Deleted domains are tombstoned: readers ignore them immediately and their keys are
+        // dropped by the compaction filter of the storage. In background the collector compacts
+        // the key range of every deleted domain, so that the space is reclaimed even if
+        // the normal compactions never reach it.
         class GarbageCollector : public BackgroundPollingThread {
         public:
-            GarbageCollector(rocksdb::DB *db, double timeout);
+            GarbageCollector(rocksdb::DB *db, DomainTombstones *tombstones, double timeout);
 
             virtual ~GarbageCollector();
 
             void MarkForDeletion(const std::vector<domain_t> &domains);
 
+            // Number of domains deleted so far
+            uint64_t GetDeletedCount() const {
+                return deletedCount.load(std::memory_order_acquire);
+            }
+
         private:
             mmt::logging::Logger logger = logging::Logger("ilm.GarbageCollector");
 
             rocksdb::DB *db;
+            DomainTombstones *tombstones;
 
             std::mutex queueAccess;
             std::unordered_set<domain_t> queue;
 
-            class interrupted_exception : public std::exception {
-            public:
-                interrupted_exception() {};
-            };
+            std::atomic<uint64_t> deletedCount;
 
             void BackgroundThreadRun() override;
 
-            void Delete(domain_t domain) throw(interrupted_exception);
+            void Compact(domain_t domain);
 
         };
 
@@ -4,6 +4,7 @@
 
 #include "NGramBatch.h"
 #include <stdlib.h>
+#include <algorithm>
 #include <lm/LM.h>
 
 using namespace mmt;
@@ -75,7 +76,7 @@ inline void NGramBatch::AddToBatch(const domain_t domain, const vector<wid_t> &s
         }
     }
 
-    delete words;
+    free(words);
 }
 
 bool NGramBatch::Delete(const updateid_t &id, const domain_t domain) {
@@ -86,6 +87,45 @@ bool NGramBatch::Delete(const updateid_t &id, const domain_t domain) {
     return true;
 }
 
+void NGramBatch::Delete(const domain_t domain) {
+    deletions.push_back(domain);
+}
+
+void NGramBatch::Merge(NGramBatch &other) {
+    for (auto it = other.ngrams_map.begin(); it != other.ngrams_map.end(); ++it) {
+        auto el = ngrams_map.emplace(it->first, ngram_table_t());
+        ngram_table_t &ngrams = el.first->second;
+
+        if (el.second) {
+            // new domain, the table is moved as is
+            ngrams.swap(it->second);
+            for (auto table = ngrams.begin(); table != ngrams.end(); ++table)
+                this->size += table->size();
+        } else {
+            for (size_t iorder = 0; iorder < order; ++iorder) {
+                for (auto entry = it->second[iorder].begin(); entry != it->second[iorder].end(); ++entry) {
+                    auto e = ngrams[iorder].emplace(entry->first, entry->second);
+
+                    if (e.second)
+                        this->size++;
+                    else
+                        e.first->second.counts.count += entry->second.counts.count;
+                }
+            }
+        }
+    }
+
+    deletions.insert(deletions.end(), other.deletions.begin(), other.deletions.end());
+    sentenceCount += other.sentenceCount;
+
+    if (streams.size() < other.streams.size())
+        streams.resize(other.streams.size(), -1);
+    for (size_t i = 0; i < other.streams.size(); ++i)
+        streams[i] = max(streams[i], other.streams[i]);
+
+    other.Clear();
+}
+
 void NGramBatch::Reset(const vector<seqid_t> &_streams) {
     streams = _streams;
     Clear();
@@ -29,6 +29,7 @@ namespace mmt {
 
         class NGramBatch {
             friend class NGramStorage;
+            friend class NGramBulkLoader;
         public:
 
             NGramBatch(uint8_t order, size_t maxSize) : NGramBatch(order, maxSize, vector<seqid_t>()) {}
@@ -42,8 +43,18 @@ namespace mmt {
 
             bool Delete(const updateid_t &id, const domain_t domain);
 
+            void Delete(const domain_t domain);
+
+            // Moves the content of "other" into this batch, leaving "other" empty;
+            // the streams status becomes the most recent of the two
+            void Merge(NGramBatch &other);
+
             bool IsEmpty();
 
+            inline bool IsFull() const {
+                return size >= maxSize;
+            }
+
             void Reset(const vector<seqid_t> &streams);
 
             void Clear();
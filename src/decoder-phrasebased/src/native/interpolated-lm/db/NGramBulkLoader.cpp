@@ -0,0 +1,347 @@
+//
+// Created by Davide  Caroselli on 21/06/17.
+//
+
+#include <algorithm>
+#include <exception>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include <rocksdb/sst_file_writer.h>
+#include <util/chrono.h>
+#include "NGramBulkLoader.h"
+#include "dbkv.h"
+
+namespace fs = boost::filesystem;
+
+using namespace std;
+using namespace rocksdb;
+using namespace mmt;
+using namespace mmt::ilm;
+
+// Maximum number of runs merged in a single pass
+static const size_t kMaxMergeWidth = 64;
+// SST files are closed when they reach this size
+static const uint64_t kMaxTableFileSize = 256ULL * 1024ULL * 1024ULL;
+
+/* Run values */
+
+// N-gram runs store, for every n-gram, its order, its predecessor and its counts
+static inline string SerializeNGram(size_t order, ngram_hash_t predecessor, const counts_t &counts) {
+    char bytes[9];
+    size_t ptr = 0;
+    bytes[ptr++] = (char) order;
+    WriteUInt64(bytes, &ptr, predecessor);
+
+    return string(bytes, 9) + SerializeCounts(counts);
+}
+
+static inline void DeserializeNGram(const string &value, size_t *outOrder, ngram_hash_t *outPredecessor,
+                                    counts_t *outCounts) {
+    size_t ptr = 1;
+    *outOrder = (uint8_t) value[0];
+    *outPredecessor = ReadUInt64(value.data(), &ptr);
+    DeserializeCounts(value.data() + 9, value.size() - 9, outCounts);
+}
+
+static void MergeNGrams(const string &key, string &existing, const string &value) {
+    size_t order;
+    ngram_hash_t predecessor;
+    counts_t a, b;
+
+    DeserializeNGram(existing, &order, &predecessor, &a);
+    DeserializeNGram(value, &order, &predecessor, &b);
+
+    existing = SerializeNGram(order, predecessor, counts_t(a.count + b.count, a.successors + b.successors));
+}
+
+static void MergeCounts(const string &key, string &existing, const string &value) {
+    counts_t a, b;
+    DeserializeCounts(existing.data(), existing.size(), &a);
+    DeserializeCounts(value.data(), value.size(), &b);
+
+    existing = SerializeCounts(counts_t(a.count + b.count, a.successors + b.successors));
+}
+
+/* Shard */
+
+NGramBulkLoader::Shard::Shard(NGramBulkLoader *loader, uint8_t order, size_t bufferSize)
+        : loader(loader), batch(order, bufferSize) {
+}
+
+void NGramBulkLoader::Shard::Add(const domain_t domain, const vector<wid_t> &sentence) {
+    if (!batch.Add(domain, sentence)) {
+        Flush();
+        batch.Add(domain, sentence);
+    }
+}
+
+void NGramBulkLoader::Shard::Flush() {
+    if (batch.IsEmpty())
+        return;
+
+    struct entry_t {
+        string key;
+        size_t order;
+        const ngram_t *ngram;
+    };
+
+    vector<entry_t> entries;
+    entries.reserve(batch.size);
+
+    for (auto domain = batch.ngrams_map.begin(); domain != batch.ngrams_map.end(); ++domain) {
+        for (size_t o = 0; o < domain->second.size(); ++o) {
+            for (auto it = domain->second[o].begin(); it != domain->second[o].end(); ++it) {
+                entry_t entry;
+                entry.key = MakeNGramKey(domain->first, it->first);
+                entry.order = o + 1;
+                entry.ngram = &it->second;
+
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    sort(entries.begin(), entries.end(), [](const entry_t &a, const entry_t &b) {
+        return a.key < b.key;
+    });
+
+    string path = loader->NewTempFile("ngrams");
+    SortedRunWriter writer(path);
+
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+        writer.Append(entry->key, SerializeNGram(entry->order, entry->ngram->predecessor, entry->ngram->counts));
+
+    writer.Close();
+
+    loader->AddRun(path);
+    batch.Clear();
+}
+
+/* NGramBulkLoader */
+
+NGramBulkLoader::NGramBulkLoader(NGramStorage *storage, const string &tempPath,
+                                 size_t bufferSize) throw(storage_exception)
+        : logger("ilm.NGramBulkLoader"), storage(storage), tempPath(tempPath), bufferSize(bufferSize),
+          fileCount(0) {
+    // Ingested files replace existing values, the storage must contain the streams status only
+    string streamsKey = MakeNGramKey(0, 0);
+    bool empty = true;
+
+    Iterator *it = storage->db->NewIterator(ReadOptions());
+    for (it->SeekToFirst(); it->Valid() && empty; it->Next())
+        empty = it->key().compare(streamsKey) == 0;
+    delete it;
+
+    if (!empty)
+        throw storage_exception("Bulk load requires an empty storage");
+
+    fs::create_directories(tempPath);
+}
+
+NGramBulkLoader::~NGramBulkLoader() {
+    boost::system::error_code error;
+    fs::remove_all(tempPath, error);
+}
+
+NGramBulkLoader::Shard *NGramBulkLoader::NewShard() {
+    return new Shard(this, storage->GetOrder(), bufferSize);
+}
+
+string NGramBulkLoader::NewTempFile(const string &prefix) {
+    lock_guard<mutex> lock(runsAccess);
+    return (fs::path(tempPath) / fs::path(prefix + "." + to_string(fileCount++))).string();
+}
+
+void NGramBulkLoader::AddRun(const string &path) {
+    lock_guard<mutex> lock(runsAccess);
+    runs.push_back(path);
+}
+
+void NGramBulkLoader::ReduceRuns(vector<string> &runs, run_merge_t merge) {
+    while (runs.size() > kMaxMergeWidth) {
+        size_t groups = (runs.size() + kMaxMergeWidth - 1) / kMaxMergeWidth;
+        vector<string> reduced(groups);
+        exception_ptr error;
+
+#pragma omp parallel for schedule(dynamic)
+        for (size_t g = 0; g < groups; ++g) {
+            auto begin = runs.begin() + g * kMaxMergeWidth;
+            auto end = runs.begin() + min((g + 1) * kMaxMergeWidth, runs.size());
+
+            vector<string> group(begin, end);
+            reduced[g] = NewTempFile("merge");
+
+            try {
+                SortedRunMerger merger(group, merge);
+                SortedRunWriter writer(reduced[g]);
+
+                string key, value;
+                while (merger.Next(&key, &value))
+                    writer.Append(key, value);
+
+                writer.Close();
+
+                for (auto run = group.begin(); run != group.end(); ++run)
+                    fs::remove(*run);
+            } catch (...) {
+#pragma omp critical(ilm_bulk_error)
+                if (!error)
+                    error = current_exception();
+            }
+        }
+
+        // exceptions can not escape the parallel region
+        if (error)
+            rethrow_exception(error);
+
+        runs.swap(reduced);
+    }
+}
+
+void NGramBulkLoader::ComputeSuccessors(const string &countsRun, vector<string> &outSuccessorsRuns) {
+    // Every n-gram (order > 1) adds a successor to its predecessor: the increments are
+    // buffered and spilled as sorted runs, that are later merged with the n-gram counts
+    unordered_map<string, count_t> successors;
+    unordered_map<domain_t, counts_t> wordCounts;
+
+    auto spill = [this, &successors, &outSuccessorsRuns]() {
+        vector<pair<string, count_t>> entries(successors.begin(), successors.end());
+        sort(entries.begin(), entries.end());
+
+        string path = NewTempFile("successors");
+        SortedRunWriter writer(path);
+
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+            writer.Append(entry->first, SerializeCounts(counts_t(0, entry->second)));
+
+        writer.Close();
+
+        outSuccessorsRuns.push_back(path);
+        successors.clear();
+    };
+
+    SortedRunMerger merger(runs, MergeNGrams);
+    SortedRunWriter counts(countsRun);
+
+    string key, value;
+    while (merger.Next(&key, &value)) {
+        size_t order;
+        ngram_hash_t predecessor;
+        counts_t ngramCounts;
+
+        DeserializeNGram(value, &order, &predecessor, &ngramCounts);
+        counts.Append(key, SerializeCounts(ngramCounts));
+
+        domain_t domain;
+        ngram_hash_t hash;
+        GetNGramKeyData(key.data(), key.size(), &domain, &hash);
+
+        if (order == 1) {
+            counts_t &domainCounts = wordCounts[domain];
+            domainCounts.count += ngramCounts.count;
+            domainCounts.successors++;
+        } else {
+            successors[MakeNGramKey(domain, predecessor)]++;
+
+            if (successors.size() >= bufferSize)
+                spill();
+        }
+    }
+
+    counts.Close();
+
+    for (auto run = runs.begin(); run != runs.end(); ++run)
+        fs::remove(*run);
+    runs.clear();
+
+    // The word count and the count of unique words are stored as the counts of kWordCountsHash
+    vector<pair<string, counts_t>> entries;
+    for (auto entry = successors.begin(); entry != successors.end(); ++entry)
+        entries.push_back(make_pair(entry->first, counts_t(0, entry->second)));
+
+    for (auto entry = wordCounts.begin(); entry != wordCounts.end(); ++entry)
+        entries.push_back(make_pair(MakeNGramKey(entry->first, kWordCountsHash), entry->second));
+
+    sort(entries.begin(), entries.end(), [](const pair<string, counts_t> &a, const pair<string, counts_t> &b) {
+        return a.first < b.first;
+    });
+
+    string path = NewTempFile("successors");
+    SortedRunWriter writer(path);
+
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+        writer.Append(entry->first, SerializeCounts(entry->second));
+
+    writer.Close();
+    outSuccessorsRuns.push_back(path);
+}
+
+void NGramBulkLoader::WriteTables(const vector<string> &runs, vector<string> &outTables) throw(storage_exception) {
+    SstFileWriter *writer = NULL;
+    Status status;
+
+    SortedRunMerger merger(runs, MergeCounts);
+
+    string key, value;
+    while (merger.Next(&key, &value)) {
+        if (writer == NULL) {
+            outTables.push_back(NewTempFile("table") + ".sst");
+
+            writer = new SstFileWriter(EnvOptions(), storage->db->GetOptions());
+            status = writer->Open(outTables.back());
+        }
+
+        if (status.ok())
+            status = writer->Put(key, value);
+
+        if (status.ok() && writer->FileSize() >= kMaxTableFileSize) {
+            status = writer->Finish();
+
+            delete writer;
+            writer = NULL;
+        }
+
+        if (!status.ok()) {
+            delete writer;
+            throw storage_exception("Unable to write table: " + status.ToString());
+        }
+    }
+
+    if (writer) {
+        status = writer->Finish();
+        delete writer;
+
+        if (!status.ok())
+            throw storage_exception("Unable to write table: " + status.ToString());
+    }
+}
+
+void NGramBulkLoader::Load() throw(storage_exception) {
+    double beginTime = GetTime();
+    LogInfo(logger) << "Merging " << runs.size() << " runs";
+
+    ReduceRuns(runs, MergeNGrams);
+
+    string countsRun = NewTempFile("counts");
+    vector<string> countsRuns;
+    ComputeSuccessors(countsRun, countsRuns);
+    countsRuns.push_back(countsRun);
+
+    ReduceRuns(countsRuns, MergeCounts);
+
+    vector<string> tables;
+    WriteTables(countsRuns, tables);
+
+    LogInfo(logger) << "Ingesting " << tables.size() << " tables, prepared in " << GetElapsedTime(beginTime) << "s";
+
+    if (!tables.empty()) {
+        IngestExternalFileOptions options;
+        options.move_files = true;
+
+        Status status = storage->db->IngestExternalFile(tables, options);
+        if (!status.ok())
+            throw storage_exception("Unable to ingest tables: " + status.ToString());
+    }
+
+    LogInfo(logger) << "Bulk load completed in " << GetElapsedTime(beginTime) << "s";
+}
@@ -0,0 +1,84 @@
+//
+// Created by Davide  Caroselli on 21/06/17.
+//
+
+#ifndef ILM_NGRAMBULKLOADER_H
+#define ILM_NGRAMBULKLOADER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <mmt/logging/Logger.h>
+#include <mmt/io/SortedRun.h>
+#include "NGramStorage.h"
+#include "NGramBatch.h"
+
+using namespace std;
+
+namespace mmt {
+    namespace ilm {
+
+        // Builds a new storage from large corpora without passing through the write path:
+        // n-grams are counted in memory by independent shards (one per thread) and spilled
+        // to disk as sorted runs; the runs are then merged, the successors and the word counts
+        // are computed, and the result is written as sorted, fully merged SST files that are
+        // ingested in the storage. No compaction is needed after the load.
+        class NGramBulkLoader {
+        public:
+
+            class Shard {
+                friend class NGramBulkLoader;
+
+            public:
+                void Add(const domain_t domain, const vector<wid_t> &sentence);
+
+                // Writes the buffered n-grams to a new sorted run: it must be called
+                // before deleting the shard, that does not flush its n-grams by itself
+                void Flush();
+
+            private:
+                NGramBulkLoader *loader;
+                NGramBatch batch;
+
+                Shard(NGramBulkLoader *loader, uint8_t order, size_t bufferSize);
+            };
+
+            // "bufferSize" is the number of n-grams buffered by every shard
+            NGramBulkLoader(NGramStorage *storage, const string &tempPath,
+                            size_t bufferSize) throw(storage_exception);
+
+            ~NGramBulkLoader();
+
+            // Shards are independent, every thread must use its own
+            Shard *NewShard();
+
+            // Merges the runs of all the shards and ingests the result in the storage,
+            // that must be empty; all the shards must have been flushed before.
+            void Load() throw(storage_exception);
+
+        private:
+            const logging::Logger logger;
+            NGramStorage *storage;
+            const string tempPath;
+            const size_t bufferSize;
+
+            mutex runsAccess;
+            vector<string> runs;
+            size_t fileCount;
+
+            string NewTempFile(const string &prefix);
+
+            void AddRun(const string &path);
+
+            // Merges groups of runs in parallel until they can be merged in a single pass
+            void ReduceRuns(vector<string> &runs, run_merge_t merge);
+
+            void ComputeSuccessors(const string &countsRun, vector<string> &outSuccessorsRuns);
+
+            void WriteTables(const vector<string> &runs, vector<string> &outTables) throw(storage_exception);
+        };
+
+    }
+}
+
+#endif //ILM_NGRAMBULKLOADER_H
@@ -0,0 +1,278 @@
+//
+// Created by Davide  Caroselli on 19/06/17.
+//
+
+#include <algorithm>
+#include <util/chrono.h>
+#include "NGramHotTier.h"
+#include "dbkv.h"
+
+using namespace rocksdb;
+using namespace std;
+using namespace mmt;
+using namespace mmt::ilm;
+
+const size_t NGramHotTier::kActivitySlots;
+const uint32_t NGramHotTier::kActivitySampling;
+
+static inline size_t MixHash(ngram_hash_t key) {
+    // word hashes are just word ids, bits must be mixed before masking
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (h ^ (h >> 32));
+}
+
+/* table_t */
+
+NGramHotTier::table_t::table_t(size_t capacity) : entries(capacity), size(0) {
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+        entry->key = 0;
+}
+
+const counts_t *NGramHotTier::table_t::Find(ngram_hash_t key) const {
+    size_t mask = entries.size() - 1;
+
+    for (size_t i = MixHash(key) & mask; ; i = (i + 1) & mask) {
+        const entry_t &entry = entries[i];
+
+        if (entry.counts.count == 0 && entry.counts.successors == 0)
+            return NULL;
+        if (entry.key == key)
+            return &entry.counts;
+    }
+}
+
+void NGramHotTier::table_t::Add(ngram_hash_t key, const counts_t &counts) {
+    if (counts.count == 0 && counts.successors == 0)
+        return;
+
+    if ((size + 1) * 10 > entries.size() * 7)
+        Grow();
+
+    size_t mask = entries.size() - 1;
+
+    for (size_t i = MixHash(key) & mask; ; i = (i + 1) & mask) {
+        entry_t &entry = entries[i];
+
+        if (entry.counts.count == 0 && entry.counts.successors == 0) {
+            entry.key = key;
+            entry.counts = counts;
+            size++;
+            return;
+        }
+
+        if (entry.key == key) {
+            entry.counts.count += counts.count;
+            entry.counts.successors += counts.successors;
+            return;
+        }
+    }
+}
+
+void NGramHotTier::table_t::Grow() {
+    table_t grown(entries.size() * 2);
+
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+        grown.Add(entry->key, entry->counts);
+
+    entries.swap(grown.entries);
+}
+
+/* NGramHotTier */
+
+NGramHotTier::NGramHotTier(rocksdb::DB *db, size_t maxDomains, size_t maxEntries, double timeout)
+        : BackgroundPollingThread(timeout), logger("ilm.NGramHotTier"), db(db),
+          maxDomains(maxDomains), maxEntries(maxEntries) {
+    Start();
+}
+
+NGramHotTier::~NGramHotTier() {
+    Stop();
+
+    for (auto entry = domains.begin(); entry != domains.end(); ++entry)
+        delete entry->second;
+}
+
+bool NGramHotTier::GetCounts(domain_t domain, ngram_hash_t key, counts_t *outCounts) {
+    RecordActivity(domain, 1);
+
+    boost::shared_lock<boost::shared_mutex> lock(access);
+
+    auto entry = domains.find(domain);
+    if (entry == domains.end())
+        return false;
+
+    const counts_t *counts = entry->second->Find(key);
+    *outCounts = counts ? *counts : counts_t();
+
+    return true;
+}
+
+size_t NGramHotTier::GetCounts(const vector<domain_t> &domains, const vector<ngram_hash_t> &hashes,
+                               vector<counts_t> &outCounts, vector<bool> &outHot) {
+    outHot.assign(domains.size(), false);
+    size_t hotCount = 0;
+
+    boost::shared_lock<boost::shared_mutex> lock(access);
+
+    for (size_t i = 0; i < domains.size(); ++i) {
+        RecordActivity(domains[i], hashes.size());
+
+        auto entry = this->domains.find(domains[i]);
+        if (entry == this->domains.end())
+            continue;
+
+        counts_t *output = outCounts.data() + i * hashes.size();
+        for (size_t j = 0; j < hashes.size(); ++j) {
+            const counts_t *counts = entry->second->Find(hashes[j]);
+            output[j] = counts ? *counts : counts_t();
+        }
+
+        outHot[i] = true;
+        hotCount++;
+    }
+
+    return hotCount;
+}
+
+void NGramHotTier::Add(domain_t domain, const ngram_table_t &table, const counts_t &wordCounts) {
+    boost::unique_lock<boost::shared_mutex> lock(access);
+
+    auto entry = domains.find(domain);
+    if (entry == domains.end())
+        return;
+
+    for (auto order = table.begin(); order != table.end(); ++order) {
+        for (auto ngram = order->begin(); ngram != order->end(); ++ngram)
+            entry->second->Add(ngram->first, ngram->second.counts);
+    }
+
+    entry->second->Add(kWordCountsHash, wordCounts);
+}
+
+void NGramHotTier::Evict(domain_t domain) {
+    table_t *table = NULL;
+
+    {
+        boost::unique_lock<boost::shared_mutex> lock(access);
+
+        auto entry = domains.find(domain);
+        if (entry != domains.end()) {
+            table = entry->second;
+            domains.erase(entry);
+        }
+    }
+
+    if (table) {
+        LogInfo(logger) << "Domain " << domain << " evicted";
+        delete table;
+    }
+}
+
+void NGramHotTier::BackgroundThreadRun() {
+    // Activity scores decay at every run, so that the tier follows the recent traffic
+    for (auto score = scores.begin(); score != scores.end(); /* no increment */) {
+        score->second /= 2;
+
+        if (score->second == 0)
+            score = scores.erase(score);
+        else
+            ++score;
+    }
+
+    for (size_t i = 0; i < kActivitySlots; ++i) {
+        uint64_t hits = activity[i].hits.exchange(0, memory_order_relaxed);
+        if (hits > 0)
+            scores[activity[i].domain.load(memory_order_relaxed)] += hits;
+    }
+
+    vector<pair<uint64_t, domain_t>> ranking;
+    ranking.reserve(scores.size());
+
+    for (auto score = scores.begin(); score != scores.end(); ++score) {
+        if (oversized.find(score->first) == oversized.end())
+            ranking.push_back(make_pair(score->second, score->first));
+    }
+
+    sort(ranking.begin(), ranking.end(), greater<pair<uint64_t, domain_t>>());
+    if (ranking.size() > maxDomains)
+        ranking.resize(maxDomains);
+
+    unordered_set<domain_t> hottest;
+    for (auto entry = ranking.begin(); entry != ranking.end(); ++entry)
+        hottest.insert(entry->second);
+
+    // Evict the domains that are no more among the most active
+    vector<domain_t> evictions;
+    {
+        boost::shared_lock<boost::shared_mutex> lock(access);
+        for (auto entry = domains.begin(); entry != domains.end(); ++entry) {
+            if (hottest.find(entry->first) == hottest.end())
+                evictions.push_back(entry->first);
+        }
+    }
+
+    for (auto domain = evictions.begin(); domain != evictions.end(); ++domain)
+        Evict(*domain);
+
+    // Load the new ones, from the most active
+    for (auto entry = ranking.begin(); entry != ranking.end() && IsRunning(); ++entry) {
+        domain_t domain = entry->second;
+
+        {
+            boost::shared_lock<boost::shared_mutex> lock(access);
+            if (domains.find(domain) != domains.end())
+                continue;
+        }
+
+        Load(domain);
+    }
+}
+
+void NGramHotTier::Load(domain_t domain) {
+    // No update can be written while the domain is loaded
+    lock_guard<mutex> updatesLock(updatesAccess);
+
+    double beginTime = GetTime();
+
+    // Domains waiting for the garbage collector are not loaded
+    string value;
+    if (db->Get(ReadOptions(), MakeDomainDeletionKey(domain), &value).ok())
+        return;
+
+    table_t *table = new table_t();
+
+    Iterator *it = db->NewIterator(ReadOptions());
+    for (it->Seek(MakeNGramKey(domain, 0)); it->Valid(); it->Next()) {
+        Slice key = it->key();
+
+        domain_t keyDomain;
+        ngram_hash_t keyHash;
+        if (!GetNGramKeyData(key.data(), key.size(), &keyDomain, &keyHash) || keyDomain != domain)
+            break;
+
+        if (table->size >= maxEntries) {
+            oversized.insert(domain);
+            break;
+        }
+
+        Slice rawCounts = it->value();
+        counts_t counts;
+        if (DeserializeCounts(rawCounts.data(), rawCounts.size(), &counts))
+            table->Add(keyHash, counts);
+    }
+    delete it;
+
+    if (oversized.find(domain) != oversized.end()) {
+        LogInfo(logger) << "Domain " << domain << " exceeds " << maxEntries << " entries, not loaded";
+        delete table;
+        return;
+    }
+
+    {
+        boost::unique_lock<boost::shared_mutex> lock(access);
+        domains[domain] = table;
+    }
+
+    LogInfo(logger) << "Domain " << domain << " loaded (" << table->size << " entries) in "
+                    << GetElapsedTime(beginTime) << "s";
+}
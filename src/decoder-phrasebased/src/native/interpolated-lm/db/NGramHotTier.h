@@ -0,0 +1,117 @@
+//
+// Created by Davide  Caroselli on 19/06/17.
+//
+
+#ifndef ILM_NGRAMHOTTIER_H
+#define ILM_NGRAMHOTTIER_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <rocksdb/db.h>
+#include <boost/thread/shared_mutex.hpp>
+#include <mmt/sentence.h>
+#include <mmt/logging/Logger.h>
+#include <util/BackgroundPollingThread.h>
+#include "counts.h"
+#include "ngram_hash.h"
+#include "NGramBatch.h"
+
+namespace mmt {
+    namespace ilm {
+
+        // In-memory copy of the n-gram counts of the most active domains. Every hot domain
+        // is stored in an open-addressing hash table; the domains are periodically ranked by
+        // lookup activity and loaded (or evicted) by a background thread.
+        //
+        // The database updates of a hot domain must be applied to the tier too: the writer
+        // must hold the UpdatesMutex() while writing to the database and applying the updates,
+        // so that a domain being loaded in background does not miss any of them.
+        class NGramHotTier : public BackgroundPollingThread {
+        public:
+            NGramHotTier(rocksdb::DB *db, size_t maxDomains, size_t maxEntries, double timeout = 5.);
+
+            virtual ~NGramHotTier();
+
+            // Returns false if the domain is not in the tier
+            bool GetCounts(domain_t domain, ngram_hash_t key, counts_t *outCounts);
+
+            // For every hot domain it sets the entries outCounts[i * hashes.size() + j] and outHot[i];
+            // outCounts must be already sized. Returns the number of hot domains found.
+            size_t GetCounts(const vector<domain_t> &domains, const vector<ngram_hash_t> &hashes,
+                             vector<counts_t> &outCounts, vector<bool> &outHot);
+
+            std::mutex &UpdatesMutex() {
+                return updatesAccess;
+            }
+
+            // Adds the counts of the table to the domain, if hot
+            void Add(domain_t domain, const ngram_table_t &table, const counts_t &wordCounts);
+
+            void Evict(domain_t domain);
+
+        private:
+            static const size_t kActivitySlots = 4096; // must be a power of two
+            static const uint32_t kActivitySampling = 64; // must be a power of two
+
+            struct entry_t {
+                ngram_hash_t key;
+                counts_t counts; // empty entries have zero counts
+            };
+
+            struct table_t {
+                vector<entry_t> entries;
+                size_t size;
+
+                table_t(size_t capacity = 1024);
+
+                const counts_t *Find(ngram_hash_t key) const;
+
+                void Add(ngram_hash_t key, const counts_t &counts);
+
+                void Grow();
+            };
+
+            struct activity_t {
+                atomic<domain_t> domain;
+                atomic<uint64_t> hits;
+
+                activity_t() : domain(0), hits(0) {};
+            };
+
+            const logging::Logger logger;
+            rocksdb::DB *db;
+            const size_t maxDomains;
+            const size_t maxEntries;
+
+            boost::shared_mutex access;
+            unordered_map<domain_t, table_t *> domains;
+
+            std::mutex updatesAccess;
+
+            activity_t activity[kActivitySlots];
+
+            // Accessed by the background thread only
+            unordered_map<domain_t, uint64_t> scores;
+            unordered_set<domain_t> oversized;
+
+            inline void RecordActivity(domain_t domain, size_t hits) {
+                static thread_local uint32_t tick = 0;
+
+                if ((++tick & (kActivitySampling - 1)) == 0) {
+                    activity_t &slot = activity[domain & (kActivitySlots - 1)];
+                    slot.domain.store(domain, memory_order_relaxed);
+                    slot.hits.fetch_add(hits, memory_order_relaxed);
+                }
+            }
+
+            void BackgroundThreadRun() override;
+
+            void Load(domain_t domain);
+        };
+
+    }
+}
+
+#endif //ILM_NGRAMHOTTIER_H
@@ -6,6 +6,7 @@
 #include <rocksdb/table.h>
 #include <rocksdb/slice_transform.h>
 #include <rocksdb/merge_operator.h>
+#include <rocksdb/compaction_filter.h>
 #include <thread>
 
 #include <iostream>
@@ -27,7 +28,7 @@ using namespace rocksdb;
 using namespace mmt;
 using namespace mmt::ilm;
 
-static const ngram_hash_t kWordCountsHash = 0;
+static const size_t kMaxBatchKeys = 256;
 static const string kStreamsKey = MakeNGramKey(0, 0);
 
 class CountsAddOperator : public AssociativeMergeOperator {
@@ -54,13 +55,47 @@ public:
     }
 };
 
-NGramStorage::NGramStorage(string basepath, uint8_t order, double gcTimeout,
-                           bool prepareForBulkLoad) throw(storage_exception) : order(order),
-                                                                               logger("ilm.NGramStorage") {
+// Drops the keys of the deleted domains
+class DomainTombstoneFilter : public CompactionFilter {
+public:
+    DomainTombstoneFilter(const DomainTombstones *tombstones) : tombstones(tombstones) {};
+
+    virtual bool Filter(int level, const Slice &key, const Slice &existing_value, std::string *new_value,
+                        bool *value_changed) const override {
+        return IsDeleted(key);
+    }
+
+    virtual bool FilterMergeOperand(int level, const Slice &key, const Slice &operand) const override {
+        return IsDeleted(key);
+    }
+
+    virtual const char *Name() const override {
+        return "DomainTombstoneFilter";
+    }
+
+private:
+    const DomainTombstones *tombstones;
+
+    inline bool IsDeleted(const Slice &key) const {
+        domain_t domain;
+        ngram_hash_t hash;
+
+        // Streams and deletion keys belong to domain 0, that is never deleted
+        return GetNGramKeyData(key.data(), key.size(), &domain, &hash) && domain != 0 &&
+               tombstones->Contains(domain);
+    }
+};
+
+NGramStorage::NGramStorage(string basepath, uint8_t order, double gcTimeout, bool prepareForBulkLoad,
+                           size_t hotTierDomains, size_t hotTierMaxEntries) throw(storage_exception)
+        : order(order), logger("ilm.NGramStorage"), version(0), hotTier(NULL) {
     rocksdb::Options options;
     options.create_if_missing = true;
     options.merge_operator.reset(new CountsAddOperator);
 
+    compactionFilter = new DomainTombstoneFilter(&tombstones);
+    options.compaction_filter = compactionFilter;
+
     PlainTableOptions plainTableOptions;
     plainTableOptions.user_key_len = sizeof(domain_t) + sizeof(ngram_hash_t);
 
@@ -93,40 +128,122 @@ NGramStorage::NGramStorage(string basepath, uint8_t order, double gcTimeout,
     string path = basepath + kPathSeparator + "_data";
 
     Status status = DB::Open(options, path, &db);
-    if (!status.ok())
+    if (!status.ok()) {
+        delete compactionFilter;
         throw storage_exception(status.ToString());
+    }
 
     // Read streams
     string raw_streams;
     db->Get(ReadOptions(), kStreamsKey, &raw_streams);
     DeserializeStreams(raw_streams.data(), raw_streams.size(), &streams);
 
+    // Hot tier
+    if (hotTierDomains > 0)
+        hotTier = new NGramHotTier(db, hotTierDomains, hotTierMaxEntries);
+
     // Garbage collector
-    garbageCollector = new GarbageCollector(db, gcTimeout);
+    garbageCollector = new GarbageCollector(db, &tombstones, gcTimeout);
 }
 
 NGramStorage::~NGramStorage() {
     delete garbageCollector;
+    delete hotTier;
     delete db;
+    delete compactionFilter;
 }
 
 counts_t NGramStorage::GetCounts(const domain_t domain, const ngram_hash_t h) const {
-    string key = MakeNGramKey(domain, h);
-    string value;
+    // Keys of deleted domains may still be in the database until compacted
+    if (tombstones.Contains(domain))
+        return counts_t();
 
-    Status status = db->Get(ReadOptions(false, true), key, &value);
+    counts_t output;
+    if (hotTier && hotTier->GetCounts(domain, h, &output))
+        return output;
 
-    if (!status.ok()) {
-        if (status.IsNotFound())
-            return counts_t();
+    char key[kNGramKeySize];
+    WriteNGramKey(key, domain, h);
 
+    string value;
+    Status status = db->Get(ReadOptions(false, true), Slice(key, kNGramKeySize), &value);
+
+    if (!status.ok())
         return counts_t();
-    }
 
-    counts_t output;
     return DeserializeCounts(value.data(), value.size(), &output) ? output : counts_t();
 }
 
+void NGramStorage::GetCountsBatch(const vector<domain_t> &domains, const vector<ngram_hash_t> &hashes,
+                                  vector<counts_t> &outCounts) const {
+    size_t size = domains.size() * hashes.size();
+    outCounts.assign(size, counts_t());
+
+    if (size == 0)
+        return;
+
+    // Hot domains are served from memory
+    vector<bool> skip;
+    size_t skipCount = hotTier ? hotTier->GetCounts(domains, hashes, outCounts, skip) : 0;
+
+    // Keys of deleted domains may still be in the database until compacted
+    for (size_t d = 0; d < domains.size(); ++d) {
+        if (tombstones.Contains(domains[d])) {
+            if (skip.empty())
+                skip.assign(domains.size(), false);
+
+            if (skip[d])
+                fill(outCounts.begin() + d * hashes.size(), outCounts.begin() + (d + 1) * hashes.size(), counts_t());
+            else
+                skipCount++;
+
+            skip[d] = true;
+        }
+    }
+
+    if (skipCount == domains.size())
+        return;
+
+    // Keys are written on the stack, large requests are split in chunks of kMaxBatchKeys
+    char keys[kMaxBatchKeys * kNGramKeySize];
+    size_t indexes[kMaxBatchKeys];
+
+    vector<Slice> slices;
+    vector<string> values;
+    slices.reserve(min(size, kMaxBatchKeys));
+
+    ReadOptions options(false, true);
+
+    size_t i = 0;
+    while (i < size) {
+        slices.clear();
+
+        for (; i < size && slices.size() < kMaxBatchKeys; ++i) {
+            size_t domain = i / hashes.size();
+            if (!skip.empty() && skip[domain])
+                continue;
+
+            char *key = keys + slices.size() * kNGramKeySize;
+            WriteNGramKey(key, domains[domain], hashes[i % hashes.size()]);
+
+            indexes[slices.size()] = i;
+            slices.push_back(Slice(key, kNGramKeySize));
+        }
+
+        if (slices.empty())
+            break;
+
+        vector<Status> statuses = db->MultiGet(options, slices, &values);
+
+        for (size_t k = 0; k < slices.size(); ++k) {
+            counts_t &output = outCounts[indexes[k]];
+
+            if (statuses[k].ok() && !DeserializeCounts(values[k].data(), values[k].size(), &output))
+                output = counts_t();
+        }
+    }
+}
+
 void NGramStorage::GetWordCounts(const domain_t domain, count_t *outUniqueWordCount, count_t *outWordCount) const {
     counts_t counts = GetCounts(domain, kWordCountsHash);
     if (outWordCount)
@@ -145,8 +262,35 @@ void NGramStorage::PutBatch(NGramBatch &batch) throw(storage_exception) {
     LogInfo(logger) << "Importing batch of " << batch.sentenceCount << " sentences.";
     WriteBatch writeBatch;
 
+    // Updates of hot domains are applied to the tier under the same lock of the write
+    unique_lock<mutex> hotTierLock;
+    if (hotTier)
+        hotTierLock = unique_lock<mutex>(hotTier->UpdatesMutex());
+
+    vector<domain_t> domains;
+    vector<ngram_table_t *> tables;
+    domains.reserve(batch.ngrams_map.size());
+    tables.reserve(batch.ngrams_map.size());
+
     for (auto it = batch.ngrams_map.begin(); it != batch.ngrams_map.end(); ++it) {
-        PrepareBatch(it->first, it->second, writeBatch);
+        domains.push_back(it->first);
+        tables.push_back(&it->second);
+    }
+
+    vector<counts_t> wordCounts(domains.size());
+    vector<char> resolved(domains.size());
+
+    // Domains are independent: their successors are resolved in parallel
+#pragma omp parallel for schedule(dynamic) if(domains.size() > 1)
+    for (size_t i = 0; i < domains.size(); ++i)
+        resolved[i] = ResolveSuccessors(domains[i], *tables[i], wordCounts[i]);
+
+    // A domain whose successors could not be read is skipped, its counts would be wrong
+    for (size_t i = 0; i < domains.size(); ++i) {
+        if (resolved[i])
+            PrepareBatch(domains[i], *tables[i], wordCounts[i], writeBatch);
+        else
+            LogError(logger) << "Unable to read the counts of domain " << domains[i] << ", skipping its n-grams";
     }
 
     // Write deleted domains
@@ -160,44 +304,78 @@ void NGramStorage::PutBatch(NGramBatch &batch) throw(storage_exception) {
     if (!status.ok())
         throw storage_exception(status.ToString());
 
+    if (hotTier) {
+        for (size_t i = 0; i < domains.size(); ++i) {
+            if (resolved[i])
+                hotTier->Add(domains[i], *tables[i], wordCounts[i]);
+        }
+
+        for (auto domain = batch.deletions.begin(); domain != batch.deletions.end(); ++domain)
+            hotTier->Evict(*domain);
+    }
+
     // Reset streams
     streams = batch.GetStreams();
+    version.fetch_add(1, memory_order_release);
+
     garbageCollector->MarkForDeletion(batch.deletions);
 }
 
-bool NGramStorage::PrepareBatch(domain_t domain, ngram_table_t &table, rocksdb::WriteBatch &writeBatch) {
-    // Compute counts (successors and word counts)
-    // ------------------------
-
+bool NGramStorage::ResolveSuccessors(domain_t domain, ngram_table_t &table, counts_t &outWordCounts) const {
     // HINT: we start from the maximum order n-grams down to words;
     // if an n-gram is found in the database, we set "is_in_db_for_sure"
     // to all its predecessors (if we have ABC we have for sure BC in the
-    // database). This can save lots of read requests for well known n-grams
+    // database). This can save lots of read requests for well known n-grams.
+    // Since the flag only affects lower orders, all the lookups of the same
+    // order are independent and they are issued with MultiGet, in chunks of
+    // kMaxBatchKeys keys written on the stack.
+
+    ReadOptions options(false, true);
+
+    char keys[kMaxBatchKeys * kNGramKeySize];
+    ngram_t *ngrams[kMaxBatchKeys];
 
-    ReadOptions read_ops = ReadOptions(false, true);
-    Status status;
+    vector<Slice> slices;
+    vector<string> values;
+    slices.reserve(kMaxBatchKeys);
 
     // We also store the word count and the count of unique words
     count_t uniqueWordCount = 0;
     count_t wordCount = 0;
 
     for (size_t o = order; o > 0; --o) {
-        unordered_map <ngram_hash_t, ngram_t> &entry = table[o - 1];
+        unordered_map<ngram_hash_t, ngram_t> &entry = table[o - 1];
 
-        for (auto it = entry.begin(); it != entry.end(); ++it) {
-            ngram_hash_t h = it->first;
-            ngram_t &ngram = it->second;
+        auto it = entry.begin();
+        while (it != entry.end()) {
+            slices.clear();
+
+            for (; it != entry.end() && slices.size() < kMaxBatchKeys; ++it) {
+                ngram_t &ngram = it->second;
+
+                if (o == 1)
+                    wordCount += ngram.counts.count;
+
+                if (ngram.is_in_db_for_sure)
+                    continue;
+
+                char *key = keys + slices.size() * kNGramKeySize;
+                WriteNGramKey(key, domain, it->first);
 
-            if (o == 1)
-                wordCount += ngram.counts.count;
+                ngrams[slices.size()] = &ngram;
+                slices.push_back(Slice(key, kNGramKeySize));
+            }
+
+            if (slices.empty())
+                continue;
+
+            vector<Status> statuses = db->MultiGet(options, slices, &values);
 
-            if (!ngram.is_in_db_for_sure) {
-                string key = MakeNGramKey(domain, h);
-                string value;
-                status = db->Get(read_ops, key, &value);
+            for (size_t k = 0; k < slices.size(); ++k) {
+                ngram_t &ngram = *ngrams[k];
 
-                if (!status.ok()) {
-                    if (!status.IsNotFound())
+                if (!statuses[k].ok()) {
+                    if (!statuses[k].IsNotFound())
                         return false;
 
                     if (o == 1) { // it is a word
@@ -224,27 +402,27 @@ bool NGramStorage::PrepareBatch(domain_t domain, ngram_table_t &table, rocksdb::
         }
     }
 
-    // Prepare write-batch
-    // -------------------
+    outWordCounts = counts_t(wordCount, uniqueWordCount);
+
+    return true;
+}
+
+void NGramStorage::PrepareBatch(domain_t domain, const ngram_table_t &table, const counts_t &wordCounts,
+                                rocksdb::WriteBatch &writeBatch) const {
+    char key[kNGramKeySize];
 
     // Update n-grams (down to words)
     for (size_t o = order; o > 0; --o) {
-        unordered_map <ngram_hash_t, ngram_t> &entry = table[o - 1];
+        const unordered_map<ngram_hash_t, ngram_t> &entry = table[o - 1];
 
         for (auto it = entry.begin(); it != entry.end(); ++it) {
-            ngram_hash_t h = it->first;
-            ngram_t &ngram = it->second;
-
-            string key = MakeNGramKey(domain, h);
-            writeBatch.Merge(key, SerializeCounts(ngram.counts));
+            WriteNGramKey(key, domain, it->first);
+            writeBatch.Merge(Slice(key, kNGramKeySize), SerializeCounts(it->second.counts));
         }
     }
 
     // Store word counts
-    counts_t wordCounts(wordCount, uniqueWordCount);
     writeBatch.Merge(MakeNGramKey(domain, kWordCountsHash), SerializeCounts(wordCounts));
-
-    return true;
 }
 
 void NGramStorage::ForceCompaction() {
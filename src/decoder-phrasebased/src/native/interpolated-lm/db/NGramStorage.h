@@ -7,12 +7,15 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
 #include <rocksdb/db.h>
 #include <lm/LM.h>
 #include <mmt/IncrementalModel.h>
 #include <mmt/logging/Logger.h>
+#include <mmt/DomainTombstones.h>
 #include "counts.h"
 #include "NGramBatch.h"
+#include "NGramHotTier.h"
 #include "GarbageCollector.h"
 
 using namespace std;
@@ -47,15 +50,24 @@ namespace mmt {
         };
 
         class NGramStorage {
+            friend class NGramBulkLoader;
+
         public:
 
-            NGramStorage(string path, uint8_t order, double gcTimeout,
-                         bool prepareForBulkLoad = false) throw(storage_exception);
+            // If "hotTierDomains" is greater than 0, the counts of the most active domains
+            // (up to "hotTierMaxEntries" entries each) are kept in memory
+            NGramStorage(string path, uint8_t order, double gcTimeout, bool prepareForBulkLoad = false,
+                         size_t hotTierDomains = 0, size_t hotTierMaxEntries = 0) throw(storage_exception);
 
             ~NGramStorage();
 
             counts_t GetCounts(const domain_t domain, const ngram_hash_t key) const;
 
+            // Retrieves the counts of every pair (domain, hash) with a single MultiGet;
+            // the counts of domains[i] and hashes[j] are stored in outCounts[i * hashes.size() + j]
+            void GetCountsBatch(const vector<domain_t> &domains, const vector<ngram_hash_t> &hashes,
+                                vector<counts_t> &outCounts) const;
+
             void GetWordCounts(const domain_t domain, count_t *outUniqueWordCount, count_t *outWordCount) const;
 
             size_t GetEstimateSize() const;
@@ -72,15 +84,30 @@ namespace mmt {
 
             const vector<seqid_t> &GetStreamsStatus() const;
 
+            // Changes every time the counts may have changed, that is when a batch
+            // is written (advancing the streams) or a deleted domain is collected
+            inline uint64_t GetVersion() const {
+                return version.load(memory_order_acquire) + garbageCollector->GetDeletedCount();
+            }
+
         private:
             const logging::Logger logger;
             const uint8_t order;
             vector<seqid_t> streams;
+            atomic<uint64_t> version;
             rocksdb::DB *db;
+            rocksdb::CompactionFilter *compactionFilter;
 
+            DomainTombstones tombstones;
+            NGramHotTier *hotTier;
             GarbageCollector *garbageCollector;
 
-            inline bool PrepareBatch(domain_t domain, ngram_table_t &table, rocksdb::WriteBatch &writeBatch);
+            // Computes the successors of the new n-grams and the word counts of the domain;
+            // it only reads from the database, so that domains can be resolved in parallel
+            bool ResolveSuccessors(domain_t domain, ngram_table_t &table, counts_t &outWordCounts) const;
+
+            void PrepareBatch(domain_t domain, const ngram_table_t &table, const counts_t &wordCounts,
+                              rocksdb::WriteBatch &writeBatch) const;
         };
     }
 }
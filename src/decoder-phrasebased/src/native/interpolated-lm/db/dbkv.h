@@ -24,14 +24,19 @@ namespace mmt {
 
         /* Keys */
 
-        static inline string MakeNGramKey(domain_t domain, ngram_hash_t key) {
-            char bytes[12];
+        static const size_t kNGramKeySize = 12;
 
+        static inline void WriteNGramKey(char *bytes, domain_t domain, ngram_hash_t key) {
             size_t ptr = 0;
             WriteUInt32(bytes, &ptr, domain);
             WriteUInt64(bytes, &ptr, key);
+        }
 
-            return string(bytes, 12);
+        static inline string MakeNGramKey(domain_t domain, ngram_hash_t key) {
+            char bytes[kNGramKeySize];
+            WriteNGramKey(bytes, domain, key);
+
+            return string(bytes, kNGramKeySize);
         }
 
         static inline string MakeDomainDeletionKey(domain_t domain) {
@@ -15,6 +15,9 @@ namespace mmt {
 
         typedef uint64_t ngram_hash_t;
 
+        // Reserved hash of the entry storing the word count and the count of unique words
+        static const ngram_hash_t kWordCountsHash = 0;
+
         inline ngram_hash_t hash_ngram(const wid_t word) {
             return (ngram_hash_t) word;
         }
@@ -25,15 +28,19 @@ namespace mmt {
             return key == 0 ? 1 : key; // key "0" is reserved
         }
 
-        inline ngram_hash_t hash_ngram(const std::vector<wid_t> &words, const size_t offset, const size_t size) {
-            ngram_hash_t key = hash_ngram(words[offset]);
+        inline ngram_hash_t hash_ngram(const wid_t *words, const size_t size) {
+            ngram_hash_t key = hash_ngram(words[0]);
 
             for (size_t i = 1; i < size; ++i)
-                key = hash_ngram(key, words[offset + i]);
+                key = hash_ngram(key, words[i]);
 
             return key;
         }
 
+        inline ngram_hash_t hash_ngram(const std::vector<wid_t> &words, const size_t offset, const size_t size) {
+            return hash_ngram(words.data() + offset, size);
+        }
+
         inline ngram_hash_t hash_ngram(const std::vector<wid_t> &words, const size_t order) {
             const size_t offset = (size_t) std::max(0, (int) (words.size() - order));
             return hash_ngram(words, offset, order);
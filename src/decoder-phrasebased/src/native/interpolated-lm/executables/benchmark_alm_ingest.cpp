@@ -0,0 +1,163 @@
+//
+// Created by Davide  Caroselli on 20/06/17.
+//
+
+#include <cmath>
+#include <thread>
+#include <random>
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <lm/AdaptiveLM.h>
+#include <util/chrono.h>
+
+using namespace std;
+using namespace mmt;
+using namespace mmt::ilm;
+
+namespace {
+    const size_t ERROR_IN_COMMAND_LINE = 1;
+    const size_t GENERIC_ERROR = 2;
+    const size_t SUCCESS = 0;
+
+    struct args_t {
+        string model_path;
+        uint8_t order = 5;
+        size_t sentences = 1000000;
+        size_t domains = 1;
+        size_t threads = 1;
+        size_t vocabulary = 100000;
+        size_t buffer_size = 100000;
+    };
+
+    // First word id used for the synthetic sentences, lower ids are reserved
+    const wid_t kFirstWord = 10;
+} // namespace
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+bool ParseArgs(int argc, const char *argv[], args_t *args) {
+    po::options_description desc("Measure the update throughput of an adaptive language model "
+                                         "with synthetic sentences sent by concurrent threads");
+    desc.add_options()
+            ("help,h", "print this help message")
+            ("model,m", po::value<string>()->required(), "path of the new model, it must not exist")
+            ("order,o", po::value<size_t>(), "the language model order (default is 5)")
+            ("sentences,s", po::value<size_t>(), "number of sentences (default is 1000000)")
+            ("domains,d", po::value<size_t>(), "number of domains (default is 1)")
+            ("threads,t", po::value<size_t>(), "number of threads sending updates (default is 1)")
+            ("vocabulary,v", po::value<size_t>(), "size of the vocabulary (default is 100000)")
+            ("buffer,b", po::value<size_t>(), "size of the buffer expressed in number of n-grams");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return false;
+        }
+
+        po::notify(vm);
+
+        args->model_path = vm["model"].as<string>();
+
+        if (vm.count("order"))
+            args->order = (uint8_t) vm["order"].as<size_t>();
+        if (vm.count("sentences"))
+            args->sentences = vm["sentences"].as<size_t>();
+        if (vm.count("domains"))
+            args->domains = vm["domains"].as<size_t>();
+        if (vm.count("threads"))
+            args->threads = vm["threads"].as<size_t>();
+        if (vm.count("vocabulary"))
+            args->vocabulary = vm["vocabulary"].as<size_t>();
+        if (vm.count("buffer"))
+            args->buffer_size = vm["buffer"].as<size_t>();
+    } catch (po::error &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Every thread sends its sentences on its own stream
+void SendUpdates(AdaptiveLM *lm, const args_t &args, stream_t stream, size_t sentences) {
+    mt19937 random(stream);
+    uniform_real_distribution<double> uniform(0., 1.);
+    uniform_int_distribution<size_t> length(5, 40);
+
+    vector<wid_t> empty;
+    alignment_t alignment;
+    vector<wid_t> sentence;
+
+    for (size_t i = 0; i < sentences; ++i) {
+        // Word ids follow a log-uniform distribution, that roughly resembles Zipf's law
+        sentence.resize(length(random));
+        for (auto word = sentence.begin(); word != sentence.end(); ++word)
+            *word = kFirstWord + (wid_t) pow((double) args.vocabulary, uniform(random)) - 1;
+
+        domain_t domain = (domain_t) (1 + (i * args.threads + stream) % args.domains);
+        lm->Add(updateid_t(stream, (seqid_t) i), domain, empty, sentence, alignment);
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    args_t args;
+
+    if (!ParseArgs(argc, argv, &args))
+        return ERROR_IN_COMMAND_LINE;
+
+    if (fs::exists(args.model_path)) {
+        cerr << "ERROR: model path already exists" << endl;
+        return GENERIC_ERROR;
+    }
+
+    if (args.threads == 0 || args.threads > 127 || args.domains == 0 || args.vocabulary == 0) {
+        cerr << "ERROR: invalid arguments" << endl;
+        return GENERIC_ERROR;
+    }
+
+    fs::create_directories(args.model_path);
+
+    AdaptiveLM lm(args.model_path, args.order, args.buffer_size, 1., 3600.);
+
+    size_t perThread = args.sentences / args.threads;
+
+    double begin = GetTime();
+
+    vector<thread> threads;
+    for (size_t i = 0; i < args.threads; ++i)
+        threads.push_back(thread(SendUpdates, &lm, ref(args), (stream_t) i, perThread));
+    for (auto thread = threads.begin(); thread != threads.end(); ++thread)
+        thread->join();
+
+    double enqueueTime = GetElapsedTime(begin);
+
+    // Wait for the last update of every stream to be written
+    bool completed = perThread == 0;
+    while (!completed) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+
+        unordered_map<stream_t, seqid_t> streams = lm.GetLatestUpdatesIdentifier();
+
+        completed = true;
+        for (size_t i = 0; i < args.threads && completed; ++i) {
+            auto stream = streams.find((stream_t) i);
+            completed = stream != streams.end() && stream->second == (seqid_t) (perThread - 1);
+        }
+    }
+
+    double totalTime = GetElapsedTime(begin);
+    size_t sentences = perThread * args.threads;
+
+    cout << "Sentences: " << sentences << " (" << args.threads << " threads, " << args.domains << " domains)"
+         << endl;
+    cout << "Enqueued in " << enqueueTime << "s (" << (sentences / enqueueTime) << " sentences/s)" << endl;
+    cout << "Written in " << totalTime << "s (" << (sentences / totalTime) << " sentences/s)" << endl;
+
+    return SUCCESS;
+}
@@ -0,0 +1,169 @@
+//
+// Created by Davide  Caroselli on 23/06/17.
+//
+
+#include <random>
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <lm/InterpolationKernel.h>
+#include <util/chrono.h>
+
+using namespace std;
+using namespace mmt;
+using namespace mmt::ilm;
+
+namespace {
+    const size_t ERROR_IN_COMMAND_LINE = 1;
+    const size_t GENERIC_ERROR = 2;
+    const size_t SUCCESS = 0;
+
+    struct args_t {
+        size_t domains = 16;
+        size_t levels = 1000;
+        size_t iterations = 10000;
+    };
+
+    // Synthetic backoff levels stored as structure-of-arrays, padded like InterpolationBuffer does
+    struct levels_t {
+        size_t size;
+        vector<float> weights;
+        vector<count_t> historyCounts;
+        vector<count_t> historySuccessors;
+        vector<count_t> ngramCounts;
+    };
+} // namespace
+
+namespace po = boost::program_options;
+
+bool ParseArgs(int argc, const char *argv[], args_t *args) {
+    po::options_description desc("Measure the throughput of the interpolation kernels of the adaptive "
+                                         "language model with synthetic counts");
+    desc.add_options()
+            ("help,h", "print this help message")
+            ("domains,d", po::value<size_t>(), "number of context domains (default is 16)")
+            ("levels,l", po::value<size_t>(), "number of distinct backoff levels (default is 1000)")
+            ("iterations,i", po::value<size_t>(), "number of passes over all the levels (default is 10000)");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return false;
+        }
+
+        po::notify(vm);
+
+        if (vm.count("domains"))
+            args->domains = vm["domains"].as<size_t>();
+        if (vm.count("levels"))
+            args->levels = vm["levels"].as<size_t>();
+        if (vm.count("iterations"))
+            args->iterations = vm["iterations"].as<size_t>();
+    } catch (po::error &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void GenerateLevels(const args_t &args, levels_t &levels) {
+    mt19937 random(1);
+    uniform_real_distribution<float> uniform(0.f, 1.f);
+    uniform_int_distribution<count_t> counts(0, 10000);
+
+    levels.size = ((args.domains + kInterpolationLanes - 1) / kInterpolationLanes) * kInterpolationLanes;
+
+    levels.weights.assign(levels.size, 0.f);
+    for (size_t d = 0; d < args.domains; ++d)
+        levels.weights[d] = uniform(random);
+
+    size_t total = levels.size * args.levels;
+    levels.historyCounts.assign(total, 0);
+    levels.historySuccessors.assign(total, 0);
+    levels.ngramCounts.assign(total, 0);
+
+    for (size_t l = 0; l < args.levels; ++l) {
+        for (size_t d = 0; d < args.domains; ++d) {
+            size_t i = l * levels.size + d;
+
+            // About one domain out of four does not contain the history
+            if (uniform(random) < .25f)
+                continue;
+
+            count_t history = 1 + counts(random);
+            levels.historyCounts[i] = history;
+            levels.historySuccessors[i] = 1 + history / 4;
+            levels.ngramCounts[i] = uniform(random) < .5f ? 0 : history / 3;
+        }
+    }
+}
+
+// Returns the elapsed time and stores in "outChecksum" the sum of all the results
+double Run(interpolation_kernel_t kernel, const args_t &args, const levels_t &levels, double *outChecksum) {
+    double checksum = 0.;
+    double begin = GetTime();
+
+    for (size_t it = 0; it < args.iterations; ++it) {
+        for (size_t l = 0; l < args.levels; ++l) {
+            size_t offset = l * levels.size;
+            float fstar, lambda;
+
+            kernel(levels.weights.data(), levels.historyCounts.data() + offset,
+                   levels.historySuccessors.data() + offset, levels.ngramCounts.data() + offset,
+                   levels.size, &fstar, &lambda);
+
+            checksum += fstar + lambda;
+        }
+    }
+
+    double time = GetElapsedTime(begin);
+    *outChecksum = checksum;
+
+    return time;
+}
+
+int main(int argc, const char *argv[]) {
+    args_t args;
+
+    if (!ParseArgs(argc, argv, &args))
+        return ERROR_IN_COMMAND_LINE;
+
+    if (args.domains == 0 || args.levels == 0 || args.iterations == 0) {
+        cerr << "ERROR: invalid arguments" << endl;
+        return GENERIC_ERROR;
+    }
+
+    levels_t levels;
+    GenerateLevels(args, levels);
+
+    size_t calls = args.levels * args.iterations;
+
+    double scalarChecksum;
+    double scalarTime = Run(InterpolateLevelScalar, args, levels, &scalarChecksum);
+
+    cout << "Domains: " << args.domains << " (" << levels.size << " with padding), "
+         << calls << " interpolations" << endl;
+    cout << "Scalar: " << scalarTime << "s (" << (calls / scalarTime) << " interpolations/s)" << endl;
+
+    if (!IsAVX2Supported()) {
+        cout << "AVX2: not supported" << endl;
+        return SUCCESS;
+    }
+
+    double avx2Checksum;
+    double avx2Time = Run(InterpolateLevelAVX2, args, levels, &avx2Checksum);
+
+    cout << "AVX2: " << avx2Time << "s (" << (calls / avx2Time) << " interpolations/s, "
+         << (scalarTime / avx2Time) << "x)" << endl;
+
+    if (avx2Checksum != scalarChecksum) {
+        cerr << "ERROR: kernels results differ (" << scalarChecksum << " != " << avx2Checksum << ")" << endl;
+        return GENERIC_ERROR;
+    }
+
+    return SUCCESS;
+}
@@ -3,10 +3,13 @@
 //
 
 #include <cstddef>
+#include <exception>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 #include <iostream>
 #include <db/NGramStorage.h>
+#include <db/NGramBulkLoader.h>
+#include <lm/Options.h>
 #include <sys/time.h>
 #include <corpus/CorpusReader.h>
 #ifdef _OPENMP
@@ -29,6 +32,7 @@ namespace {
         uint8_t order = 0x5;
 
         size_t buffer_size = 100000;
+        size_t threads = 0;
     };
 } // namespace
 
@@ -42,7 +46,9 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
             ("model,m", po::value<string>()->required(), "output model path")
             ("input,i", po::value<string>()->required(), "input folder with input corpora")
             ("order,o", po::value<size_t>(), "the language model order (default is 5)")
-            ("buffer,b", po::value<size_t>(), "size of the buffer expressed in number of n-grams");
+            ("buffer,b", po::value<size_t>(), "size of the buffer of every thread expressed in number of n-grams "
+                    "(default is 100000)")
+            ("threads,t", po::value<size_t>(), "number of threads (default is 2/3 of the available cores, at most 8)");
 
     po::variables_map vm;
     try {
@@ -64,6 +70,9 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
         if (vm.count("order"))
             args->order = (uint8_t) vm["order"].as<size_t>();
 
+        if (vm.count("threads"))
+            args->threads = vm["threads"].as<size_t>();
+
     } catch (po::error &e) {
         std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
         std::cerr << desc << std::endl;
@@ -93,43 +102,29 @@ double GetTime() {
     return (double) time.tv_sec + ((double) time.tv_usec / 1000000.);
 }
 
-void LoadCorpus(const string &corpus, NGramStorage &storage, uint8_t order, size_t buffer_size) {
+void LoadCorpus(const string &corpus, NGramBulkLoader::Shard *shard) {
     domain_t domain = (domain_t) stoi(fs::path(corpus).stem().string());
 
     CorpusReader reader(corpus);
-    NGramBatch batch(order, buffer_size);
-    size_t batches=1;
     vector<wid_t> sentence;
-    while(reader.Read(sentence)) {
-        if (!batch.Add(domain, sentence)) {
-            storage.PutBatch(batch);
-
-            ++batches;
-            batch.Clear();
-            batch.Add(domain, sentence);
-        }
-    }
 
-    if (!batch.IsEmpty()) {
-        storage.PutBatch(batch);
-        batch.Clear();
-    }
-    cerr << "loading domain:" << domain << " requires " << batches << " batches" << endl;
+    while (reader.Read(sentence))
+        shard->Add(domain, sentence);
 }
 
 int main(int argc, const char *argv[]) {
-#ifdef _OPENMP
-    int threads = std::min((thread::hardware_concurrency() * 2) / 3, 8U);
-
-    omp_set_dynamic(0);
-    omp_set_num_threads(threads);
-#endif
-
     args_t args;
 
     if (!ParseArgs(argc, argv, &args))
         return ERROR_IN_COMMAND_LINE;
 
+#ifdef _OPENMP
+    int threads = args.threads > 0 ? (int) args.threads : std::min((thread::hardware_concurrency() * 2) / 3, 8U);
+
+    omp_set_dynamic(0);
+    omp_set_num_threads(max(threads, 1));
+#endif
+
     if (!fs::exists(args.input_path) || !fs::is_directory(args.input_path)) {
         cerr << "ERROR: input path is not a valid directory" << endl;
         return GENERIC_ERROR;
@@ -141,17 +136,52 @@ int main(int argc, const char *argv[]) {
     vector<string> corpora;
     ListCorpora(args.input_path, corpora);
 
-    NGramStorage storage(args.model_path, args.order, true);
+    NGramStorage storage(args.model_path, args.order, Options().gc_timeout, true);
+
+    // Every thread counts the n-grams of its corpora in its own shard
+    NGramBulkLoader loader(&storage, (fs::path(args.model_path) / fs::path("_bulk")).string(), args.buffer_size);
+
+    // Exceptions can not escape the parallel region: the first one is rethrown after it
+    exception_ptr error;
+
+#pragma omp parallel
+    {
+        NGramBulkLoader::Shard *shard = loader.NewShard();
+
+#pragma omp for schedule(dynamic)
+        for (size_t i = 0; i < corpora.size(); ++i) {
+            string &corpus = corpora[i];
 
-#pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < corpora.size(); ++i) {
-        string &corpus = corpora[i];
-        double begin = GetTime();
-        LoadCorpus(corpus, storage, args.order, args.buffer_size);
-        double elapsed = GetTime() - begin;
-        cout << "Corpus " << corpus << " DONE in " << elapsed << "s" << endl;
+            try {
+                double begin = GetTime();
+                LoadCorpus(corpus, shard);
+                double elapsed = GetTime() - begin;
+                cout << "Corpus " << corpus << " DONE in " << elapsed << "s" << endl;
+            } catch (...) {
+#pragma omp critical(create_alm_error)
+                if (!error)
+                    error = current_exception();
+            }
+        }
+
+        try {
+            shard->Flush();
+        } catch (...) {
+#pragma omp critical(create_alm_error)
+            if (!error)
+                error = current_exception();
+        }
+
+        delete shard;
     }
 
-    storage.ForceCompaction();
+    if (error)
+        rethrow_exception(error);
+
+    // Sorted and fully merged tables are ingested as they are, no compaction is needed
+    double begin = GetTime();
+    loader.Load();
+    cout << "Model built in " << (GetTime() - begin) << "s" << endl;
+
     return SUCCESS;
 }
\ No newline at end of file
@@ -138,20 +138,16 @@ int main(int argc, const char *argv[]) {
     while (reader.Read(line)) {
         line.push_back(kVocabularyEndSymbol);
 
-        HistoryKey *historyKey = lm.MakeHistoryKey(sentenceBegin);
+        HistoryKey historyKey;
+        lm.MakeHistoryKey(sentenceBegin, &historyKey);
         float sentenceProbability = 0.0;
 
         for (auto word = line.begin(); word != line.end(); ++word) {
-            HistoryKey *outKey;
-
-            float wordProbability = lm.ComputeProbability(*word, historyKey, &args.context_map, &outKey);
-
-            delete historyKey;
-            historyKey = outKey;
+            float wordProbability = lm.ComputeProbability(*word, &historyKey, &args.context_map, &historyKey);
 
             cout << *word
                   << (lm.IsOOV(&args.context_map, *word) ? "[OOV] " : "") << " "
-                 << "Length: " << historyKey->length() << " "
+                 << "Length: " << historyKey.length() << " "
                  << wordProbability << "\t";
 
             sentenceProbability += wordProbability;
@@ -160,7 +156,6 @@ int main(int argc, const char *argv[]) {
 
         corpusProbability += sentenceProbability;
 
-        delete historyKey;
         cout << endl;
     }
 
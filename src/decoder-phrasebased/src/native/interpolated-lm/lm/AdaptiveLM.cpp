@@ -13,136 +13,151 @@ using namespace mmt::ilm;
 static const float kUnigramEpsilon = 1.f;
 static const size_t kDictionaryUpperBound = 10000000;
 
-namespace mmt {
-    namespace ilm {
-        struct AdaptiveLMHistoryKey : public HistoryKey {
-            vector<wid_t> words;
-
-            AdaptiveLMHistoryKey() {}
-
-            AdaptiveLMHistoryKey(const vector<wid_t> &ngram) {
-                words = ngram;
-            }
-
-            AdaptiveLMHistoryKey(const vector<wid_t> &ngram, size_t length) {
-                if (length > 0) {
-                    size_t words_length = std::min(length, ngram.size());
-                    size_t offset = ngram.size() - words_length;
-
-                    words.resize(words_length);
-                    std::copy(ngram.begin() + offset, ngram.end(), words.begin());
-                }
-            }
-
-            AdaptiveLMHistoryKey(vector<wid_t> history, const wid_t word, size_t length) {
-                if (length > 0) {
-                    size_t words_length = std::min(length, history.size() + 1);
-                    size_t offset = history.size() - words_length + 1;
-
-                    words.resize(words_length);
-                    std::copy(history.begin() + offset, history.end(), words.begin());
-                    words[words_length - 1] = word;
-                }
-            }
-
-            virtual size_t hash() const override {
-                return words.empty() ? 0 : hash_ngram(words, words.size());
-            }
-
-            virtual bool operator==(const HistoryKey &o) const override {
-                return words == ((AdaptiveLMHistoryKey &) o).words;
-            }
-
-            virtual size_t length() const override {
-                return words.size();
-            }
-        };
-    }
+// Writes in "outKey" the last "length" words of "words"
+static inline void SetHistoryWords(HistoryKey *outKey, const wid_t *words, size_t size, size_t length) {
+    size_t wordsLength = min(length, size);
+
+    // input and output may overlap
+    if (wordsLength > 0)
+        memmove(outKey->words, words + (size - wordsLength), wordsLength * sizeof(wid_t));
+    memset(outKey->words + wordsLength, 0, (kMaxHistoryLength - wordsLength) * sizeof(wid_t));
+
+    outKey->wordsLength = (uint8_t) wordsLength;
 }
 
 AdaptiveLM::AdaptiveLM(const string &modelPath, uint8_t order, size_t updateBufferSize,
-                       double updateMaxDelay, double gcTimeout) :
-        order(order), storage(modelPath, order, gcTimeout), updateManager(&storage, updateBufferSize, updateMaxDelay) {
+                       double updateMaxDelay, double gcTimeout, size_t hotTierDomains, size_t hotTierMaxEntries,
+                       size_t cacheSize) :
+        order(order), storage(modelPath, order, gcTimeout, false, hotTierDomains, hotTierMaxEntries),
+        updateManager(&storage, updateBufferSize, updateMaxDelay), cache(NULL) {
+    if (order > kMaxHistoryLength)
+        throw invalid_argument("Invalid order, maximum is " + to_string(kMaxHistoryLength));
+
+    if (cacheSize > 0)
+        cache = new AdaptiveLMCache(cacheSize);
+}
+
+AdaptiveLM::~AdaptiveLM() {
+    delete cache;
 }
 
 float AdaptiveLM::ComputeProbability(const wid_t word, const HistoryKey *historyKey, const context_t *context,
-                                     HistoryKey **outHistoryKey, AdaptiveLMCache *cache) const {
+                                     HistoryKey *outHistoryKey, uint8_t cacheOrder) const {
     if (context == nullptr || context->empty()) {
         if (outHistoryKey)
-            *outHistoryKey = new AdaptiveLMHistoryKey();
+            SetHistoryWords(outHistoryKey, NULL, 0, 0);
 
         return kNaturalLogZeroProbability;
     }
 
-    const AdaptiveLMHistoryKey *inKey = (AdaptiveLMHistoryKey *) historyKey;
-    assert(inKey != NULL);
+    assert(historyKey != NULL);
+
+    cachevalue_t result = ComputeProbability(context, historyKey->words, historyKey->wordsLength, word, cacheOrder);
+
+    if (outHistoryKey) {
+        wid_t ngram[kMaxHistoryLength + 1];
+        size_t size = historyKey->wordsLength;
 
-    cachevalue_t result = ComputeProbability(context, inKey->words, word, 0, inKey->words.size(), cache);
+        memcpy(ngram, historyKey->words, size * sizeof(wid_t));
+        ngram[size++] = word;
 
-    if (outHistoryKey)
-        *outHistoryKey = new AdaptiveLMHistoryKey(inKey->words, word, word == kVocabularyEndSymbol ? 0 : result.length);
+        SetHistoryWords(outHistoryKey, ngram, size, word == kVocabularyEndSymbol ? 0 : result.length);
+    }
 
     return result.probability > 0. ? log(result.probability) : kNaturalLogZeroProbability;
 }
 
-cachevalue_t AdaptiveLM::ComputeProbability(const context_t *context, const vector<wid_t> &history, const wid_t word,
-                                            const size_t start, const size_t end, AdaptiveLMCache *cache) const {
-    ngram_hash_t historyKey;
-    ngram_hash_t ngramKey;
+cachevalue_t AdaptiveLM::ComputeProbability(const context_t *context, const wid_t *history, size_t historyLength,
+                                            const wid_t word, uint8_t cacheOrder) const {
+    // Backoff level "start" is the n-gram history[start, end) + word: the level "end" is the unigram
+    static thread_local vector<ngram_hash_t> ngramKeys;
+    static thread_local vector<domain_t> domains;
+    static thread_local vector<ngram_hash_t> hashes;
+    static thread_local vector<counts_t> counts;
+    static thread_local InterpolationBuffer buffer;
 
-    if (start == end) {
-        historyKey = 0;
-        ngramKey = hash_ngram(word);
-    } else {
-        historyKey = hash_ngram(history, start, end - start);
-        ngramKey = hash_ngram(historyKey, word);
-    }
+    const size_t end = historyLength;
+
+    // Look for the longest cached n-gram, lower levels are not needed
+    ngramKeys.clear();
+
+    if (cache == NULL)
+        cacheOrder = 0;
+
+    // The fingerprint is computed once, all the levels share the same context and version
+    cachekey_t fingerprint = cacheOrder > 0 ? AdaptiveLMCache::MakeFingerprint(context, storage.GetVersion()) : 0;
 
     cachevalue_t result;
+    bool cacheHit = false;
 
-    bool isCachable = cache && cache->IsCacheable(end - start + 1);
-    bool cacheHit = isCachable && cache->Get(ngramKey, &result);
+    for (size_t start = 0; start <= end && !cacheHit; ++start) {
+        ngram_hash_t ngramKey = start == end ? hash_ngram(word) :
+                                hash_ngram(hash_ngram(history + start, end - start), word);
 
-    if (!cacheHit) {
-        if (start == end) { // compute the probability of the unigram; the most recent word exists for sure
-            result = ComputeUnigramProbability(context, ngramKey);
-        } else { //compute recursively the probability of the n-gram (n > 1)
-            float interpolatedFstar = 0.f;
-            float interpolatedLambda = 0.f;
-            uint8_t maxLength = 0;
+        if (end - start + 1 <= cacheOrder && cache->Get(AdaptiveLMCache::MakeKey(fingerprint, ngramKey), &result))
+            cacheHit = true;
+        else
+            ngramKeys.push_back(ngramKey);
+    }
 
-            for (context_t::const_iterator it = context->begin(); it != context->end(); ++it) {
-                counts_t domainHistoryCounts = storage.GetCounts(it->domain, historyKey);
+    size_t levels = ngramKeys.size();
+    if (levels == 0)
+        return result;
 
-                float fstar = 0.f;
-                float lambda = 1.f;
-                uint8_t length = 0;
+    bool computeUnigram = !cacheHit;
 
-                if (domainHistoryCounts.count > 0) {
-                    count_t domainNgramCount = storage.GetCounts(it->domain, ngramKey).count;
+    // Fetch the whole backoff chain for all the domains: the history and the n-gram
+    // counts of every level, plus the unigram and the word counts of the domain
+    hashes.clear();
+    for (size_t start = 0; start < levels; ++start) {
+        if (start == end) {
+            hashes.push_back(ngramKeys[start]);
+            hashes.push_back(kWordCountsHash);
+        } else {
+            hashes.push_back(hash_ngram(history + start, end - start));
+            hashes.push_back(ngramKeys[start]);
+        }
+    }
 
-                    if (domainNgramCount > 0) {
-                        fstar = (float) domainNgramCount / (domainHistoryCounts.count + domainHistoryCounts.successors);
-                        length = (uint8_t) min(end - start + 1, (size_t) (order - 1));
-                    }
+    domains.clear();
+    for (context_t::const_iterator it = context->begin(); it != context->end(); ++it)
+        domains.push_back(it->domain);
 
-                    lambda = (float) domainHistoryCounts.successors /
-                             (domainHistoryCounts.count + domainHistoryCounts.successors);
-                }
+    storage.GetCountsBatch(domains, hashes, counts);
 
-                interpolatedFstar += it->score * fstar;
-                interpolatedLambda += it->score * lambda;
-                maxLength = max(maxLength, (uint8_t) length);
-            }
+    // Compute the probabilities from the lowest level up
+    const size_t stride = hashes.size();
+    size_t start = levels;
 
-            cachevalue_t loResult = ComputeProbability(context, history, word, start + 1, end, cache);
+    if (computeUnigram) {
+        start--;
+        result = ComputeUnigramProbability(context, counts, stride, 2 * start);
 
-            result.probability = interpolatedFstar + interpolatedLambda * loResult.probability;
-            result.length = max(maxLength, loResult.length);
-        }
+        if (cacheOrder > 0)
+            cache->Put(AdaptiveLMCache::MakeKey(fingerprint, ngramKeys[start]), result);
+    }
+
+    // Every level is interpolated over the context domains by the SIMD kernel
+    if (start > 0)
+        buffer.SetContext(context);
+
+    while (start > 0) {
+        start--;
 
-        if (isCachable)
-            cache->Put(ngramKey, result);
+        float interpolatedFstar;
+        float interpolatedLambda;
+        uint8_t maxLength = 0;
+
+        buffer.LoadLevel(counts.data() + 2 * start, stride);
+
+        if (buffer.Interpolate(&interpolatedFstar, &interpolatedLambda))
+            maxLength = (uint8_t) min(end - start + 1, (size_t) (order - 1));
+
+        result.probability = interpolatedFstar + interpolatedLambda * result.probability;
+        result.length = max(maxLength, result.length);
+
+        if (end - start + 1 <= cacheOrder)
+            cache->Put(AdaptiveLMCache::MakeKey(fingerprint, ngramKeys[start]), result);
     }
 
     return result;
@@ -165,19 +180,21 @@ cachevalue_t AdaptiveLM::ComputeProbability(const context_t *context, const vect
 // If a Dictionary Upper Bound (DBU) larger than the actual dictionary size is given
 //  then the OOV_class frequency is set to (DUB - dictionary_size);
 //  otherwise the OOV_class freqeucny is set to actual dictionary size
-cachevalue_t AdaptiveLM::ComputeUnigramProbability(const context_t *context, ngram_hash_t wordKey) const {
+cachevalue_t AdaptiveLM::ComputeUnigramProbability(const context_t *context, const vector<counts_t> &counts,
+                                                   size_t stride, size_t index) const {
     bool isOOV = true;
     float interpolatedProbability = 0.f;
 
-    for (context_t::const_iterator it = context->begin(); it != context->end(); ++it) {
-        count_t wordCount; // This value includes also the occurrencies of the kVocabularyStartSymbol
-        count_t uniqueWordCount;
-        storage.GetWordCounts(it->domain, &uniqueWordCount, &wordCount);
+    const counts_t *domainCounts = counts.data() + index;
+
+    for (context_t::const_iterator it = context->begin(); it != context->end(); ++it, domainCounts += stride) {
+        count_t wordCount = domainCounts[1].count; // This value includes also the occurrencies of the kVocabularyStartSymbol
+        count_t uniqueWordCount = domainCounts[1].successors;
 
         count_t oovFrequency = OOVClassFrequency(uniqueWordCount);
         count_t den = (count_t) (wordCount + oovFrequency + kUnigramEpsilon * uniqueWordCount);
 
-        count_t unigramCount = storage.GetCounts(it->domain, wordKey).count;
+        count_t unigramCount = domainCounts[0].count;
 
         float probability;
 
@@ -200,12 +217,12 @@ cachevalue_t AdaptiveLM::ComputeUnigramProbability(const context_t *context, ngr
     return result;
 }
 
-HistoryKey *AdaptiveLM::MakeEmptyHistoryKey() const {
-    return new AdaptiveLMHistoryKey();
+void AdaptiveLM::MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const {
+    SetHistoryWords(outHistoryKey, NULL, 0, 0);
 }
 
-HistoryKey *AdaptiveLM::MakeHistoryKey(const vector<wid_t> &phrase) const {
-    return new AdaptiveLMHistoryKey(phrase, order);
+void AdaptiveLM::MakeHistoryKey(const vector<wid_t> &phrase, HistoryKey *outHistoryKey) const {
+    SetHistoryWords(outHistoryKey, phrase.data(), phrase.size(), order);
 }
 
 
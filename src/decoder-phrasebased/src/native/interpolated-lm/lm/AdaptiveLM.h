@@ -10,6 +10,7 @@
 #include <mmt/IncrementalModel.h>
 #include "LM.h"
 #include "AdaptiveLMCache.h"
+#include "InterpolationKernel.h"
 #include "BufferedUpdateManager.h"
 
 using namespace std;
@@ -22,24 +23,30 @@ namespace mmt {
         class AdaptiveLM : public LM, public IncrementalModel {
         public:
 
+            // If "cacheSize" is greater than 0, the probabilities are cached in a table
+            // of "cacheSize" entries shared by all the threads
             AdaptiveLM(const string &modelPath, uint8_t order, size_t updateBufferSize,
-                       double updateMaxDelay, double gcTimeout);
+                       double updateMaxDelay, double gcTimeout,
+                       size_t hotTierDomains = 0, size_t hotTierMaxEntries = 0, size_t cacheSize = 0);
+
+            virtual ~AdaptiveLM();
 
             /* LM */
 
             inline virtual float ComputeProbability(const wid_t word, const HistoryKey *historyKey,
                                                     const context_t *context,
-                                                    HistoryKey **outHistoryKey) const override {
-                return ComputeProbability(word, historyKey, context, outHistoryKey, NULL);
+                                                    HistoryKey *outHistoryKey) const override {
+                return ComputeProbability(word, historyKey, context, outHistoryKey, 0);
             }
 
+            // The probabilities of the n-grams up to "cacheOrder" are read from (and stored in) the cache
             float ComputeProbability(const wid_t word, const HistoryKey *historyKey,
-                                     const context_t *context, HistoryKey **outHistoryKey,
-                                     AdaptiveLMCache *cache) const;
+                                     const context_t *context, HistoryKey *outHistoryKey,
+                                     uint8_t cacheOrder) const;
 
-            virtual HistoryKey *MakeHistoryKey(const vector<wid_t> &phrase) const override;
+            virtual void MakeHistoryKey(const vector<wid_t> &phrase, HistoryKey *outHistoryKey) const override;
 
-            virtual HistoryKey *MakeEmptyHistoryKey() const override;
+            virtual void MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const override;
 
             virtual bool IsOOV(const context_t *context, const wid_t word) const override;
 
@@ -60,17 +67,18 @@ namespace mmt {
 
             NGramStorage storage;
             BufferedUpdateManager updateManager;
-
-            // Returns the probability (not in log space) of the ngram identified by the words
-            // in the range [start, end] stored in vector<wid_t>.
-            // "start" is the position of the least recent word to be considered;
-            // it must be larger than or equal to 0 and strictly lower than ngram.size().
-            // "end" is the position of the most recent word to be considered;
-            // it must be larger than or equal to 0 and strictly lower than ngram.size().
-            cachevalue_t ComputeProbability(const context_t *context, const vector<wid_t> &history, const wid_t word,
-                                            const size_t start, const size_t end, AdaptiveLMCache *cache) const;
-
-            cachevalue_t ComputeUnigramProbability(const context_t *context, ngram_hash_t wordKey) const;
+            AdaptiveLMCache *cache;
+
+            // Returns the probability (not in log space) of "word" given the whole "history",
+            // backing off down to the unigram. The counts of all the backoff levels that are not
+            // found in the cache are retrieved for all the context domains with a single batch.
+            cachevalue_t ComputeProbability(const context_t *context, const wid_t *history, size_t historyLength,
+                                            const wid_t word, uint8_t cacheOrder) const;
+
+            // "counts" contains, for every domain, "stride" entries: the unigram count is at
+            // position "index" and the word counts of the domain are at position "index + 1"
+            cachevalue_t ComputeUnigramProbability(const context_t *context, const vector<counts_t> &counts,
+                                                   size_t stride, size_t index) const;
 
             inline count_t OOVClassFrequency(const count_t dictionarySize) const;
 
@@ -5,8 +5,8 @@
 #ifndef ILM_ADAPTIVELMCACHE_H
 #define ILM_ADAPTIVELMCACHE_H
 
-#include <string>
-#include <unordered_map>
+#include <atomic>
+#include <cstring>
 #include <db/ngram_hash.h>
 #include "LM.h"
 
@@ -24,46 +24,97 @@ namespace mmt {
             cachevalue_t() : probability(0), length(0) {};
         };
 
+        // Fixed-capacity n-gram probability cache, shared by all the decoding threads.
+        //
+        // Keys combine the n-gram hash with a fingerprint of the context vector and of
+        // the storage version: entries computed before an update are never hit again and
+        // they are simply overwritten. The cache is direct-mapped and lock-free; every entry
+        // stores the value and the xor of key and value, so that a reader racing with
+        // a writer sees a mismatching key and reports a miss.
         class AdaptiveLMCache {
         public:
 
-            // Empirical estimate of n-grams, suggested values are:
-            //  - 100.000 words
-            //  - 500.000 2-grams
-            //  - 600.000 3-grams
-            //  - 600.000 4-grams
-            //  - 500.000 5-grams
-            AdaptiveLMCache(uint8_t order, size_t initialSize = 2000000) : order(order) {
-                cache.reserve(initialSize);
+            // The capacity is rounded up to a power of two; every entry takes 16 bytes
+            AdaptiveLMCache(size_t capacity) {
+                size_t size = 1;
+                while (size < capacity)
+                    size <<= 1;
+
+                mask = size - 1;
+                entries = new entry_t[size];
+            }
+
+            ~AdaptiveLMCache() {
+                delete[] entries;
+            }
+
+            static inline cachekey_t MakeFingerprint(const context_t *context, uint64_t version) {
+                cachekey_t fingerprint = Mix(version + 1);
+
+                for (auto it = context->begin(); it != context->end(); ++it) {
+                    uint32_t weight;
+                    memcpy(&weight, &it->score, sizeof(uint32_t));
+
+                    fingerprint = Mix(fingerprint ^ it->domain);
+                    fingerprint = Mix(fingerprint ^ weight);
+                }
+
+                return fingerprint;
             }
 
-            inline bool IsCacheable(size_t order) {
-                return order <= this->order;
+            static inline cachekey_t MakeKey(cachekey_t fingerprint, ngram_hash_t ngram) {
+                // bijective in "ngram", so that n-grams of the same context never collide
+                return Mix(ngram * 0x9E3779B97F4A7C15ULL ^ fingerprint);
             }
 
-            // store in the cache the entry
-            //   key(word, state) -> (probability, outStateLength)
-            //   if already present, replace the old value with the new value;
-            inline void Put(const ngram_hash_t key, const cachevalue_t &value) {
-                cache[key] = value;
+            inline void Put(const cachekey_t key, const cachevalue_t &value) {
+                uint32_t probability;
+                memcpy(&probability, &value.probability, sizeof(uint32_t));
+
+                uint64_t data = kValidBit | (((uint64_t) value.length) << 32) | probability;
+
+                entry_t &entry = entries[key & mask];
+                entry.data.store(data, memory_order_relaxed);
+                entry.check.store(key ^ data, memory_order_relaxed);
             }
 
-            // lookup in the cache the entry key(word, state), if found, fill the given parameters
-            // and return true, else return false
-            inline bool Get(const ngram_hash_t key, cachevalue_t *outValue) {
-                auto it = cache.find(key);
+            inline bool Get(const cachekey_t key, cachevalue_t *outValue) const {
+                const entry_t &entry = entries[key & mask];
+
+                uint64_t data = entry.data.load(memory_order_relaxed);
+                uint64_t check = entry.check.load(memory_order_relaxed);
 
-                if (it == cache.end()) {
+                if ((data & kValidBit) == 0 || (check ^ data) != key)
                     return false;
-                } else {
-                    *outValue = it->second;
-                    return true;
-                }
+
+                uint32_t probability = (uint32_t) data;
+                memcpy(&outValue->probability, &probability, sizeof(float));
+                outValue->length = (uint8_t) (data >> 32);
+
+                return true;
             }
 
         private:
-            const uint8_t order;
-            unordered_map <cachekey_t, cachevalue_t> cache;
+            static const uint64_t kValidBit = 1ULL << 63;
+
+            struct entry_t {
+                atomic<uint64_t> check;
+                atomic<uint64_t> data;
+
+                entry_t() : check(0), data(0) {};
+            };
+
+            entry_t *entries;
+            size_t mask;
+
+            static inline uint64_t Mix(uint64_t h) {
+                h ^= h >> 33;
+                h *= 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 33;
+                h *= 0xC4CEB9FE1A85EC53ULL;
+                h ^= h >> 33;
+                return h;
+            }
         };
 
     }
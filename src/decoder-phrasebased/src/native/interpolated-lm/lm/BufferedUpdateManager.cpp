@@ -2,14 +2,24 @@
 // Created by Davide  Caroselli on 19/09/16.
 //
 
+#include <thread>
 #include "BufferedUpdateManager.h"
 
 using namespace mmt::ilm;
 
-BufferedUpdateManager::BufferedUpdateManager(NGramStorage *storage, size_t bufferSize, double maxDelay) :
-        BackgroundPollingThread(maxDelay), storage(storage) {
-    foregroundBatch = new NGramBatch(storage->GetOrder(), bufferSize, storage->GetStreamsStatus());
-    backgroundBatch = new NGramBatch(storage->GetOrder(), bufferSize, storage->GetStreamsStatus());
+BufferedUpdateManager::BufferedUpdateManager(NGramStorage *storage, size_t bufferSize, double maxDelay,
+                                             size_t shards) :
+        BackgroundPollingThread(maxDelay), storage(storage), shards(max(shards, (size_t) 1)),
+        streams(storage->GetStreamsStatus()) {
+    // The total buffer size is split among the shards
+    size_t shardSize = max(bufferSize / this->shards.size(), (size_t) 1);
+
+    for (auto shard = this->shards.begin(); shard != this->shards.end(); ++shard) {
+        shard->batch = new NGramBatch(storage->GetOrder(), shardSize);
+        shard->spare = new NGramBatch(storage->GetOrder(), shardSize);
+    }
+
+    backgroundBatch = new NGramBatch(storage->GetOrder(), bufferSize, streams);
 
     Start();
 }
@@ -17,44 +27,80 @@ BufferedUpdateManager::BufferedUpdateManager(NGramStorage *storage, size_t buffe
 BufferedUpdateManager::~BufferedUpdateManager() {
     Stop();
 
-    delete foregroundBatch;
+    for (auto shard = shards.begin(); shard != shards.end(); ++shard) {
+        delete shard->batch;
+        delete shard->spare;
+    }
+
     delete backgroundBatch;
 }
 
+bool BufferedUpdateManager::SetStreamIfValid(const updateid_t &id) {
+    lock_guard<mutex> lock(streamsAccess);
+
+    if (streams.size() <= (size_t) id.stream_id)
+        streams.resize(id.stream_id + 1, -1);
+
+    if (streams[id.stream_id] < id.sentence_id) {
+        streams[id.stream_id] = id.sentence_id;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+// The update is enqueued in the first shard that is not full, starting from the one
+// of the current thread; if all of them are full, the background thread is awakened.
 #define UpdateManagerEnqueue(_line) \
-    bool success = false; \
+    size_t home = hash<thread::id>()(this_thread::get_id()); \
+\
+    while (true) { \
+        for (size_t i = 0; i < shards.size(); ++i) { \
+            shard_t &shard = shards[(home + i) % shards.size()]; \
+            lock_guard<mutex> lock(shard.access); \
+\
+            if (shard.batch->IsFull()) \
+                continue; \
+\
+            if (SetStreamIfValid(id)) \
+                _line; \
 \
-    while (!success) { \
-        batchAccess.lock(); \
-        success = _line; \
-        batchAccess.unlock(); \
+            return; \
+        } \
 \
-        if (!success) \
-            AwakeBackgroundThread(true); \
+        AwakeBackgroundThread(true); \
     }
 
 void BufferedUpdateManager::Add(const updateid_t &id, const domain_t domain, const vector<wid_t> &sentence) {
     UpdateManagerEnqueue(
-            foregroundBatch->Add(id, domain, sentence);
+            shard.batch->Add(domain, sentence)
     );
 }
 
 void BufferedUpdateManager::Delete(const mmt::updateid_t &id, const mmt::domain_t domain) {
     UpdateManagerEnqueue(
-            foregroundBatch->Delete(id, domain)
+            shard.batch->Delete(domain)
     );
 }
 
 void BufferedUpdateManager::BackgroundThreadRun() {
-    batchAccess.lock();
-    {
-        NGramBatch *tmp = backgroundBatch;
-        backgroundBatch = foregroundBatch;
-        foregroundBatch = tmp;
+    // All the shards are swapped together, so that the streams
+    // status is consistent with the content of the merged batch
+    for (auto shard = shards.begin(); shard != shards.end(); ++shard)
+        shard->access.lock();
 
-        foregroundBatch->Reset(backgroundBatch->GetStreams());
-    }
-    batchAccess.unlock();
+    streamsAccess.lock();
+    backgroundBatch->Reset(streams);
+    streamsAccess.unlock();
+
+    for (auto shard = shards.begin(); shard != shards.end(); ++shard)
+        swap(shard->batch, shard->spare);
+
+    for (auto shard = shards.rbegin(); shard != shards.rend(); ++shard)
+        shard->access.unlock();
+
+    for (auto shard = shards.begin(); shard != shards.end(); ++shard)
+        backgroundBatch->Merge(*shard->spare);
 
     if (!backgroundBatch->IsEmpty()) {
         storage->PutBatch(*backgroundBatch);
@@ -16,9 +16,13 @@
 namespace mmt {
     namespace ilm {
 
+        // Updates are buffered in "shards" independent batches, each one with its own lock, so that
+        // concurrent writers do not contend for the same batch; every thread starts from its own
+        // shard and moves to the next ones when it is full. The background thread merges the
+        // shards into a single batch before writing it to the storage.
         class BufferedUpdateManager : public BackgroundPollingThread {
         public:
-            BufferedUpdateManager(NGramStorage *storage, size_t bufferSize, double maxDelay);
+            BufferedUpdateManager(NGramStorage *storage, size_t bufferSize, double maxDelay, size_t shards = 8);
 
             ~BufferedUpdateManager();
 
@@ -27,12 +31,22 @@ namespace mmt {
             void Delete(const updateid_t &id, const domain_t domain);
 
         private:
+            struct shard_t {
+                mutex access;
+                NGramBatch *batch;
+                NGramBatch *spare; // accessed by the background thread only
+            };
+
             NGramStorage *storage;
 
-            NGramBatch *foregroundBatch;
+            vector<shard_t> shards;
             NGramBatch *backgroundBatch;
 
-            mutex batchAccess;
+            // Streams are shared by all the shards: it is always locked after the shard lock
+            mutex streamsAccess;
+            vector<seqid_t> streams;
+
+            bool SetStreamIfValid(const updateid_t &id);
 
             virtual void BackgroundThreadRun() override;
         };
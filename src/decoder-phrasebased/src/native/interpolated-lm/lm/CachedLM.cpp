@@ -3,25 +3,19 @@
 //
 
 #include "CachedLM.h"
-#include "AdaptiveLMCache.h"
 
 using namespace std;
 using namespace mmt::ilm;
 
-CachedLM::CachedLM(const InterpolatedLM *lm, uint8_t cacheOrder) : lm((InterpolatedLM *) lm) {
-    cache = new AdaptiveLMCache(cacheOrder);
+CachedLM::CachedLM(const InterpolatedLM *lm, uint8_t cacheOrder) : lm((InterpolatedLM *) lm), cacheOrder(cacheOrder) {
 }
 
-CachedLM::~CachedLM() {
-    delete (AdaptiveLMCache *) cache;
+void CachedLM::MakeHistoryKey(const vector<wid_t> &phrase, HistoryKey *outHistoryKey) const {
+    lm->MakeHistoryKey(phrase, outHistoryKey);
 }
 
-HistoryKey *CachedLM::MakeHistoryKey(const vector<wid_t> &phrase) const {
-    return lm->MakeHistoryKey(phrase);
-}
-
-HistoryKey *CachedLM::MakeEmptyHistoryKey() const {
-    return lm->MakeEmptyHistoryKey();
+void CachedLM::MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const {
+    lm->MakeEmptyHistoryKey(outHistoryKey);
 }
 
 bool CachedLM::IsOOV(const context_t *context, const wid_t word) const {
@@ -29,8 +23,8 @@ bool CachedLM::IsOOV(const context_t *context, const wid_t word) const {
 }
 
 float CachedLM::ComputeProbability(const wid_t word, const HistoryKey *historyKey, const context_t *context,
-                                        HistoryKey **outHistoryKey) const {
-    return lm->ComputeProbability(word, historyKey, context, outHistoryKey, cache);
+                                        HistoryKey *outHistoryKey) const {
+    return lm->ComputeProbability(word, historyKey, context, outHistoryKey, cacheOrder);
 }
 
 
@@ -17,24 +17,25 @@ using namespace std;
 namespace mmt {
     namespace ilm {
 
+        // View of an InterpolatedLM that reads and stores the probabilities of the n-grams
+        // up to "cacheOrder" in the cache shared by all the threads; it holds no state,
+        // so a single instance can be used by every thread and sentence.
         class CachedLM : public LM {
         public:
             CachedLM(const InterpolatedLM *lm, uint8_t cacheOrder = 3);
 
-            ~CachedLM();
-
             virtual float ComputeProbability(const wid_t word, const HistoryKey *historyKey,
-                                             const context_t *context, HistoryKey **outHistoryKey) const override;
+                                             const context_t *context, HistoryKey *outHistoryKey) const override;
 
-            virtual HistoryKey *MakeHistoryKey(const vector <wid_t> &phrase) const override;
+            virtual void MakeHistoryKey(const vector <wid_t> &phrase, HistoryKey *outHistoryKey) const override;
 
-            virtual HistoryKey *MakeEmptyHistoryKey() const override;
+            virtual void MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const override;
 
             virtual bool IsOOV(const context_t *context, const wid_t word) const override;
 
         private:
             InterpolatedLM *lm;
-            void *cache;
+            const uint8_t cacheOrder;
         };
 
     }
@@ -14,62 +14,19 @@ using namespace std;
 using namespace mmt;
 using namespace mmt::ilm;
 
-namespace mmt {
-    namespace ilm {
-
-        // The state of InterpolatedLM is always the combination of the static lm state and
-        // the adaptive lm state. This ensures the consistency even in the eventuality
-        // that the static lm does not contain all the n-grams of the adaptive lm.
-        struct ILMHistoryKey : public HistoryKey {
-
-            const HistoryKey *alm_key;
-            const HistoryKey *slm_key;
-
-            ILMHistoryKey(HistoryKey *alm_key, HistoryKey *slm_key) : alm_key(alm_key), slm_key(slm_key) {}
-
-            ~ILMHistoryKey() {
-                if (alm_key != NULL)
-                    delete alm_key;
-                if (slm_key != NULL)
-                    delete slm_key;
-            }
-
-            size_t hash() const override {
-                if (alm_key == NULL) {
-                    return slm_key == NULL ? 0 : slm_key->hash();
-                } else if (slm_key == NULL) {
-                    return alm_key->hash();
-                } else {
-                    return ((alm_key->hash() * 8978948897894561157ULL) ^ (slm_key->hash() * 17894857484156487943ULL));
-                }
-            }
-
-            bool operator==(const HistoryKey &other) const override {
-                ILMHistoryKey &o = (ILMHistoryKey &) other;
-                if (alm_key == NULL)
-                    return o.alm_key == NULL;
-                if (slm_key == NULL)
-                    return o.slm_key == NULL;
-
-                if (o.alm_key == NULL)
-                    return false;
-                if (o.slm_key == NULL)
-                    return false;
-
-                return (*alm_key) == (*o.alm_key) && (*slm_key) == (*o.slm_key);
-            }
-
-            virtual size_t length() const override {
-                if (alm_key == NULL)
-                    return slm_key == NULL ? 0 : slm_key->length();
-                else if (slm_key == NULL)
-                    return alm_key->length();
-                else
-                    return max(alm_key->length(), slm_key->length());
-            }
-        };
+// The state of InterpolatedLM is always the combination of the static lm state and
+// the adaptive lm state. This ensures the consistency even in the eventuality
+// that the static lm does not contain all the n-grams of the adaptive lm.
+// The fields of an inactive lm are left zeroed.
+
+static inline void ClearAdaptiveState(HistoryKey *key) {
+    memset(key->words, 0, sizeof(key->words));
+    key->wordsLength = 0;
+}
 
-    }
+static inline void ClearStaticState(HistoryKey *key) {
+    memset(key->staticState, 0, sizeof(key->staticState));
+    key->staticLength = 0;
 }
 
 struct InterpolatedLM::ilm_private {
@@ -118,7 +75,9 @@ InterpolatedLM::InterpolatedLM(const string &modelPath, const Options &options)
 
     if (self->is_alm_active)
         self->alm = new AdaptiveLM(almDir.string(), options.order, options.update_buffer_size,
-                                   options.update_max_delay, options.gc_timeout);
+                                   options.update_max_delay, options.gc_timeout,
+                                   options.hot_tier_domains, options.hot_tier_max_entries,
+                                   options.cache_size);
 
     if (self->is_slm_active)
         self->slm = StaticLM::LoadFromPath(slmFile.string(), options.static_lm);
@@ -132,14 +91,22 @@ InterpolatedLM::~InterpolatedLM() {
     delete self;
 }
 
-HistoryKey *InterpolatedLM::MakeHistoryKey(const vector<wid_t> &phrase) const {
-    return new ILMHistoryKey(self->alm ? self->alm->MakeHistoryKey(phrase) : NULL,
-                                 self->slm ? self->slm->MakeHistoryKey(phrase) : NULL);
+void InterpolatedLM::MakeHistoryKey(const vector<wid_t> &phrase, HistoryKey *outHistoryKey) const {
+    *outHistoryKey = HistoryKey();
+
+    if (self->alm)
+        self->alm->MakeHistoryKey(phrase, outHistoryKey);
+    if (self->slm)
+        self->slm->MakeHistoryKey(phrase, outHistoryKey);
 }
 
-HistoryKey *InterpolatedLM::MakeEmptyHistoryKey() const {
-    return new ILMHistoryKey(self->alm ? self->alm->MakeEmptyHistoryKey() : NULL,
-                                 self->slm ? self->slm->MakeEmptyHistoryKey() : NULL);
+void InterpolatedLM::MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const {
+    *outHistoryKey = HistoryKey();
+
+    if (self->alm)
+        self->alm->MakeEmptyHistoryKey(outHistoryKey);
+    if (self->slm)
+        self->slm->MakeEmptyHistoryKey(outHistoryKey);
 }
 
 bool InterpolatedLM::IsOOV(const context_t *context, const wid_t word) const {
@@ -164,12 +131,8 @@ static inline double log_sum(double log_a, double log_b) {
 }
 
 float InterpolatedLM::ComputeProbability(const wid_t word, const HistoryKey *historyKey, const context_t *context,
-                                  HistoryKey **outHistoryKey, void *cache) const {
-    const ILMHistoryKey *inKey = static_cast<const ILMHistoryKey *> (historyKey);
-    assert(inKey != NULL);
-
-    HistoryKey *alm_key = NULL;
-    HistoryKey *slm_key = NULL;
+                                  HistoryKey *outHistoryKey, uint8_t cacheOrder) const {
+    assert(historyKey != NULL);
 
     double result = kNaturalLogZeroProbability;
     float slm_probability = kNaturalLogZeroProbability;
@@ -178,11 +141,16 @@ float InterpolatedLM::ComputeProbability(const wid_t word, const HistoryKey *his
     bool use_slm = self->is_slm_active;
     bool use_alm = self->is_alm_active && context != NULL && !context->empty();
 
+    // Every lm writes only its own fields of the output key
     if (use_slm)
-        slm_probability = self->slm->ComputeProbability(word, inKey->slm_key, context, outHistoryKey ? &slm_key : NULL);
+        slm_probability = self->slm->ComputeProbability(word, historyKey, context, outHistoryKey);
+    else if (outHistoryKey)
+        ClearStaticState(outHistoryKey);
+
     if (use_alm)
-        alm_probability = self->alm->ComputeProbability(word, inKey->alm_key, context, outHistoryKey ? &alm_key : NULL,
-                                                        (AdaptiveLMCache *) cache);
+        alm_probability = self->alm->ComputeProbability(word, historyKey, context, outHistoryKey, cacheOrder);
+    else if (outHistoryKey)
+        ClearAdaptiveState(outHistoryKey);
 
     if (use_slm && use_alm) // we defined slm_weight == 1.0 - alm_weight
         result = log_sum(self->log_slm_weight + slm_probability, self->log_alm_weight + alm_probability);
@@ -191,9 +159,6 @@ float InterpolatedLM::ComputeProbability(const wid_t word, const HistoryKey *his
     else if (use_alm) // we force alm_weight = 1.0
         result = alm_probability;
 
-    if (outHistoryKey)
-        *outHistoryKey = new ILMHistoryKey(alm_key, slm_key);
-
     return (float) result;
 }
 
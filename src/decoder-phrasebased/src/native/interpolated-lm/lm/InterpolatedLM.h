@@ -29,13 +29,13 @@ namespace mmt {
 
             inline virtual float ComputeProbability(const wid_t word, const HistoryKey *historyKey,
                                                     const context_t *context,
-                                                    HistoryKey **outHistoryKey) const override {
-                return ComputeProbability(word, historyKey, context, outHistoryKey, NULL);
+                                                    HistoryKey *outHistoryKey) const override {
+                return ComputeProbability(word, historyKey, context, outHistoryKey, 0);
             }
 
-            virtual HistoryKey *MakeHistoryKey(const vector <wid_t> &phrase) const override;
+            virtual void MakeHistoryKey(const vector <wid_t> &phrase, HistoryKey *outHistoryKey) const override;
 
-            virtual HistoryKey *MakeEmptyHistoryKey() const override;
+            virtual void MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const override;
 
             virtual bool IsOOV(const context_t *context, const wid_t word) const override;
 
@@ -56,7 +56,7 @@ namespace mmt {
             ilm_private *self;
 
             float ComputeProbability(const wid_t word, const HistoryKey *historyKey,
-                                     const context_t *context, HistoryKey **outHistoryKey, void *cache) const;
+                                     const context_t *context, HistoryKey *outHistoryKey, uint8_t cacheOrder) const;
         };
 
     }
@@ -0,0 +1,163 @@
+//
+// Created by Davide  Caroselli on 23/06/17.
+//
+
+#include "InterpolationKernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ILM_HAVE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace mmt;
+using namespace mmt::ilm;
+
+static_assert(kInterpolationLanes == 8, "The AVX2 kernel processes 8 domains at a time");
+
+// Reduces the per-lane partial sums with the same pairing of the AVX2 kernel
+static inline float ReduceLanes(const float *lanes) {
+    float s0 = lanes[0] + lanes[4];
+    float s1 = lanes[1] + lanes[5];
+    float s2 = lanes[2] + lanes[6];
+    float s3 = lanes[3] + lanes[7];
+
+    return (s0 + s2) + (s1 + s3);
+}
+
+bool mmt::ilm::InterpolateLevelScalar(const float *weights, const count_t *historyCounts,
+                                      const count_t *historySuccessors, const count_t *ngramCounts,
+                                      size_t size, float *outFstar, float *outLambda) {
+    float fstarLanes[kInterpolationLanes] = {0};
+    float lambdaLanes[kInterpolationLanes] = {0};
+    bool found = false;
+
+    for (size_t i = 0; i < size; i += kInterpolationLanes) {
+        for (size_t lane = 0; lane < kInterpolationLanes; ++lane) {
+            size_t d = i + lane;
+
+            float fstar = 0.f;
+            float lambda = 1.f;
+
+            if (historyCounts[d] > 0) {
+                float den = (float) (historyCounts[d] + historySuccessors[d]);
+
+                if (ngramCounts[d] > 0) {
+                    fstar = (float) ngramCounts[d] / den;
+                    found = true;
+                }
+
+                lambda = (float) historySuccessors[d] / den;
+            }
+
+            fstarLanes[lane] = fstarLanes[lane] + weights[d] * fstar;
+            lambdaLanes[lane] = lambdaLanes[lane] + weights[d] * lambda;
+        }
+    }
+
+    *outFstar = ReduceLanes(fstarLanes);
+    *outLambda = ReduceLanes(lambdaLanes);
+
+    return found;
+}
+
+#ifdef ILM_HAVE_AVX2_KERNEL
+
+__attribute__((target("avx2")))
+static inline float ReduceLanesAVX2(__m256 lanes) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(lanes), _mm256_extractf128_ps(lanes, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2")))
+bool mmt::ilm::InterpolateLevelAVX2(const float *weights, const count_t *historyCounts,
+                                    const count_t *historySuccessors, const count_t *ngramCounts,
+                                    size_t size, float *outFstar, float *outLambda) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256 one = _mm256_set1_ps(1.f);
+
+    __m256 fstarSum = _mm256_setzero_ps();
+    __m256 lambdaSum = _mm256_setzero_ps();
+    __m256i foundMask = zero;
+
+    for (size_t i = 0; i < size; i += kInterpolationLanes) {
+        // Counts are below 2^31, the signed conversion is exact
+        __m256i history = _mm256_loadu_si256((const __m256i *) (historyCounts + i));
+        __m256i successors = _mm256_loadu_si256((const __m256i *) (historySuccessors + i));
+        __m256i ngrams = _mm256_loadu_si256((const __m256i *) (ngramCounts + i));
+        __m256 weight = _mm256_loadu_ps(weights + i);
+
+        __m256i hasHistory = _mm256_xor_si256(_mm256_cmpeq_epi32(history, zero), _mm256_set1_epi32(-1));
+        __m256i hasNgram = _mm256_andnot_si256(_mm256_cmpeq_epi32(ngrams, zero), hasHistory);
+
+        // Lanes without history divide by zero, their result is discarded by the blends
+        __m256 den = _mm256_cvtepi32_ps(_mm256_add_epi32(history, successors));
+        __m256 fstar = _mm256_div_ps(_mm256_cvtepi32_ps(ngrams), den);
+        __m256 lambda = _mm256_div_ps(_mm256_cvtepi32_ps(successors), den);
+
+        fstar = _mm256_and_ps(fstar, _mm256_castsi256_ps(hasNgram));
+        lambda = _mm256_blendv_ps(one, lambda, _mm256_castsi256_ps(hasHistory));
+
+        fstarSum = _mm256_add_ps(fstarSum, _mm256_mul_ps(weight, fstar));
+        lambdaSum = _mm256_add_ps(lambdaSum, _mm256_mul_ps(weight, lambda));
+        foundMask = _mm256_or_si256(foundMask, hasNgram);
+    }
+
+    *outFstar = ReduceLanesAVX2(fstarSum);
+    *outLambda = ReduceLanesAVX2(lambdaSum);
+
+    return !_mm256_testz_si256(foundMask, foundMask);
+}
+
+bool mmt::ilm::IsAVX2Supported() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#else
+
+bool mmt::ilm::InterpolateLevelAVX2(const float *weights, const count_t *historyCounts,
+                                    const count_t *historySuccessors, const count_t *ngramCounts,
+                                    size_t size, float *outFstar, float *outLambda) {
+    return InterpolateLevelScalar(weights, historyCounts, historySuccessors, ngramCounts, size, outFstar, outLambda);
+}
+
+bool mmt::ilm::IsAVX2Supported() {
+    return false;
+}
+
+#endif
+
+interpolation_kernel_t mmt::ilm::GetInterpolationKernel() {
+    return IsAVX2Supported() ? InterpolateLevelAVX2 : InterpolateLevelScalar;
+}
+
+/* InterpolationBuffer */
+
+InterpolationBuffer::InterpolationBuffer() : kernel(GetInterpolationKernel()), size(0) {
+}
+
+void InterpolationBuffer::SetContext(const context_t *context) {
+    size = context->size();
+    size_t paddedSize = ((size + kInterpolationLanes - 1) / kInterpolationLanes) * kInterpolationLanes;
+
+    // Padding domains have zero weight and zero counts, they do not contribute to the sums
+    weights.assign(paddedSize, 0.f);
+    historyCounts.assign(paddedSize, 0);
+    historySuccessors.assign(paddedSize, 0);
+    ngramCounts.assign(paddedSize, 0);
+
+    for (size_t d = 0; d < size; ++d)
+        weights[d] = context->at(d).score;
+}
+
+void InterpolationBuffer::LoadLevel(const counts_t *counts, size_t stride) {
+    for (size_t d = 0; d < size; ++d, counts += stride) {
+        historyCounts[d] = counts[0].count;
+        historySuccessors[d] = counts[0].successors;
+        ngramCounts[d] = counts[1].count;
+    }
+}
@@ -0,0 +1,75 @@
+//
+// Created by Davide  Caroselli on 23/06/17.
+//
+
+#ifndef ILM_INTERPOLATIONKERNEL_H
+#define ILM_INTERPOLATIONKERNEL_H
+
+#include <cstddef>
+#include <vector>
+#include <mmt/sentence.h>
+#include <db/counts.h>
+
+namespace mmt {
+    namespace ilm {
+
+        // Number of domains processed together by the kernels; buffers are padded to a multiple of it
+        static const size_t kInterpolationLanes = 8;
+
+        // Interpolates one backoff level over the context domains, given as structure-of-arrays
+        // padded with zero weights and counts. For every domain d with history counts, it computes
+        //     fstar(d) = ngramCounts[d] / (historyCounts[d] + historySuccessors[d])
+        //     lambda(d) = historySuccessors[d] / (historyCounts[d] + historySuccessors[d])
+        // while fstar(d) = 0 and lambda(d) = 1 otherwise, and it stores in outFstar and outLambda
+        // the sums of fstar(d) and lambda(d) weighted by weights[d].
+        // Returns true if at least one domain contains the n-gram.
+        //
+        // All the implementations sum the terms in the same order, so that they give the same results.
+        typedef bool (*interpolation_kernel_t)(const float *weights, const count_t *historyCounts,
+                                               const count_t *historySuccessors, const count_t *ngramCounts,
+                                               size_t size, float *outFstar, float *outLambda);
+
+        bool InterpolateLevelScalar(const float *weights, const count_t *historyCounts,
+                                    const count_t *historySuccessors, const count_t *ngramCounts,
+                                    size_t size, float *outFstar, float *outLambda);
+
+        // Available only if IsAVX2Supported() returns true
+        bool InterpolateLevelAVX2(const float *weights, const count_t *historyCounts,
+                                  const count_t *historySuccessors, const count_t *ngramCounts,
+                                  size_t size, float *outFstar, float *outLambda);
+
+        bool IsAVX2Supported();
+
+        // The fastest kernel supported by the current CPU
+        interpolation_kernel_t GetInterpolationKernel();
+
+        // Structure-of-arrays copy of the counts of one backoff level for all the context domains
+        class InterpolationBuffer {
+        public:
+            InterpolationBuffer();
+
+            void SetContext(const context_t *context);
+
+            // "counts" points to the history counts of the first domain, immediately followed by
+            // the n-gram counts; the counts of the next domain are "stride" positions later
+            void LoadLevel(const counts_t *counts, size_t stride);
+
+            inline bool Interpolate(float *outFstar, float *outLambda) const {
+                return kernel(weights.data(), historyCounts.data(), historySuccessors.data(), ngramCounts.data(),
+                              weights.size(), outFstar, outLambda);
+            }
+
+        private:
+            const interpolation_kernel_t kernel;
+
+            size_t size;
+            std::vector<float> weights;
+            std::vector<count_t> historyCounts;
+            std::vector<count_t> historySuccessors;
+            std::vector<count_t> ngramCounts;
+        };
+
+    }
+}
+
+#endif //ILM_INTERPOLATIONKERNEL_H
@@ -6,6 +6,8 @@
 #define ILM_LM_H
 
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <mmt/sentence.h>
@@ -15,29 +17,64 @@ using namespace std;
 namespace mmt {
     namespace ilm {
 
+        // Maximum number of words in the history of an adaptive lm state
+        static const size_t kMaxHistoryLength = 15;
+
+        // Size (in 32-bit words) of the opaque static lm state
+        static const size_t kStaticStateSize = 16;
+
+        // Fixed-size LM state, it is meant to be stored by value. Every LM fully writes
+        // its own fields, leaving unused entries zeroed, so that keys can be hashed and
+        // compared bytewise; the InterpolatedLM state is the union of the two.
         struct HistoryKey {
-            virtual size_t hash() const = 0;
+            // Adaptive lm: the most recent words of the history, the oldest first
+            wid_t words[kMaxHistoryLength];
+            // Static lm: opaque KenLM state
+            uint32_t staticState[kStaticStateSize];
+
+            uint8_t wordsLength;
+            uint8_t staticLength;
+            uint8_t reserved[2];
+
+            HistoryKey() {
+                memset(this, 0, sizeof(HistoryKey));
+            }
 
-            virtual bool operator==(const HistoryKey &other) const = 0;
+            inline size_t hash() const {
+                const uint32_t *data = (const uint32_t *) this;
 
-            virtual size_t length() const = 0;
+                uint64_t h = 1;
+                for (size_t i = 0; i < sizeof(HistoryKey) / sizeof(uint32_t); ++i)
+                    h = (h * 8978948897894561157ULL) ^ ((1 + (uint64_t) data[i]) * 17894857484156487943ULL);
 
-            virtual ~HistoryKey() {};
+                return (size_t) h;
+            }
+
+            inline bool operator==(const HistoryKey &other) const {
+                return memcmp(this, &other, sizeof(HistoryKey)) == 0;
+            }
+
+            inline size_t length() const {
+                return max(wordsLength, staticLength);
+            }
         };
 
+        static_assert(sizeof(HistoryKey) % sizeof(uint32_t) == 0, "HistoryKey must not contain padding");
+
         const wid_t kVocabularyStartSymbol = 1;
         const wid_t kVocabularyEndSymbol = 2;
 
         class LM {
         public:
 
-            // Returned value must be le natural log of the ngram probability
+            // Returned value must be le natural log of the ngram probability;
+            // "outHistoryKey" can be NULL or the same object of "historyKey"
             virtual float ComputeProbability(const wid_t word, const HistoryKey *historyKey, const context_t *context,
-                                             HistoryKey **outHistoryKey) const = 0;
+                                             HistoryKey *outHistoryKey) const = 0;
 
-            virtual HistoryKey *MakeHistoryKey(const vector <wid_t> &phrase) const = 0;
+            virtual void MakeHistoryKey(const vector <wid_t> &phrase, HistoryKey *outHistoryKey) const = 0;
 
-            virtual HistoryKey *MakeEmptyHistoryKey() const = 0;
+            virtual void MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const = 0;
 
             virtual bool IsOOV(const context_t *context, const wid_t word) const = 0;
         };
@@ -45,6 +45,23 @@ namespace mmt {
             // Time in seconds between Garbage Collector activations
             double gc_timeout = 120.; // seconds
 
+            /* Hot tier */
+
+            // Number of the most active domains whose counts are kept
+            // in memory; 0 disables the hot tier.
+            size_t hot_tier_domains = 0;
+
+            // Domains with more n-grams than this limit are never
+            // loaded in memory.
+            size_t hot_tier_max_entries = 10000000; // number of n-grams
+
+            /* Probability cache */
+
+            // Number of entries of the probability cache shared by all
+            // the threads (16 bytes each); entries are invalidated by
+            // every update. A value of 0 disables the cache.
+            size_t cache_size = 1 << 21; // number of entries
+
             /* Static LanguageModel options */
 
             enum StaticLMType {
@@ -2,54 +2,96 @@
 // Created by Davide  Caroselli on 07/09/16.
 //
 
+#include <lm/enumerate_vocab.hh>
 #include "StaticLM.h"
 
 using namespace mmt::ilm;
 
 namespace mmt {
     namespace ilm {
-        struct KenLMHistoryKey : public HistoryKey {
-            lm::ngram::State state;
+        static_assert(sizeof(lm::ngram::State) <= kStaticStateSize * sizeof(uint32_t),
+                      "KenLM state does not fit in HistoryKey");
 
-            KenLMHistoryKey(const lm::ngram::State &state) : state(state) {};
+        static inline void GetState(const HistoryKey *key, lm::ngram::State &outState) {
+            memcpy(&outState, key->staticState, sizeof(lm::ngram::State));
+        }
 
-            KenLMHistoryKey(const HistoryKey &o) {
-                const KenLMHistoryKey &other = static_cast<const KenLMHistoryKey &>(o);
-                state = other.state;
-            }
+        static inline void SetState(HistoryKey *key, const lm::ngram::State &state) {
+            // Only the relevant fields are copied: padding and unused entries must be zero
+            lm::ngram::State canonical;
+            memset(&canonical, 0, sizeof(lm::ngram::State));
 
-            virtual size_t hash() const override {
-                return hash_value(state);
+            canonical.length = state.length;
+            for (unsigned char i = 0; i < state.length; ++i) {
+                canonical.words[i] = state.words[i];
+                canonical.backoff[i] = state.backoff[i];
             }
 
-            virtual bool operator==(const HistoryKey &o) const override {
-                const KenLMHistoryKey &other = static_cast<const KenLMHistoryKey &>(o);
-                return state == other.state;
-            }
+            memset(key->staticState, 0, sizeof(key->staticState));
+            memcpy(key->staticState, &canonical, sizeof(lm::ngram::State));
+            key->staticLength = state.length;
+        }
+
+        // Words with a larger id are looked up by string
+        static const wid_t kMaxIndexedWord = 1 << 26;
+
+        // Collects the KenLM index of every numeric word, so that word ids
+        // can be converted without formatting and hashing a string
+        class WordIndexCollector : public lm::EnumerateVocab {
+        public:
+            WordIndexCollector(vector<lm::WordIndex> &indexes) : indexes(indexes) {}
+
+            void Add(lm::WordIndex index, const StringPiece &str) override {
+                if (str.empty() || str.size() > 8 || (str.size() > 1 && str[0] == '0'))
+                    return;
+
+                wid_t word = 0;
+                for (const char *c = str.data(); c != str.data() + str.size(); ++c) {
+                    if (*c < '0' || *c > '9')
+                        return;
+                    word = word * 10 + (*c - '0');
+                }
 
-            virtual size_t length() const override {
-                return state.Length();
+                if (word >= kMaxIndexedWord)
+                    return;
+
+                if (word >= indexes.size())
+                    indexes.resize(max((size_t) word + 1, indexes.size() * 2), 0);
+                indexes[word] = index;
             }
+
+        private:
+            vector<lm::WordIndex> &indexes;
         };
 
         template<class Model>
         class StaticLMImpl : public StaticLM {
         public:
-            StaticLMImpl(const string &modelPath, const lm::ngram::Config config);
+            StaticLMImpl(const string &modelPath, lm::ngram::Config config);
 
             ~StaticLMImpl();
 
             float ComputeProbability(const wid_t word, const HistoryKey *historyKey, const context_t *context,
-                                     HistoryKey **outHistoryKey) const override;
+                                     HistoryKey *outHistoryKey) const override;
 
-            HistoryKey *MakeHistoryKey(const vector<wid_t> &phrase) const override;
+            void MakeHistoryKey(const vector<wid_t> &phrase, HistoryKey *outHistoryKey) const override;
 
-            HistoryKey *MakeEmptyHistoryKey() const override;
+            void MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const override;
 
             bool IsOOV(const context_t *context, const wid_t word) const override;
 
         private:
             Model *model;
+            vector<lm::WordIndex> wordIndexes; // wid_t -> KenLM index, 0 (<unk>) if missing
+
+            inline lm::WordIndex GetWordIndex(const wid_t word) const {
+                if (word < wordIndexes.size())
+                    return wordIndexes[word];
+                else if (word < kMaxIndexedWord)
+                    return model->GetVocabulary().NotFound();
+                else
+                    return model->GetVocabulary().Index(std::to_string(word));
+            }
         };
 
     }
@@ -92,7 +134,10 @@ StaticLM *StaticLM::LoadFromPath(const string &modelPath, const Options::StaticL
 }
 
 template<class Model>
-StaticLMImpl<Model>::StaticLMImpl(const string &modelPath, const lm::ngram::Config config) {
+StaticLMImpl<Model>::StaticLMImpl(const string &modelPath, lm::ngram::Config config) {
+    WordIndexCollector collector(wordIndexes);
+    config.enumerate_vocab = &collector;
+
     model = new Model(modelPath.c_str(), config);
 }
 
@@ -102,55 +147,53 @@ StaticLMImpl<Model>::~StaticLMImpl() {
 }
 
 template<class Model>
-HistoryKey *StaticLMImpl<Model>::MakeHistoryKey(const vector<wid_t> &phrase) const {
+void StaticLMImpl<Model>::MakeHistoryKey(const vector<wid_t> &phrase, HistoryKey *outHistoryKey) const {
     lm::ngram::State state0 = model->NullContextState();
     lm::ngram::State state1;
 
     for (vector<wid_t>::const_iterator it = phrase.begin(); it != phrase.end(); ++it) {
         lm::WordIndex vocab;
 
-        // convert integer wid_t code into lm::WordIndex (through a double conversion from/to std::string)
         if (*it == kVocabularyStartSymbol) {
             vocab = model->GetVocabulary().BeginSentence();
         } else {
-            vocab = model->GetVocabulary().Index(std::to_string(*it));
+            vocab = GetWordIndex(*it);
         }
         model->Score(state0, vocab, state1);
         std::swap(state0, state1);
     }
 
-    return new KenLMHistoryKey(state0);
+    SetState(outHistoryKey, state0);
 }
 
 template<class Model>
-HistoryKey *StaticLMImpl<Model>::MakeEmptyHistoryKey() const {
-    return new KenLMHistoryKey(model->NullContextState());
+void StaticLMImpl<Model>::MakeEmptyHistoryKey(HistoryKey *outHistoryKey) const {
+    SetState(outHistoryKey, model->NullContextState());
 }
 
 template<class Model>
 bool StaticLMImpl<Model>::IsOOV(const context_t *context, const wid_t word) const {
-    lm::WordIndex vocab = model->GetVocabulary().Index(std::to_string(word));
-    return (vocab == model->GetVocabulary().NotFound());
+    return GetWordIndex(word) == model->GetVocabulary().NotFound();
 }
 
 template<class Model>
 float StaticLMImpl<Model>::ComputeProbability(const wid_t word, const HistoryKey *historyKey,
-                                              const context_t *context, HistoryKey **outHistoryKey) const {
+                                              const context_t *context, HistoryKey *outHistoryKey) const {
     // get the input state
-    const KenLMHistoryKey *inKey = static_cast<const KenLMHistoryKey *> (historyKey);
-    assert(inKey != NULL);
+    assert(historyKey != NULL);
+
+    lm::ngram::State in_state;
+    GetState(historyKey, in_state);
 
-    const lm::ngram::State &in_state = inKey->state;
     const lm::base::Vocabulary &vocabulary = model->GetVocabulary();
 
-    const lm::WordIndex wordIndex = (word == kVocabularyEndSymbol) ? vocabulary.EndSentence() : vocabulary.Index(
-            std::to_string(word));
+    const lm::WordIndex wordIndex = (word == kVocabularyEndSymbol) ? vocabulary.EndSentence() : GetWordIndex(word);
 
     lm::ngram::State state;
     float prob = model->FullScore(in_state, wordIndex, state).prob;
 
     if (outHistoryKey)
-        *outHistoryKey = new KenLMHistoryKey(word == kVocabularyEndSymbol ? model->NullContextState() : state);
+        SetState(outHistoryKey, word == kVocabularyEndSymbol ? model->NullContextState() : state);
 
     return prob * 2.30258509299405f; // log10 to natural log
 }
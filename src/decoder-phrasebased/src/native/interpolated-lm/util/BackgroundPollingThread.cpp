@@ -12,7 +12,7 @@ BackgroundPollingThread::BackgroundPollingThread(double timeout) : waitTimeout(t
 }
 
 void BackgroundPollingThread::AwakeBackgroundThread(bool wait) {
-    awakeCondition.notify_one();
+    awakeCondition.notify_all();
 
     if (wait) {
         unique_lock<mutex> lock(awakeMutex);
@@ -31,7 +31,7 @@ void BackgroundPollingThread::RunInBackground() {
             BackgroundThreadRun();
 
         lock.unlock();
-        awakeCondition.notify_one();
+        awakeCondition.notify_all();
     }
 }
 
@@ -1,9 +1,11 @@
 #include <iostream>
+#include <exception>
 
 #include <mmt/sentence.h>
 #include <sapt/PhraseTable.h>
 #include <suffixarray/UpdateBatch.h>
 #include <suffixarray/SuffixArray.h>
+#include <suffixarray/SuffixArrayBulkLoader.h>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 #include <thread>
@@ -30,6 +32,7 @@ namespace {
         string target_lang;
 
         size_t buffer_size = 100000;
+        size_t threads = 0;
     };
 } // namespace
 
@@ -44,7 +47,9 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
             ("source,s", po::value<string>()->required(), "source language")
             ("target,t", po::value<string>()->required(), "target language")
             ("input,i", po::value<string>()->required(), "input folder with input corpora")
-            ("buffer,b", po::value<size_t>(), "size of the buffer");
+            ("buffer,b", po::value<size_t>(), "size of the buffer of every thread expressed in number of sentence pairs "
+                    "(default is 100000)")
+            ("threads", po::value<size_t>(), "number of threads (default is 2/3 of the available cores, at most 8)");
 
     po::variables_map vm;
     try {
@@ -64,6 +69,8 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
 
         if (vm.count("buffer"))
             args->buffer_size = vm["buffer"].as<size_t>();
+        if (vm.count("threads"))
+            args->threads = vm["threads"].as<size_t>();
     } catch (po::error &e) {
         std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
         std::cerr << desc << std::endl;
@@ -73,44 +80,32 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
     return true;
 }
 
-void LoadCorpus(const BilingualCorpus &corpus, SuffixArray &index, size_t buffer_size) {
+void LoadCorpus(const BilingualCorpus &corpus, SuffixArrayBulkLoader::Shard *shard) {
     domain_t domain = corpus.GetDomain();
 
     CorpusReader reader(corpus);
-    UpdateBatch batch(buffer_size, vector<seqid_t>());
 
     vector<wid_t> source;
     vector<wid_t> target;
     alignment_t alignment;
 
-    while(reader.Read(source, target, alignment)) {
-        if (!batch.Add(domain, source, target, alignment)) {
-            index.PutBatch(batch);
-
-            batch.Clear();
-            batch.Add(domain, source, target, alignment);
-        }
-    }
-
-    if (!batch.IsEmpty()) {
-        index.PutBatch(batch);
-        batch.Clear();
-    }
+    while (reader.Read(source, target, alignment))
+        shard->Add(domain, source, target, alignment);
 }
 
 int main(int argc, const char *argv[]) {
-#ifdef _OPENMP
-    int threads = std::min((thread::hardware_concurrency() * 2) / 3, 8U);
-
-    omp_set_dynamic(0);
-    omp_set_num_threads(threads);
-#endif
-
     args_t args;
 
     if (!ParseArgs(argc, argv, &args))
         return ERROR_IN_COMMAND_LINE;
 
+#ifdef _OPENMP
+    int threads = args.threads > 0 ? (int) args.threads : std::min((thread::hardware_concurrency() * 2) / 3, 8U);
+
+    omp_set_dynamic(0);
+    omp_set_num_threads(max(threads, 1));
+#endif
+
     if (!fs::exists(args.input_path) || !fs::is_directory(args.input_path)) {
         cerr << "ERROR: input path is not a valid directory" << endl;
         return GENERIC_ERROR;
@@ -125,17 +120,50 @@ int main(int argc, const char *argv[]) {
     vector<BilingualCorpus> corpora;
     BilingualCorpus::List(args.input_path, args.source_lang, args.target_lang, corpora);
 
-#pragma omp parallel for schedule(dynamic)
-    for (size_t i = 0; i < corpora.size(); ++i) {
-        BilingualCorpus &corpus = corpora[i];
+    // Every thread indexes its corpora in its own shard
+    SuffixArrayBulkLoader loader(&index, (fs::path(args.model_path) / fs::path("_bulk")).string(), args.buffer_size);
+
+    // Exceptions can not escape the parallel region: the first one is rethrown after it
+    exception_ptr error;
+
+#pragma omp parallel
+    {
+        SuffixArrayBulkLoader::Shard *shard = loader.NewShard();
+
+#pragma omp for schedule(dynamic)
+        for (size_t i = 0; i < corpora.size(); ++i) {
+            BilingualCorpus &corpus = corpora[i];
+
+            try {
+                double begin = GetTime();
+                LoadCorpus(corpus, shard);
+                double elapsed = GetElapsedTime(begin);
+                cout << "Corpus " << corpus.GetDomain() << " DONE in " << elapsed << "s" << endl;
+            } catch (...) {
+#pragma omp critical(sapt_build_error)
+                if (!error)
+                    error = current_exception();
+            }
+        }
+
+        try {
+            shard->Flush();
+        } catch (...) {
+#pragma omp critical(sapt_build_error)
+            if (!error)
+                error = current_exception();
+        }
 
-        double begin = GetTime();
-        LoadCorpus(corpus, index, args.buffer_size);
-        double elapsed = GetElapsedTime(begin);
-        cout << "Corpus " << corpus.GetDomain() << " DONE in " << elapsed << "s" << endl;
+        delete shard;
     }
 
-    index.ForceCompaction();
+    if (error)
+        rethrow_exception(error);
+
+    // Sorted and fully merged tables are ingested as they are, no compaction is needed
+    double begin = GetTime();
+    loader.Load();
+    cout << "Index built in " << GetElapsedTime(begin) << "s" << endl;
 
     return SUCCESS;
 }
\ No newline at end of file
@@ -2,10 +2,12 @@
 
 #include <mmt/sentence.h>
 #include <sapt/PhraseTable.h>
+#include <sapt/TranslationOptionBuilder.h>
 #include <suffixarray/UpdateBatch.h>
 #include <suffixarray/SuffixArray.h>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
+#include <util/chrono.h>
 
 using namespace std;
 using namespace mmt;
@@ -21,6 +23,7 @@ namespace {
         context_t context;
         size_t sample_limit = 1000;
         bool quiet = false;
+        size_t benchmark = 0;
     };
 } // namespace
 
@@ -53,7 +56,8 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
             ("model,m", po::value<string>()->required(), "output model path")
             ("context,c", po::value<string>(), "context map in the format <id>:<w>[,<id>:<w>]")
             ("sample,s", po::value<size_t>(), "number of samples (default is 100)")
-            ("quiet,q", "prints only number of match");
+            ("quiet,q", "prints only number of match")
+            ("benchmark,b", po::value<size_t>(), "extract translation options from the samples N times and print the average extraction time");
 
 
     po::variables_map vm;
@@ -80,6 +84,9 @@ bool ParseArgs(int argc, const char *argv[], args_t *args) {
         if (vm.count("quiet"))
             args->quiet = true;
 
+        if (vm.count("benchmark"))
+            args->benchmark = vm["benchmark"].as<size_t>();
+
     } catch (po::error &e) {
         cerr << "ERROR: " << e.what() << endl << endl;
         cerr << desc << endl;
@@ -125,6 +132,7 @@ int main(int argc, const char *argv[]) {
 
     string line;
     vector<wid_t> sourcePhrase;
+    double totalExtractionTime = 0;
 
     while (getline(cin, line)) {
         ParseSentenceLine(line, sourcePhrase);
@@ -159,7 +167,29 @@ int main(int argc, const char *argv[]) {
             }
         }
         cout << "Found " << NumberOfsamples << " samples" << endl;
+
+        if (args.benchmark > 0) {
+            size_t validSamples = 0;
+            size_t numberOfOptions = 0;
+
+            double beginTime = GetTime();
+            for (size_t i = 0; i < args.benchmark; ++i) {
+                vector<TranslationOptionBuilder> builders;
+                validSamples = 0;
+
+                TranslationOptionBuilder::Extract(sourcePhrase, samples, builders, validSamples);
+                numberOfOptions = builders.size();
+            }
+            double elapsed = GetElapsedTime(beginTime);
+            totalExtractionTime += elapsed;
+
+            cout << "Extracted " << numberOfOptions << " options from " << validSamples << " valid samples in "
+                 << (elapsed * 1000. / args.benchmark) << "ms" << endl;
+        }
     }
 
+    if (args.benchmark > 0)
+        cout << "Total extraction time: " << (totalExtractionTime * 1000. / args.benchmark) << "ms" << endl;
+
     return SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+//
+// Created by Davide  Caroselli on 14/06/17.
+//
+
+#include <cmath>
+#include "LexicalScorer.h"
+
+using namespace mmt;
+using namespace mmt::sapt;
+
+const size_t LexicalScorer::kMemoSize;
+const size_t LexicalScorer::kMemoMaxLoad;
+const uint64_t LexicalScorer::kEmptyKey;
+
+LexicalScorer::LexicalScorer(Aligner *aligner, const LexicalTable *forward, const LexicalTable *backward)
+        : aligner(aligner), forward(forward), backward(backward), memoCount(0) {
+    entry_t empty;
+    empty.key = kEmptyKey;
+    empty.forward = 0.f;
+    empty.backward = 0.f;
+
+    memo.resize(kMemoSize, empty);
+}
+
+void LexicalScorer::GetProbabilities(wid_t source, wid_t target, float &fwdProb, float &bwdProb) {
+    uint64_t key = (((uint64_t) source) << 32) | target;
+
+    size_t i = (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (kMemoSize - 1);
+    while (memo[i].key != kEmptyKey) {
+        if (memo[i].key == key) {
+            fwdProb = memo[i].forward;
+            bwdProb = memo[i].backward;
+            return;
+        }
+
+        i = (i + 1) & (kMemoSize - 1);
+    }
+
+    if (forward && backward) {
+        fwdProb = forward->Get(source, target);  // P(target | source)
+        bwdProb = backward->Get(target, source); // P(source | target)
+    } else {
+        fwdProb = aligner->GetForwardProbability(source, target);
+        bwdProb = aligner->GetBackwardProbability(source, target);
+    }
+
+    // when the memo is full it is emptied, so that a long-lived scorer keeps caching
+    if (memoCount == kMemoMaxLoad) {
+        for (auto entry = memo.begin(); entry != memo.end(); ++entry)
+            entry->key = kEmptyKey;
+        memoCount = 0;
+
+        i = (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (kMemoSize - 1);
+    }
+
+    memo[i].key = key;
+    memo[i].forward = fwdProb;
+    memo[i].backward = bwdProb;
+    memoCount++;
+}
+
+void LexicalScorer::GetScores(const vector<wid_t> &phrase, const TranslationOption &option,
+                              float &fwdScore, float &bwdScore) {
+    const vector<wid_t> &targetPhrase = option.targetPhrase;
+    const alignment_t &alignment = option.alignment;
+
+    size_t sSize = phrase.size();
+    size_t tSize = targetPhrase.size();
+
+    // Computes the lexical probabilities on the best alignment only;
+    // alignment points are scanned once per word: phrases are short
+    // and this requires no temporary storage.
+    float fwdProb, bwdProb;
+
+    fwdScore = 0.0;
+    for (size_t ti = 0; ti < tSize; ++ti) {
+        float tmpProb = 0.0;
+        size_t tmpSize = 0;
+
+        for (auto a = alignment.begin(); a != alignment.end(); ++a) {
+            if (a->second == ti) {
+                GetProbabilities(phrase[a->first], targetPhrase[ti], fwdProb, bwdProb);
+                tmpProb += fwdProb;  // P(tWord | sWord)
+                tmpSize++;
+            }
+        }
+
+        if (tmpSize > 0)
+            tmpProb /= tmpSize;
+        else
+            tmpProb = GetTargetNullProbability(targetPhrase[ti]);
+
+        // should never happen that tmpProb <= 0
+        fwdScore += (tmpProb <= 0.0) ? -9 : log(tmpProb);
+    }
+
+    bwdScore = 0.0;
+    for (size_t si = 0; si < sSize; ++si) {
+        float tmpProb = 0.0;
+        size_t tmpSize = 0;
+
+        for (auto a = alignment.begin(); a != alignment.end(); ++a) {
+            if (a->first == si) {
+                GetProbabilities(phrase[si], targetPhrase[a->second], fwdProb, bwdProb);
+                tmpProb += bwdProb;  // P(sWord | tWord)
+                tmpSize++;
+            }
+        }
+
+        if (tmpSize > 0)
+            tmpProb /= tmpSize;
+        else
+            tmpProb = GetSourceNullProbability(phrase[si]);
+
+        // should never happen that tmpProb <= 0
+        bwdScore += (tmpProb <= 0.0) ? -9 : log(tmpProb);
+    }
+}
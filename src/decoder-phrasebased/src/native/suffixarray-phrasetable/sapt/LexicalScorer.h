@@ -0,0 +1,63 @@
+//
+// Created by Davide  Caroselli on 14/06/17.
+//
+
+#ifndef SAPT_LEXICALSCORER_H
+#define SAPT_LEXICALSCORER_H
+
+#include <vector>
+#include <sstream>
+#include <mmt/sentence.h>
+#include <mmt/aligner/Aligner.h>
+#include "TranslationOption.h"
+
+using namespace std;
+
+namespace mmt {
+    namespace sapt {
+
+        // Computes the lexical scores of translation options memoizing the word
+        // pair probabilities; the memo is allocated once, so that scores are
+        // computed without heap allocations. Instances are not thread-safe and
+        // they are meant to be reused for many phrases, even across sentences.
+        class LexicalScorer {
+        public:
+            // If available, lexical tables are used instead of the aligner
+            LexicalScorer(Aligner *aligner, const LexicalTable *forward = NULL, const LexicalTable *backward = NULL);
+
+            void GetScores(const vector<wid_t> &phrase, const TranslationOption &option,
+                           float &fwdScore, float &bwdScore);
+
+        private:
+            static const size_t kMemoSize = 1 << 13; // must be a power of two
+            static const size_t kMemoMaxLoad = kMemoSize / 2;
+            static const uint64_t kEmptyKey = UINT64_MAX;
+
+            struct entry_t {
+                uint64_t key;
+                float forward;
+                float backward;
+            };
+
+            Aligner *aligner;
+            const LexicalTable *forward;
+            const LexicalTable *backward;
+
+            vector<entry_t> memo;
+            size_t memoCount;
+
+            void GetProbabilities(wid_t source, wid_t target, float &fwdProb, float &bwdProb);
+
+            inline float GetSourceNullProbability(wid_t source) {
+                return forward ? forward->Get(source, kAlignerNullWord) : aligner->GetSourceNullProbability(source);
+            }
+
+            inline float GetTargetNullProbability(wid_t target) {
+                return forward ? forward->Get(kAlignerNullWord, target) : aligner->GetTargetNullProbability(target);
+            }
+        };
+
+    }
+}
+
+#endif //SAPT_LEXICALSCORER_H
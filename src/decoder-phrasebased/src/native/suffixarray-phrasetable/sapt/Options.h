@@ -23,6 +23,19 @@ namespace mmt {
             // up search time while raising the index size.
             uint8_t prefix_length = 5;
 
+            // Maximum number of threads used to collect the translation
+            // options of a sentence: every thread processes a different
+            // subset of start positions. A value of 1 disables the
+            // parallel lookup; this option has no effect if the library
+            // has been compiled without OpenMP.
+            size_t lookup_threads = 1;
+
+            // Maximum number of phrases whose translation options are
+            // cached and shared among all translation requests; a value
+            // of 0 disables the cache. Cached options are automatically
+            // discarded when the index changes.
+            size_t cache_size = 10000; // number of source phrases
+
             /* Updates */
 
             // Updates are flushed to disk when one of the following
@@ -3,6 +3,7 @@
 //
 
 #include <algorithm>
+#include <mutex>
 #include <boost/math/distributions/binomial.hpp>
 #include <suffixarray/SuffixArray.h>
 #include <util/hashutils.h>
@@ -10,6 +11,8 @@
 #include "PhraseTable.h"
 #include "UpdateManager.h"
 #include "TranslationOptionBuilder.h"
+#include "TranslationOptionCache.h"
+#include "LexicalScorer.h"
 
 using namespace mmt;
 using namespace mmt::sapt;
@@ -17,22 +20,47 @@ using namespace mmt::sapt;
 struct PhraseTable::pt_private {
     SuffixArray *index;
     UpdateManager *updates;
+    TranslationOptionCache *cache;
     Aligner *aligner;
 
+    bool hasLexicalTables;
+    LexicalTable forwardLexicon;
+    LexicalTable backwardLexicon;
+
     size_t numberOfSamples;
+    size_t lookupThreads;
+
+    // Idle scorers of the single-phrase lookups: a thread takes one for the
+    // duration of a lookup, so that the memo is not allocated at every cache miss
+    mutex scorersAccess;
+    vector<LexicalScorer *> idleScorers;
+
+    LexicalScorer *NewLexicalScorer();
+
+    LexicalScorer *AcquireLexicalScorer();
+
+    void ReleaseLexicalScorer(LexicalScorer *scorer);
 };
 
 PhraseTable::PhraseTable(const string &modelPath, const Options &options, Aligner *aligner) {
     self = new pt_private();
     self->index = new SuffixArray(modelPath, options.prefix_length, options.gc_timeout, options.gc_buffer_size);
     self->updates = new UpdateManager(self->index, options.update_buffer_size, options.update_max_delay);
+    self->cache = options.cache_size > 0 ? new TranslationOptionCache(options.cache_size) : NULL;
     self->aligner = aligner;
+    self->hasLexicalTables = aligner && aligner->ExportLexicalTables(self->forwardLexicon, self->backwardLexicon);
     self->numberOfSamples = options.samples;
+    self->lookupThreads = max(options.lookup_threads, (size_t) 1);
 }
 
 PhraseTable::~PhraseTable() {
     delete self->updates;
+    delete self->cache;
     delete self->index;
+
+    for (auto scorer = self->idleScorers.begin(); scorer != self->idleScorers.end(); ++scorer)
+        delete *scorer;
+
     delete self;
 }
 
@@ -61,57 +89,6 @@ unordered_map<stream_t, seqid_t> PhraseTable::GetLatestUpdatesIdentifier() {
 
 /* Translation Options scoring */
 
-static void GetLexicalScores(Aligner *aligner, const vector<wid_t> &phrase, const TranslationOption &option,
-                             float &fwdScore, float &bwdScore) {
-    vector<vector<float>> fwdWordProb(option.targetPhrase.size());
-    vector<vector<float>> bwdWordProb(phrase.size());
-    size_t sSize = phrase.size();
-    size_t tSize = option.targetPhrase.size();
-
-    // Computes the lexical probabilities on the best alignment only
-    for (auto a = option.alignment.begin(); a != option.alignment.end(); ++a) {
-        wid_t sWord = phrase[a->first];
-        wid_t tWord = option.targetPhrase[a->second];
-        fwdWordProb[a->second].push_back(aligner->GetForwardProbability(sWord, tWord));  // P(tWord | sWord)
-        bwdWordProb[a->first].push_back(aligner->GetBackwardProbability(sWord, tWord));  // P(sWord | tWord)
-
-    }
-    fwdScore = 0.0;
-    for (size_t ti = 0; ti < tSize; ++ti) {
-        float tmpProb = 0.0;
-        size_t tmpSize = fwdWordProb[ti].size();
-
-        if (tmpSize > 0) {
-            for (size_t i = 0; i < tmpSize; ++i) {
-                tmpProb += fwdWordProb[ti][i];
-            }
-            tmpProb /= tmpSize;
-        } else {
-            tmpProb = aligner->GetTargetNullProbability(option.targetPhrase[ti]);
-        }
-        // should never happen that tmpProb <= 0
-        fwdScore += (tmpProb <= 0.0) ? -9 : log(tmpProb);
-    }
-
-    bwdScore = 0.0;
-    for (size_t si = 0; si < sSize; ++si) {
-        float tmpProb = 0.0;
-        size_t tmpSize = bwdWordProb[si].size();
-
-        if (tmpSize > 0) {
-            for (size_t i = 0; i < tmpSize; ++i) {
-                tmpProb += bwdWordProb[si][i];
-            }
-            tmpProb /= tmpSize;
-        } else {
-            tmpProb = aligner->GetSourceNullProbability(phrase[si]);
-        }
-
-        // should never happen that tmpProb <= 0
-        bwdScore += (tmpProb <= 0.0) ? -9 : log(tmpProb);
-    }
-}
-
 static float lbop(float succ, float tries, float confidence) {
     if (confidence == 0)
         return succ / tries;
@@ -119,7 +96,7 @@ static float lbop(float succ, float tries, float confidence) {
         return (float) boost::math::binomial_distribution<>::find_lower_bound_on_p(tries, succ, confidence);
 }
 
-static void MakeTranslationOptions(SuffixArray *index, Aligner *aligner,
+static void MakeTranslationOptions(SuffixArray *index, LexicalScorer *scorer,
                                    const vector<wid_t> &phrase, const vector<sample_t> &samples,
                                    vector<TranslationOption> &output) {
 
@@ -134,8 +111,17 @@ static void MakeTranslationOptions(SuffixArray *index, Aligner *aligner,
     size_t SampleSourceFrequency = validSamples;
     size_t GlobalSourceFrequency = index->CountOccurrences(true, phrase);
 
-    for (auto entry = builders.begin(); entry != builders.end(); ++entry) {
-        size_t GlobalTargetFrequency = index->CountOccurrences(false, entry->GetPhrase());
+    vector<vector<wid_t>> targetPhrases;
+    targetPhrases.reserve(builders.size());
+    for (auto entry = builders.begin(); entry != builders.end(); ++entry)
+        targetPhrases.push_back(entry->GetPhrase());
+
+    vector<size_t> GlobalTargetFrequencies;
+    index->CountOccurrences(false, targetPhrases, GlobalTargetFrequencies);
+
+    for (size_t i = 0; i < builders.size(); ++i) {
+        TranslationOptionBuilder *entry = &builders[i];
+        size_t GlobalTargetFrequency = GlobalTargetFrequencies[i];
 
         float fwdScore = log(lbop(entry->GetCount(),
                                   std::max(entry->GetCount(), SampleSourceFrequency),
@@ -152,8 +138,8 @@ static void MakeTranslationOptions(SuffixArray *index, Aligner *aligner,
         option.targetPhrase = entry->GetPhrase();
         option.orientations = entry->GetOrientations();
 
-        if (aligner)
-            GetLexicalScores(aligner, phrase, option, fwdLexScore, bwdLexScore);
+        if (scorer)
+            scorer->GetScores(phrase, option, fwdLexScore, bwdLexScore);
 
         option.scores[ForwardProbabilityScore] = fwdScore;
         option.scores[BackwardProbabilityScore] = min(0.f, bwdScore);
@@ -166,12 +152,54 @@ static void MakeTranslationOptions(SuffixArray *index, Aligner *aligner,
 
 /* SAPT methods */
 
+LexicalScorer *PhraseTable::pt_private::NewLexicalScorer() {
+    if (aligner == NULL)
+        return NULL;
+
+    return hasLexicalTables ? new LexicalScorer(aligner, &forwardLexicon, &backwardLexicon) :
+           new LexicalScorer(aligner);
+}
+
+LexicalScorer *PhraseTable::pt_private::AcquireLexicalScorer() {
+    {
+        lock_guard<mutex> lock(scorersAccess);
+
+        if (!idleScorers.empty()) {
+            LexicalScorer *scorer = idleScorers.back();
+            idleScorers.pop_back();
+            return scorer;
+        }
+    }
+
+    return NewLexicalScorer();
+}
+
+void PhraseTable::pt_private::ReleaseLexicalScorer(LexicalScorer *scorer) {
+    if (scorer == NULL)
+        return;
+
+    lock_guard<mutex> lock(scorersAccess);
+    idleScorers.push_back(scorer);
+}
+
 vector<TranslationOption> PhraseTable::GetTranslationOptions(const vector<wid_t> &phrase, context_t *context) {
+    // version must be read before the index is queried
+    uint64_t version = self->index->GetVersion();
+    TranslationOptionCache::context_key_t contextKey = TranslationOptionCache::QuantizeContext(context);
+
+    vector<TranslationOption> result;
+    if (self->cache && self->cache->Get(phrase, contextKey, version, result))
+        return result;
+
     vector<sample_t> samples;
     self->index->GetRandomSamples(phrase, self->numberOfSamples, samples, context);
 
-    vector<TranslationOption> result;
-    MakeTranslationOptions(self->index, self->aligner, phrase, samples, result);
+    LexicalScorer *scorer = self->AcquireLexicalScorer();
+    MakeTranslationOptions(self->index, scorer, phrase, samples, result);
+    self->ReleaseLexicalScorer(scorer);
+
+    if (self->cache && !samples.empty())
+        self->cache->Put(phrase, contextKey, version, result);
 
     return result;
 }
@@ -179,32 +207,72 @@ vector<TranslationOption> PhraseTable::GetTranslationOptions(const vector<wid_t>
 translation_table_t PhraseTable::GetAllTranslationOptions(const vector<wid_t> &sentence, context_t *context) {
     translation_table_t ttable;
 
-    for (size_t start = 0; start < sentence.size(); ++start) {
-        Collector *collector = self->index->NewCollector(context);
+    // version must be read before the index is queried
+    uint64_t version = self->index->GetVersion();
+    TranslationOptionCache::context_key_t contextKey = TranslationOptionCache::QuantizeContext(context);
+
+    // Every start position is processed independently: the translation table
+    // is the only shared object and it is accessed within a critical section.
+    // Every thread has its own lexical scorer, reused for the whole sentence.
+    int threads = (int) max(min(self->lookupThreads, sentence.size()), (size_t) 1);
+
+#pragma omp parallel num_threads(threads) if(threads > 1)
+    {
+        LexicalScorer *scorer = self->NewLexicalScorer();
+
+#pragma omp for schedule(dynamic)
+        for (size_t start = 0; start < sentence.size(); ++start) {
+            Collector *collector = self->index->NewCollector(context);
+
+            vector<wid_t> phrase;
+            vector<wid_t> phraseDelta;
+
+            for (size_t end = start; end < sentence.size(); ++end) {
+                wid_t word = sentence[end];
+                phrase.push_back(word);
+                phraseDelta.push_back(word);
 
-        vector<wid_t> phrase;
-        vector<wid_t> phraseDelta;
+                bool isKnownPhrase;
 
-        for (size_t end = start; end < sentence.size(); ++end) {
-            wid_t word = sentence[end];
-            phrase.push_back(word);
-            phraseDelta.push_back(word);
+#pragma omp critical(sapt_ttable)
+                isKnownPhrase = ttable.find(phrase) != ttable.end();
 
-            if (ttable.find(phrase) == ttable.end()) {
-                vector<sample_t> samples;
-                collector->Extend(phraseDelta, self->numberOfSamples, samples);
-                phraseDelta.clear();
+                if (!isKnownPhrase && self->cache) {
+                    vector<TranslationOption> options;
 
-                if (samples.empty())
-                    break;
+                    // Options of a cached phrase are not sampled again: the collector
+                    // is extended with the pending words once a longer phrase misses.
+                    if (self->cache->Get(phrase, contextKey, version, options)) {
+#pragma omp critical(sapt_ttable)
+                        ttable.emplace(phrase, options);
 
-                vector<TranslationOption> options;
-                MakeTranslationOptions(self->index, self->aligner, phrase, samples, options);
+                        isKnownPhrase = true;
+                    }
+                }
 
-                ttable[phrase] = options;
+                if (!isKnownPhrase) {
+                    vector<sample_t> samples;
+                    collector->Extend(phraseDelta, self->numberOfSamples, samples);
+                    phraseDelta.clear();
+
+                    if (samples.empty())
+                        break;
+
+                    vector<TranslationOption> options;
+                    MakeTranslationOptions(self->index, scorer, phrase, samples, options);
+
+                    if (self->cache)
+                        self->cache->Put(phrase, contextKey, version, options);
+
+#pragma omp critical(sapt_ttable)
+                    ttable.emplace(phrase, options);
+                }
             }
+
+            delete collector;
         }
-       delete collector;
+
+        delete scorer;
     }
 
     return ttable;
@@ -4,6 +4,7 @@
 
 #include <util/hashutils.h>
 #include <cassert>
+#include <algorithm>
 #include "TranslationOptionBuilder.h"
 
 using namespace mmt;
@@ -12,6 +13,81 @@ using namespace mmt::sapt;
 // returns lowerBound <= var <= upperBound
 #define InRange(lowerBound, var, upperBound) (lowerBound <= var && var <= upperBound)
 
+/* Alignment tables */
+
+namespace {
+
+    // Alignment points of a row (or column) of the alignment matrix
+    struct links_t {
+        const uint16_t *begin;
+        const uint16_t *end;
+
+        inline size_t size() const {
+            return (size_t) (end - begin);
+        }
+
+        inline uint16_t front() const {
+            return *begin;
+        }
+
+        inline uint16_t back() const {
+            return *(end - 1);
+        }
+    };
+
+    // Flat representation of one direction of the alignment matrix: links of
+    // row "i" are stored in [offsets[i], offsets[i + 1]) following the order
+    // of the alignment points. Buffers are reused among subsequent builds.
+    class AlignmentTable {
+    public:
+        void Build(size_t length, const alignment_t &alignment, bool byTarget) {
+            this->length = length;
+
+            offsets.assign(length + 1, 0);
+            for (auto a = alignment.begin(); a != alignment.end(); ++a)
+                offsets[(byTarget ? a->second : a->first) + 1]++;
+            for (size_t i = 1; i <= length; ++i)
+                offsets[i] += offsets[i - 1];
+
+            links.resize(alignment.size());
+            cursors.assign(offsets.begin(), offsets.end() - 1);
+
+            for (auto a = alignment.begin(); a != alignment.end(); ++a) {
+                size_t row = byTarget ? a->second : a->first;
+                links[cursors[row]++] = byTarget ? a->first : a->second;
+            }
+        }
+
+        inline size_t size() const {
+            return length;
+        }
+
+        inline links_t operator[](size_t i) const {
+            links_t result;
+            result.begin = links.data() + offsets[i];
+            result.end = links.data() + offsets[i + 1];
+            return result;
+        }
+
+    private:
+        size_t length;
+        vector<size_t> offsets;
+        vector<size_t> cursors;
+        vector<uint16_t> links;
+    };
+
+}
+
+// Buffers reused among all the extractions performed by the same thread
+struct TranslationOptionBuilder::scratch_t {
+    AlignmentTable row2col;
+    AlignmentTable col2row;
+    vector<bool> targetAligned;
+    vector<bool> forbidden;
+    alignment_t inBoundsAlignment;
+    alignment_t shiftedAlignment;
+};
+
 /* TranslationOption Orientation methods */
 
 /**
@@ -27,7 +103,7 @@ using namespace mmt::sapt;
  * @param count
  * @return
  */
-static bool CheckBounds(const vector<uint16_t> &v, size_t LFT, size_t RGT, uint16_t &L, uint16_t &R, size_t &count) {
+static bool CheckBounds(const links_t &v, size_t LFT, size_t RGT, uint16_t &L, uint16_t &R, size_t &count) {
     if (v.size() == 0) return 0;
     if (L > v.front() && (L = v.front()) < LFT) return false;
     if (R < v.back() && (R = v.back()) > RGT) return false;
@@ -52,7 +128,7 @@ static bool CheckBounds(const vector<uint16_t> &v, size_t LFT, size_t RGT, uint1
  * @param rgt right output
  * @return the number of alignment points in box, or -1 if failure
  */
-static int ExpandBlock(const vector<vector<uint16_t>> &row2col, const vector<vector<uint16_t>> &col2row,
+static int ExpandBlock(const AlignmentTable &row2col, const AlignmentTable &col2row,
                        size_t row, size_t col,
                        const size_t TOP, const size_t LFT, const size_t BOT, const size_t RGT,
                        uint16_t *top = NULL, uint16_t *lft = NULL, uint16_t *bot = NULL, uint16_t *rgt = NULL) {
@@ -109,7 +185,7 @@ static int ExpandBlock(const vector<vector<uint16_t>> &row2col, const vector<vec
     return ret;
 }
 
-static Orientation GetForwardOrientation(vector<vector<uint16_t>> &a1, vector<vector<uint16_t>> &a2,
+static Orientation GetForwardOrientation(const AlignmentTable &a1, const AlignmentTable &a2,
                                          size_t s1, size_t e1, size_t s2, size_t e2) {
     if (e2 == a2.size()) // end of target sentence
         return MonotonicOrientation;
@@ -136,7 +212,7 @@ static Orientation GetForwardOrientation(vector<vector<uint16_t>> &a1, vector<ve
         return NoOrientation;
 }
 
-static Orientation GetBackwardOrientation(vector<vector<uint16_t>> &a1, vector<vector<uint16_t>> &a2,
+static Orientation GetBackwardOrientation(const AlignmentTable &a1, const AlignmentTable &a2,
                                           size_t s1, size_t e1, size_t s2, size_t e2) {
     if (s1 == 0 && s2 == 0)
         return MonotonicOrientation;
@@ -183,85 +259,101 @@ static inline int CompareAlignments(const mmt::alignment_t &a, const mmt::alignm
 
 /* TranslationOptionBuilder methods */
 
-void TranslationOptionBuilder::ExtractOptions(const vector<wid_t> &sourceSentence, const vector<wid_t> &targetSentence,
-                                              const alignment_t &allAlignment, const alignment_t &inBoundAlignment,
-                                              const vector<bool> &targetAligned,
-                                              int sourceStart, int sourceEnd, int targetStart, int targetEnd,
-                                              optionsmap_t &map, bool &isValidOption) {
-    int ts = targetStart;
-    while (true) {
-        int te = targetEnd;
-        while (true) {
-            vector<wid_t> targetPhrase(targetSentence.begin() + ts, targetSentence.begin() + te + 1);
+size_t TranslationOptionBuilder::span_hash::operator()(const span_t &span) const {
+    // same as phrase_hash
+    return boost::hash_range(span.words, span.words + span.length);
+}
 
-            // Reset the word positions within the phrase pair, regardless the sentence context
-            alignment_t shiftedAlignment = inBoundAlignment;
-            for (auto a = shiftedAlignment.begin(); a != shiftedAlignment.end(); ++a) {
-                a->first -= sourceStart;
-                a->second -= ts;
-            }
+bool TranslationOptionBuilder::span_equal::operator()(const span_t &a, const span_t &b) const {
+    return a.length == b.length && std::equal(a.words, a.words + a.length, b.words);
+}
 
-            size_t slen1 = sourceSentence.size();
-            size_t slen2 = targetSentence.size();
+void TranslationOptionBuilder::ExtractOptions(const sample_t &sample, scratch_t &scratch,
+                                              int sourceStart, int sourceEnd, int targetStart, int targetEnd,
+                                              spanmap_t &spans, vector<TranslationOptionBuilder> &builders,
+                                              bool &isValidOption) {
+    const vector<wid_t> &targetSentence = sample.target;
+    const vector<bool> &targetAligned = scratch.targetAligned;
 
-            length_t start = (length_t) sourceStart;
-            length_t stop = (length_t) (sourceEnd + 1);
+    // Orientations depend on the source span only, they are
+    // computed once for all the target spans
+    size_t slen2 = targetSentence.size();
 
-            std::vector<std::vector<uint16_t>> aln1(slen1); //long as the source sentence (or target if flipped)
-            std::vector<std::vector<uint16_t>> aln2(slen2); //long as the target sentence (or source if flipped)
-            vector<bool> forbidden(slen2);
+    length_t start = (length_t) sourceStart;
+    length_t stop = (length_t) (sourceEnd + 1);
 
-            length_t src, trg;
-            length_t lft = (length_t) forbidden.size();
-            length_t rgt = 0;
+    vector<bool> &forbidden = scratch.forbidden;
+    forbidden.assign(slen2, false);
 
-            for (auto align = allAlignment.begin(); align != allAlignment.end(); ++align) {
-                src = align->first;
-                trg = align->second;
+    length_t src, trg;
+    length_t lft = (length_t) forbidden.size();
+    length_t rgt = 0;
 
-                assert(src < slen1);
-                assert(trg < slen2);
+    for (auto align = sample.alignment.begin(); align != sample.alignment.end(); ++align) {
+        src = align->first;
+        trg = align->second;
 
-                if (src < start || src >= stop) {
-                    forbidden.at(trg) = true;
-                } else {
-                    lft = std::min(lft, trg);
-                    rgt = std::max(rgt, trg);
-                }
+        assert(src < sample.source.size());
+        assert(trg < slen2);
 
-                aln1[src].push_back(trg);
-                aln2[trg].push_back(src);
-            }
+        if (src < start || src >= stop) {
+            forbidden[trg] = true;
+        } else {
+            lft = std::min(lft, trg);
+            rgt = std::max(rgt, trg);
+        }
+    }
 
-            bool computeOrientation = true;
+    bool computeOrientation = true;
 
-            if (lft > rgt) {
+    if (lft > rgt) {
+        computeOrientation = false;
+    } else {
+        for (size_t i = lft; i <= rgt; ++i) {
+            if (forbidden[i])
                 computeOrientation = false;
-            } else {
-                for (size_t i = lft; i <= rgt; ++i) {
-                    if (forbidden[i])
-                        computeOrientation = false;
-                }
-            }
+        }
+    }
 
-            size_t s1, s2 = lft;
-            for (s1 = s2; s1 && !forbidden[s1 - 1]; --s1) {};
-            size_t e1 = rgt + 1, e2;
-            for (e2 = e1; e2 < forbidden.size() && !forbidden[e2]; ++e2) {};
+    size_t s1, s2 = lft;
+    for (s1 = s2; s1 && !forbidden[s1 - 1]; --s1) {};
+    size_t e1 = rgt + 1, e2;
+    for (e2 = e1; e2 < forbidden.size() && !forbidden[e2]; ++e2) {};
 
+    Orientation fwdOrientation = NoOrientation;
+    Orientation bwdOrientation = NoOrientation;
 
-            Orientation fwdOrientation = NoOrientation;
-            Orientation bwdOrientation = NoOrientation;
+    if (computeOrientation) {
+        fwdOrientation = GetForwardOrientation(scratch.row2col, scratch.col2row, start, stop, s1, e2);
+        bwdOrientation = GetBackwardOrientation(scratch.row2col, scratch.col2row, start, stop, s1, e2);
+    }
 
-            if (computeOrientation) {
-                fwdOrientation = GetForwardOrientation(aln1, aln2, start, stop, s1, e2);
-                bwdOrientation = GetBackwardOrientation(aln1, aln2, start, stop, s1, e2);
+    int ts = targetStart;
+    while (true) {
+        int te = targetEnd;
+        while (true) {
+            span_t span;
+            span.words = targetSentence.data() + ts;
+            span.length = (size_t) (te - ts + 1);
+
+            auto entry = spans.find(span);
+            if (entry == spans.end()) {
+                builders.push_back(TranslationOptionBuilder(vector<wid_t>(span.words, span.words + span.length)));
+                entry = spans.emplace(span, builders.size() - 1).first;
             }
 
-            auto builder = map.emplace(targetPhrase, targetPhrase);
-            builder.first->second.Add(shiftedAlignment);
-            builder.first->second.orientations.AddToForward(fwdOrientation);
-            builder.first->second.orientations.AddToBackward(bwdOrientation);
+            // Reset the word positions within the phrase pair, regardless the sentence context
+            alignment_t &shiftedAlignment = scratch.shiftedAlignment;
+            shiftedAlignment.assign(scratch.inBoundsAlignment.begin(), scratch.inBoundsAlignment.end());
+            for (auto a = shiftedAlignment.begin(); a != shiftedAlignment.end(); ++a) {
+                a->first -= sourceStart;
+                a->second -= ts;
+            }
+
+            TranslationOptionBuilder &builder = builders[entry->second];
+            builder.Add(shiftedAlignment);
+            builder.orientations.AddToForward(fwdOrientation);
+            builder.orientations.AddToBackward(bwdOrientation);
             isValidOption = true;
 
             te += 1;
@@ -304,27 +396,29 @@ void TranslationOptionBuilder::Add(const alignment_t &alignment) {
 
 void TranslationOptionBuilder::Extract(const vector<wid_t> &sourcePhrase, const vector<sample_t> &samples,
                                        vector<TranslationOptionBuilder> &output, size_t &validSamples) {
-    optionsmap_t map;
+    static thread_local scratch_t scratch;
+    spanmap_t spans;
 
     for (auto sample = samples.begin(); sample != samples.end(); ++sample) { //loop over sampled sentence pairs
         // Create bool vector to know whether a target word is aligned.
-        vector<bool> targetAligned(sample->target.size(), false);
+        scratch.targetAligned.assign(sample->target.size(), false);
         for (auto alignPoint = sample->alignment.begin(); alignPoint != sample->alignment.end(); ++alignPoint)
-            targetAligned[alignPoint->second] = true;
+            scratch.targetAligned[alignPoint->second] = true;
+
+        // Alignment tables do not depend on the offset, they are built once per sample
+        scratch.row2col.Build(sample->source.size(), sample->alignment, false);
+        scratch.col2row.Build(sample->target.size(), sample->alignment, true);
 
         // Loop over offset of a sampled sentence pair
         for (auto offset = sample->offsets.begin(); offset != sample->offsets.end(); ++offset) {
-            TranslationOptionBuilder::Extract(sourcePhrase, *sample, *offset, targetAligned, map, validSamples);
+            TranslationOptionBuilder::Extract(sourcePhrase, *sample, *offset, scratch, spans, output, validSamples);
         }
     }
-
-    output.reserve(map.size());
-    for (auto entry = map.begin(); entry != map.end(); ++entry)
-        output.push_back(entry->second);
 }
 
 void TranslationOptionBuilder::Extract(const vector<wid_t> &sourcePhrase, const sample_t &sample, int offset,
-                                       vector<bool> &targetAligned, optionsmap_t &map, size_t &validSamples) {
+                                       scratch_t &scratch, spanmap_t &spans, vector<TranslationOptionBuilder> &builders,
+                                       size_t &validSamples) {
     // Search for source and target bounds
     int sourceStart = offset;
     int sourceEnd = (int) (sourceStart + sourcePhrase.size() - 1);
@@ -352,7 +446,9 @@ void TranslationOptionBuilder::Extract(const vector<wid_t> &sourcePhrase, const
     // or tha target position within the target inBounds
     // In this case do not proceed with the option extraction
 
-    alignment_t inBoundsAlignment;
+    alignment_t &inBoundsAlignment = scratch.inBoundsAlignment;
+    inBoundsAlignment.clear();
+
     bool isValidAlignment = true;
     for (auto alignPoint = sample.alignment.begin(); alignPoint != sample.alignment.end(); ++alignPoint) {
         bool srcInbound = InRange(sourceStart, alignPoint->first, sourceEnd);
@@ -371,9 +467,8 @@ void TranslationOptionBuilder::Extract(const vector<wid_t> &sourcePhrase, const
     if (isValidAlignment) {
         bool isValidOption = false;
         // Extract the TranslationOptions
-        TranslationOptionBuilder::ExtractOptions(sample.source, sample.target, sample.alignment, inBoundsAlignment,
-                                                 targetAligned,
-                                                 sourceStart, sourceEnd, targetStart, targetEnd, map,
+        TranslationOptionBuilder::ExtractOptions(sample, scratch,
+                                                 sourceStart, sourceEnd, targetStart, targetEnd, spans, builders,
                                                  isValidOption);
         if (isValidOption)
             ++validSamples;
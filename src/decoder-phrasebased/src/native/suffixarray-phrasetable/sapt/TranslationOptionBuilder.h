@@ -7,6 +7,7 @@
 
 #include <mmt/sentence.h>
 #include <suffixarray/sample.h>
+#include <util/hashutils.h>
 #include "TranslationOption.h"
 
 using namespace std;
@@ -14,10 +15,6 @@ using namespace std;
 namespace mmt {
     namespace sapt {
 
-        class TranslationOptionBuilder;
-
-        typedef unordered_map<vector<wid_t>, TranslationOptionBuilder, phrase_hash> optionsmap_t;
-
         class TranslationOptionBuilder {
 
         public:
@@ -49,14 +46,33 @@ namespace mmt {
             TranslationOption::Orientations orientations;
 
 
+            struct scratch_t;
+
+            // Target phrases are identified by their position within the samples,
+            // the value is the index of the option builder in the output vector
+            struct span_t {
+                const wid_t *words;
+                size_t length;
+            };
+
+            struct span_hash {
+                size_t operator()(const span_t &span) const;
+            };
+
+            struct span_equal {
+                bool operator()(const span_t &a, const span_t &b) const;
+            };
+
+            typedef unordered_map<span_t, size_t, span_hash, span_equal> spanmap_t;
+
             static void Extract(const vector<wid_t> &sourcePhrase, const sample_t &sample, int offset,
-                                vector<bool> &targetAligned, optionsmap_t &map, size_t &validSamples);
+                                scratch_t &scratch, spanmap_t &spans, vector<TranslationOptionBuilder> &builders,
+                                size_t &validSamples);
 
-            static void ExtractOptions(const vector<wid_t> &sourceSentence, const vector<wid_t> &targetSentence,
-                                       const alignment_t &allAlignment, const alignment_t &inBoundAlignment,
-                                       const vector<bool> &targetAligned,
+            static void ExtractOptions(const sample_t &sample, scratch_t &scratch,
                                        int sourceStart, int sourceEnd, int targetStart, int targetEnd,
-                                       optionsmap_t &map, bool &isValid);
+                                       spanmap_t &spans, vector<TranslationOptionBuilder> &builders,
+                                       bool &isValid);
         };
 
     }
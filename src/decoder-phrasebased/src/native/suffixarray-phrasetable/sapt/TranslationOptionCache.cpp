@@ -0,0 +1,90 @@
+//
+// Created by Davide  Caroselli on 12/06/17.
+//
+
+#include <cmath>
+#include "TranslationOptionCache.h"
+
+using namespace mmt;
+using namespace mmt::sapt;
+
+static const float kContextScoreQuantization = 100.f;
+
+const size_t TranslationOptionCache::kShardCount;
+
+TranslationOptionCache::TranslationOptionCache(size_t capacity)
+        : shardCapacity(max((capacity + kShardCount - 1) / kShardCount, (size_t) 1)) {
+}
+
+size_t TranslationOptionCache::key_hash::operator()(const key_t &key) const {
+    size_t hash = 1;
+    for (auto word = key.phrase.begin(); word != key.phrase.end(); ++word)
+        hash = 31 * hash + *word;
+
+    for (auto score = key.context.begin(); score != key.context.end(); ++score) {
+        hash = 31 * hash + score->first;
+        hash = 31 * hash + (size_t) score->second;
+    }
+
+    hash = 31 * hash + (size_t) key.version;
+
+    return hash;
+}
+
+TranslationOptionCache::context_key_t TranslationOptionCache::QuantizeContext(const context_t *context) {
+    context_key_t key;
+    if (context == NULL)
+        return key;
+
+    key.reserve(context->size());
+    for (auto score = context->begin(); score != context->end(); ++score)
+        key.push_back(make_pair(score->domain, lround(score->score * kContextScoreQuantization)));
+
+    return key;
+}
+
+bool TranslationOptionCache::Get(const vector<wid_t> &phrase, const context_key_t &context, uint64_t version,
+                                 vector<TranslationOption> &outOptions) {
+    key_t key;
+    key.phrase = phrase;
+    key.context = context;
+    key.version = version;
+
+    shard_t &shard = shards[key_hash()(key) % kShardCount];
+    lock_guard<mutex> lock(shard.access);
+
+    auto entry = shard.index.find(key);
+    if (entry == shard.index.end())
+        return false;
+
+    // move entry to the front of the LRU list
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+    outOptions = entry->second->second;
+
+    return true;
+}
+
+void TranslationOptionCache::Put(const vector<wid_t> &phrase, const context_key_t &context, uint64_t version,
+                                 const vector<TranslationOption> &options) {
+    key_t key;
+    key.phrase = phrase;
+    key.context = context;
+    key.version = version;
+
+    shard_t &shard = shards[key_hash()(key) % kShardCount];
+    lock_guard<mutex> lock(shard.access);
+
+    auto entry = shard.index.find(key);
+    if (entry != shard.index.end()) {
+        shard.entries.splice(shard.entries.begin(), shard.entries, entry->second);
+        return;
+    }
+
+    shard.entries.emplace_front(key, options);
+    shard.index.emplace(key, shard.entries.begin());
+
+    while (shard.entries.size() > shardCapacity) {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+}
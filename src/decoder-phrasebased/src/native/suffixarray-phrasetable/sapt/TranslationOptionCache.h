@@ -0,0 +1,74 @@
+//
+// Created by Davide  Caroselli on 12/06/17.
+//
+
+#ifndef SAPT_TRANSLATIONOPTIONCACHE_H
+#define SAPT_TRANSLATIONOPTIONCACHE_H
+
+#include <list>
+#include <sstream>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <mmt/sentence.h>
+#include "TranslationOption.h"
+
+using namespace std;
+
+namespace mmt {
+    namespace sapt {
+
+        // Thread-safe LRU cache of translation options shared among all requests.
+        // Entries are identified by the source phrase, the quantized context
+        // vector and the version of the index they were computed from:
+        // entries of older index versions are never returned and they are
+        // evicted as soon as they become the least recently used.
+        class TranslationOptionCache {
+        public:
+            typedef vector<pair<domain_t, long>> context_key_t;
+
+            TranslationOptionCache(size_t capacity);
+
+            bool Get(const vector<wid_t> &phrase, const context_key_t &context, uint64_t version,
+                     vector<TranslationOption> &outOptions);
+
+            void Put(const vector<wid_t> &phrase, const context_key_t &context, uint64_t version,
+                     const vector<TranslationOption> &options);
+
+            // Context scores are quantized, so that almost identical context
+            // vectors share the same entries
+            static context_key_t QuantizeContext(const context_t *context);
+
+        private:
+            static const size_t kShardCount = 16;
+
+            struct key_t {
+                vector<wid_t> phrase;
+                context_key_t context;
+                uint64_t version;
+
+                bool operator==(const key_t &o) const {
+                    return version == o.version && phrase == o.phrase && context == o.context;
+                }
+            };
+
+            struct key_hash {
+                size_t operator()(const key_t &key) const;
+            };
+
+            typedef list<pair<key_t, vector<TranslationOption>>> entries_t;
+
+            struct shard_t {
+                mutex access;
+                entries_t entries;
+                unordered_map<key_t, entries_t::iterator, key_hash> index;
+            };
+
+            const size_t shardCapacity;
+            shard_t shards[kShardCount];
+        };
+
+    }
+}
+
+#endif //SAPT_TRANSLATIONOPTIONCACHE_H
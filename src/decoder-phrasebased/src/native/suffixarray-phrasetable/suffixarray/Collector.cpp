@@ -10,8 +10,9 @@
 using namespace mmt;
 using namespace mmt::sapt;
 
-Collector::Collector(CorporaStorage *storage, rocksdb::DB *db, length_t prefixLength, const context_t *context,
-                     bool searchInBackground) : prefixLength(prefixLength), storage(storage) {
+Collector::Collector(CorporaStorage *storage, rocksdb::DB *db, length_t prefixLength,
+                     const DomainTombstones *tombstones, const context_t *context, bool searchInBackground)
+        : prefixLength(prefixLength), storage(storage) {
     phrase.reserve(20); // typical max phrase length
 
     if (context && !context->empty()) {
@@ -19,14 +20,14 @@ Collector::Collector(CorporaStorage *storage, rocksdb::DB *db, length_t prefixLe
 
         for (size_t i = 0; i < context->size(); ++i) {
             inDomainStates[i].cursor.reset(
-                    PrefixCursor::NewDomainCursor(db, prefixLength, context->at(i).domain)
+                    PrefixCursor::NewDomainCursor(db, prefixLength, context->at(i).domain, tombstones)
             );
         }
     }
 
     if (searchInBackground) {
         backgroundState = new state_t();
-        backgroundState->cursor.reset(PrefixCursor::NewGlobalCursor(db, prefixLength, context));
+        backgroundState->cursor.reset(PrefixCursor::NewGlobalCursor(db, prefixLength, context, tombstones));
     }
 }
 
@@ -79,20 +80,33 @@ void Collector::Extend(const vector<wid_t> &words, size_t limit, vector<sample_t
     // Get out-context samples
 
     if (backgroundState && (limit == 0 || availability > 0)) {
-        size_t collected = CollectLocations(backgroundState->cursor.get(), phrase, prefixLength,
-                                            backgroundState->phraseOffset, backgroundState->postingList);
-        backgroundState->phraseOffset = phrase.size();
+        if (limit > 0 && phrase.size() < prefixLength) {
+            // Posting lists shorter than prefixLength are not cached: the samples are drawn
+            // directly from the index, decoding only the blocks that contain them
+            size_t available = backgroundState->cursor->SampleLocations(phrase, 0, phrase.size(),
+                                                                        availability, shuffleSeed, locations);
+            backgroundState->phraseOffset = phrase.size();
+
+            if (available == 0) {
+                delete backgroundState;
+                backgroundState = NULL;
+            }
+        } else {
+            size_t collected = CollectLocations(backgroundState->cursor.get(), phrase, prefixLength,
+                                                backgroundState->phraseOffset, backgroundState->postingList);
+            backgroundState->phraseOffset = phrase.size();
 
-        if (collected > 0) {
-            backgroundState->postingList->GetLocations(locations, limit == 0 ? 0 : availability, shuffleSeed);
+            if (collected > 0) {
+                backgroundState->postingList->GetLocations(locations, limit == 0 ? 0 : availability, shuffleSeed);
 
-            if (phrase.size() < prefixLength) {
-                // No need to cache Posting Lists shorter than prefixLength
-                backgroundState->postingList.reset();
+                if (phrase.size() < prefixLength) {
+                    // No need to cache Posting Lists shorter than prefixLength
+                    backgroundState->postingList.reset();
+                }
+            } else {
+                delete backgroundState;
+                backgroundState = NULL;
             }
-        } else {
-            delete backgroundState;
-            backgroundState = NULL;
         }
     }
 
@@ -155,27 +169,68 @@ void Collector::CollectPhraseLocations(PrefixCursor *cursor, const vector<wid_t>
 }
 
 void Collector::Retrieve(const vector<location_t> &locations, vector<sample_t> &outSamples) {
-    outSamples.reserve(outSamples.size() + locations.size());
+    size_t base = outSamples.size();
+    outSamples.reserve(base + locations.size());
 
-    sample_t *lastSample = NULL;
-    int64_t lastPointer = -1;
+    // Consecutive locations of the same sentence pair are merged into a single sample
+    vector<int64_t> pointers;
+    pointers.reserve(locations.size());
 
     for (auto location = locations.begin(); location != locations.end(); ++location) {
-        if (lastSample && lastSample->domain == location->domain && lastPointer == location->pointer) {
-            lastSample->offsets.push_back(location->offset);
+        if (pointers.size() > 0 && outSamples.back().domain == location->domain &&
+            pointers.back() == location->pointer) {
+            outSamples.back().offsets.push_back(location->offset);
         } else {
-            sample_t sample;
+            outSamples.push_back(sample_t());
+
+            sample_t &sample = outSamples.back();
             sample.domain = location->domain;
             sample.offsets.push_back(location->offset);
 
-            if (storage->Retrieve(location->domain, location->pointer,
-                                  &sample.source, &sample.target, &sample.alignment)) {
-                outSamples.push_back(sample);
+            pointers.push_back(location->pointer);
+        }
+    }
+
+    // Sentence pairs are retrieved with a single batch per domain, sorted by pointer
+    unordered_map<domain_t, vector<size_t>> domains;
+    for (size_t i = 0; i < pointers.size(); ++i)
+        domains[outSamples[base + i].domain].push_back(i);
 
-                lastPointer = location->pointer;
-                lastSample = &(outSamples[outSamples.size() - 1]);
-            }
+    vector<bool> retrieved(pointers.size(), false);
+
+    vector<int64_t> offsets;
+    vector<sample_t *> samples;
+    vector<bool> batchRetrieved;
+
+    for (auto entry = domains.begin(); entry != domains.end(); ++entry) {
+        vector<size_t> &indexes = entry->second;
+        sort(indexes.begin(), indexes.end(), [&pointers](size_t a, size_t b) {
+            return pointers[a] < pointers[b];
+        });
+
+        offsets.clear();
+        samples.clear();
+
+        for (auto i = indexes.begin(); i != indexes.end(); ++i) {
+            offsets.push_back(pointers[*i]);
+            samples.push_back(&outSamples[base + *i]);
+        }
+
+        storage->RetrieveMany(entry->first, offsets, samples, batchRetrieved);
+
+        for (size_t i = 0; i < indexes.size(); ++i)
+            retrieved[indexes[i]] = batchRetrieved[i];
+    }
+
+    // Remove samples that could not be retrieved, preserving the order
+    size_t size = base;
+    for (size_t i = 0; i < retrieved.size(); ++i) {
+        if (retrieved[i]) {
+            if (size != base + i)
+                outSamples[size] = std::move(outSamples[base + i]);
+            size++;
         }
     }
-}
 
+    outSamples.resize(size);
+}
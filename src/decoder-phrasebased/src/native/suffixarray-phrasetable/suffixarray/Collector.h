@@ -36,8 +36,8 @@ namespace mmt {
             }
 
         private:
-            Collector(CorporaStorage *storage, rocksdb::DB *db, length_t prefixLength, const context_t *context,
-                      bool searchInBackground);
+            Collector(CorporaStorage *storage, rocksdb::DB *db, length_t prefixLength,
+                      const DomainTombstones *tombstones, const context_t *context, bool searchInBackground);
 
             void Retrieve(const vector<location_t> &locations, vector<sample_t> &outSamples);
 
@@ -13,10 +13,13 @@ using namespace mmt::sapt;
 
 static const string kPendingDeletionKey = MakeEmptyKey(kPendingDeletionKeyType);
 
-GarbageCollector::GarbageCollector(CorporaStorage *storage, rocksdb::DB *db,
+// Value of the deletion key of a domain already collected
+static const string kCollectedDomainValue = "C";
+
+GarbageCollector::GarbageCollector(CorporaStorage *storage, rocksdb::DB *db, DomainTombstones *tombstones,
                                    uint8_t prefixLength, size_t batchSize, double timeout)
         : BackgroundPollingThread(timeout), logger("sapt.GarbageCollector"), db(db), storage(storage),
-          batchSize(batchSize), prefixLength(prefixLength) {
+          tombstones(tombstones), batchSize(batchSize), prefixLength(prefixLength), version(0) {
     // Pending deletion
     string raw_deletion;
 
@@ -30,17 +33,26 @@ GarbageCollector::GarbageCollector(CorporaStorage *storage, rocksdb::DB *db,
     // Deleted domains
     string deletionKeyPrefix = MakeEmptyKey(kDeletedDomainKeyType);
 
+    vector<domain_t> deleted;
+
     Iterator *it = db->NewIterator(ReadOptions());
     it->Seek(deletionKeyPrefix);
 
     Slice key;
     while (it->Valid() && (key = it->key()).starts_with(deletionKeyPrefix)) {
-        queue.insert(GetDomainFromDeletionKey(key.data()));
+        domain_t domain = GetDomainFromDeletionKey(key.data());
+        deleted.push_back(domain);
+
+        if (it->value().compare(kCollectedDomainValue) != 0)
+            queue.insert(domain);
+
         it->Next();
     }
 
     delete it;
 
+    tombstones->Add(deleted);
+
     // Starting background thread
     Start();
 }
@@ -50,6 +62,13 @@ GarbageCollector::~GarbageCollector() {
 }
 
 void GarbageCollector::MarkForDeletion(const std::vector<domain_t> &domains) {
+    if (domains.empty())
+        return;
+
+    // Readers ignore the domains from now on
+    tombstones->Add(domains);
+    version++;
+
     queueAccess.lock();
     queue.insert(domains.begin(), domains.end());
     queueAccess.unlock();
@@ -91,19 +110,29 @@ void GarbageCollector::Delete(domain_t domain, int64_t offset) throw(interrupted
     double beginTime = GetTime();
     LogInfo(logger) << (offset == 0 ? "Deleting domain " : "Resuming deletion of domain ") << domain;
 
+    string legacy;
+    if (!db->Get(ReadOptions(), MakeLegacyDomainKey(domain), &legacy).ok()) {
+        // The domain has per-domain counts: the storage is not read at all
+        DeleteCounts(domain, true);
+        DeleteCounts(domain, false);
+        DeleteStorage(domain);
+
+        LogInfo(logger) << "Deletion of domain " << domain << " completed in " << GetElapsedTime(beginTime) << "s";
+        return;
+    }
+
     StorageIterator *iterator = storage->NewIterator(domain, (size_t) offset);
     if (iterator != nullptr) {
-        unordered_set<string> prefixKeys;
-        unordered_map<string, int64_t> targetCounts;
+        unordered_map<string, int64_t> counts;
 
         int64_t currentOffset;
         do {
-            currentOffset = LoadBatch(domain, iterator, &prefixKeys, &targetCounts);
+            currentOffset = LoadBatch(domain, iterator, &counts);
 
             if (!IsRunning())
                 throw interrupted_exception();
 
-            WriteBatch(domain, currentOffset, prefixKeys, targetCounts);
+            WriteBatch(domain, currentOffset, counts);
         } while (currentOffset != StorageIterator::eof);
 
         delete iterator;
@@ -119,22 +148,85 @@ void GarbageCollector::DeleteStorage(domain_t domain) throw(index_exception) {
 
     rocksdb::WriteBatch writeBatch;
     writeBatch.Delete(kPendingDeletionKey);
-    writeBatch.Delete(MakeDomainDeletionKey(domain));
+    writeBatch.Put(MakeDomainDeletionKey(domain), kCollectedDomainValue);
+    writeBatch.Delete(MakeLegacyDomainKey(domain));
+
+    // Legacy domains may have per-domain counts of later updates, already subtracted
+    writeBatch.DeleteRange(MakeDomainCountRangeBegin(kDomainSourceCountKeyType, domain),
+                           MakeDomainCountRangeEnd(kDomainSourceCountKeyType, domain));
+    writeBatch.DeleteRange(MakeDomainCountRangeBegin(kDomainTargetCountKeyType, domain),
+                           MakeDomainCountRangeEnd(kDomainTargetCountKeyType, domain));
 
     Status status = db->Write(WriteOptions(), &writeBatch);
     if (!status.ok())
         throw index_exception("Unable to write to index: " + status.ToString());
 
+    version++;
+
     queueAccess.lock();
     queue.erase(domain);
     queueAccess.unlock();
 }
 
+void GarbageCollector::DeleteCounts(domain_t domain, bool isSource) throw(interrupted_exception, index_exception) {
+    KeyType type = isSource ? kDomainSourceCountKeyType : kDomainTargetCountKeyType;
+    KeyType globalType = isSource ? kSourceCountKeyType : kTargetCountKeyType;
+
+    string begin = MakeDomainCountRangeBegin(type, domain);
+    string end = MakeDomainCountRangeEnd(type, domain);
+
+    rocksdb::WriteBatch writeBatch;
+    size_t count = 0;
+    Status status;
+
+    Iterator *it = db->NewIterator(ReadOptions());
+
+    for (it->Seek(begin); it->Valid() && it->key().compare(end) < 0; it->Next()) {
+        Slice key = it->key();
+        Slice value = it->value();
+
+        int64_t domainCount = DeserializeCount(value.data(), value.size());
+        writeBatch.Merge(MakeCountKeyFromDomainCountKey(globalType, prefixLength, key.data()),
+                         SerializeCount(-domainCount));
+
+        if (++count % batchSize == 0) {
+            // Per-domain counts are removed together with their decrements,
+            // an interrupted deletion restarts from the first count left
+            writeBatch.DeleteRange(begin, key.ToString() + '\0');
+
+            status = db->Write(WriteOptions(), &writeBatch);
+            if (!status.ok())
+                break;
+
+            writeBatch.Clear();
+            version++;
+
+            if (!IsRunning()) {
+                delete it;
+                throw interrupted_exception();
+            }
+        }
+    }
+
+    if (status.ok())
+        status = it->status();
+
+    delete it;
+
+    if (status.ok()) {
+        writeBatch.DeleteRange(begin, end);
+        status = db->Write(WriteOptions(), &writeBatch);
+    }
+
+    if (!status.ok())
+        throw index_exception("Unable to write to index: " + status.ToString());
+
+    version++;
+}
+
 int64_t GarbageCollector::LoadBatch(domain_t domain, StorageIterator *iterator,
-                                    unordered_set<string> *outPrefixKeys,
-                                    unordered_map<string, int64_t> *outTargetCounts) throw(interrupted_exception) {
-    outPrefixKeys->clear();
-    outTargetCounts->clear();
+                                    unordered_map<string, int64_t> *outCounts) throw(interrupted_exception) {
+    outCounts->clear();
 
     vector<wid_t> source;
     vector<wid_t> target;
@@ -150,7 +242,7 @@ int64_t GarbageCollector::LoadBatch(domain_t domain, StorageIterator *iterator,
         if (!iterator->Next(&source, &target, &alignment, &offset))
             break;
 
-        // Load source prefixes
+        // Load source counts
 
         size_t sourceSize = source.size();
 
@@ -159,7 +251,8 @@ int64_t GarbageCollector::LoadBatch(domain_t domain, StorageIterator *iterator,
                 if (start + length > sourceSize)
                     break;
 
-                outPrefixKeys->insert(MakePrefixKey(prefixLength, domain, source, start, length));
+                string dkey = MakeCountKey(kSourceCountKeyType, prefixLength, source, start, length);
+                (*outCounts)[dkey]++;
             }
         }
 
@@ -172,8 +265,8 @@ int64_t GarbageCollector::LoadBatch(domain_t domain, StorageIterator *iterator,
                 if (start + length > targetSize)
                     break;
 
-                string dkey = MakeCountKey(prefixLength, target, start, length);
-                (*outTargetCounts)[dkey]++;
+                string dkey = MakeCountKey(kTargetCountKeyType, prefixLength, target, start, length);
+                (*outCounts)[dkey]++;
             }
         }
     }
@@ -181,17 +274,11 @@ int64_t GarbageCollector::LoadBatch(domain_t domain, StorageIterator *iterator,
     return offset;
 }
 
-void GarbageCollector::WriteBatch(domain_t domain, int64_t offset, const unordered_set<string> &prefixKeys,
-                                  const unordered_map<string, int64_t> &targetCounts) {
+void GarbageCollector::WriteBatch(domain_t domain, int64_t offset, const unordered_map<string, int64_t> &counts) {
     rocksdb::WriteBatch writeBatch;
 
-    // Add source prefixes to write batch
-    for (auto prefix = prefixKeys.begin(); prefix != prefixKeys.end(); ++prefix) {
-        writeBatch.Delete(*prefix);
-    }
-
-    // Add target counts to write batch
-    for (auto count = targetCounts.begin(); count != targetCounts.end(); ++count) {
+    // Add source and target counts to write batch
+    for (auto count = counts.begin(); count != counts.end(); ++count) {
         string value = SerializeCount(-(count->second));
         writeBatch.Merge(count->first, value);
     }
@@ -203,4 +290,6 @@ void GarbageCollector::WriteBatch(domain_t domain, int64_t offset, const unorder
     Status status = db->Write(WriteOptions(), &writeBatch);
     if (!status.ok())
         throw index_exception("Unable to write to index: " + status.ToString());
+
+    version++;
 }
@@ -8,31 +8,43 @@
 #include <vector>
 #include <mmt/sentence.h>
 #include <mutex>
+#include <atomic>
 #include <rocksdb/db.h>
 #include <boost/thread.hpp>
 #include <util/BackgroundPollingThread.h>
 #include <unordered_set>
 #include <mmt/logging/Logger.h>
+#include <mmt/DomainTombstones.h>
 #include <suffixarray/storage/CorporaStorage.h>
 #include "index_exception.h"
 
 namespace mmt {
     namespace sapt {
 
+        // Deleted domains are tombstoned: readers ignore them immediately and their source
+        // prefixes are dropped by the compaction filter of the index. In background the
+        // collector subtracts the counts of the domain from the global counts and deletes
+        // its storage; the deletion key is kept as the persistent tombstone of the domain.
         class GarbageCollector : public BackgroundPollingThread {
         public:
-            GarbageCollector(CorporaStorage *storage, rocksdb::DB *db,
+            GarbageCollector(CorporaStorage *storage, rocksdb::DB *db, DomainTombstones *tombstones,
                              uint8_t prefixLength, size_t batchSize, double timeout);
 
             virtual ~GarbageCollector();
 
             void MarkForDeletion(const std::vector<domain_t> &domains);
 
+            // Number of modifications applied to the index by the collector
+            uint64_t GetVersion() const {
+                return version;
+            }
+
         private:
             mmt::logging::Logger logger;
 
             rocksdb::DB *db;
             CorporaStorage *storage;
+            DomainTombstones *tombstones;
 
             domain_t pendingDeletionDomain;
             int64_t pendingDeletionOffset;
@@ -42,6 +54,8 @@ namespace mmt {
             std::mutex queueAccess;
             std::unordered_set<domain_t> queue;
 
+            std::atomic<uint64_t> version;
+
             class interrupted_exception : public std::exception {
             public:
                 interrupted_exception() {};
@@ -53,12 +67,13 @@ namespace mmt {
 
             void DeleteStorage(domain_t domain) throw(index_exception);
 
+            // Subtracts the per-domain counts from the global counts
+            void DeleteCounts(domain_t domain, bool isSource) throw(interrupted_exception, index_exception);
+
             int64_t LoadBatch(domain_t domain, StorageIterator *iterator,
-                              std::unordered_set<std::string> *outPrefixKeys,
-                              std::unordered_map<std::string, int64_t> *outTargetCounts) throw(interrupted_exception);
+                              std::unordered_map<std::string, int64_t> *outCounts) throw(interrupted_exception);
 
-            void WriteBatch(domain_t domain, int64_t offset, const std::unordered_set<std::string> &prefixKeys,
-                            const std::unordered_map<std::string, int64_t> &targetCounts);
+            void WriteBatch(domain_t domain, int64_t offset, const std::unordered_map<std::string, int64_t> &counts);
 
         };
 
@@ -14,35 +14,93 @@
 using namespace mmt;
 using namespace mmt::sapt;
 
+static const size_t kMaxEntrySize = 10 + 3; // VBE(int64) + VBE(length_t)
+
+const size_t PostingList::kBlockHeaderSize;
+const size_t PostingList::kMaxBlockEntries;
+
 PostingList::PostingList() : entryCount(0) {
 
 }
 
-void PostingList::Append(domain_t domain, const string &value) {
-    assert(value.size() % kEntrySize == 0);
+void PostingList::Append(domain_t domain, const char *data, size_t length) {
+    size_t count = Count(data, length);
+
+    if (count > 0) {
+        vector<char> &buffer = GetBuffer(datamap[domain]);
+        buffer.insert(buffer.end(), data, data + length);
+
+        // appended blocks are closed, next single entry will open a new block
+        openBlocks.erase(domain);
+        entryCount += count;
+    }
+}
 
-    size_t count = value.size() / kEntrySize;
+void PostingList::Append(domain_t domain, const char *data, size_t length, const shared_ptr<void> &pin) {
+    size_t count = Count(data, length);
 
     if (count > 0) {
-        size_t size = value.size();
-        const char *cstr = value.c_str();
+        chunk_t &chunk = datamap[domain];
 
-        vector<char> chunk(size);
-        memcpy(chunk.data(), cstr, size);
+        if (chunk.size() > 0) {
+            vector<char> &buffer = GetBuffer(chunk);
+            buffer.insert(buffer.end(), data, data + length);
+        } else {
+            chunk.buffer.clear();
+            chunk.pin = pin;
+            chunk.pinnedData = data;
+            chunk.pinnedLength = length;
+        }
 
-        datamap[domain] = chunk;
+        openBlocks.erase(domain);
         entryCount += count;
     }
 }
 
+vector<char> &PostingList::GetBuffer(chunk_t &chunk) {
+    if (chunk.pin) {
+        chunk.buffer.assign(chunk.pinnedData, chunk.pinnedData + chunk.pinnedLength);
+        chunk.pin.reset();
+        chunk.pinnedData = NULL;
+        chunk.pinnedLength = 0;
+    }
+
+    return chunk.buffer;
+}
+
 void PostingList::Append(domain_t domain, int64_t location, length_t offset) {
-    vector<char> &data = datamap[domain];
+    vector<char> &data = GetBuffer(datamap[domain]);
     size_t ptr = data.size();
 
-    data.resize(ptr + kEntrySize);
-    WriteInt64(data.data(), &ptr, location);
-    WriteUInt16(data.data(), &ptr, offset);
+    auto block = openBlocks.find(domain);
+    bool newBlock = block == openBlocks.end() || location < block->second.lastPointer ||
+                    ReadUInt16(data.data(), block->second.header) >= kMaxBlockEntries;
+
+    data.resize(ptr + (newBlock ? kBlockHeaderSize : 0) + kMaxEntrySize);
+
+    if (newBlock) {
+        block = openBlocks.emplace(domain, block_t()).first;
+        block->second.header = ptr;
+        block->second.lastPointer = location;
+
+        WriteUInt16(data.data(), &ptr, 0);
+        WriteUInt16(data.data(), &ptr, 0);
+        WriteInt64(data.data(), &ptr, location);
+    }
+
+    size_t begin = ptr;
+    VBEWriteUInt64(data.data(), &ptr, (uint64_t) (location - block->second.lastPointer));
+    VBEWriteUInt64(data.data(), &ptr, offset);
+    data.resize(ptr);
 
+    size_t header = block->second.header;
+    uint16_t count = ReadUInt16(data.data(), header);
+    uint16_t payload = ReadUInt16(data.data(), header + 2);
+
+    WriteUInt16(data.data(), header, (uint16_t) (count + 1));
+    WriteUInt16(data.data(), header + 2, (uint16_t) (payload + ptr - begin));
+
+    block->second.lastPointer = location;
     entryCount++;
 }
 
@@ -54,67 +112,142 @@ size_t PostingList::size() const {
     return entryCount;
 }
 
-void PostingList::GetLocationMap(domain_t domain, unordered_map<int64_t, unordered_set<length_t>> &output) const {
-    auto entry = datamap.find(domain);
+size_t PostingList::Count(const char *data, size_t length) {
+    size_t count = 0;
 
-    if (entry == datamap.end())
-        return;
+    size_t ptr = 0;
+    while (ptr + kBlockHeaderSize <= length) {
+        count += ReadUInt16(data, ptr);
+        ptr += kBlockHeaderSize + ReadUInt16(data, ptr + 2);
+    }
+
+    return count;
+}
+
+inline size_t PostingList::DecodeBlock(const char *data, size_t *ptr, int64_t *outLocations, length_t *outOffsets) {
+    size_t count = ReadUInt16(data, ptr);
+    assert(count <= kMaxBlockEntries);
+
+    *ptr += 2; // skip payload length
+    int64_t location = ReadInt64(data, ptr);
+
+    for (size_t i = 0; i < count; ++i) {
+        location += VBEReadUInt64(data, ptr);
+
+        outLocations[i] = location;
+        outOffsets[i] = (length_t) VBEReadUInt64(data, ptr);
+    }
+
+    return count;
+}
+
+void PostingList::GetSortedEntries(const chunk_t &chunk, vector<uint64_t> &output) {
+    int64_t locations[kMaxBlockEntries];
+    length_t offsets[kMaxBlockEntries];
+
+    const char *bytes = chunk.data();
+    size_t length = chunk.size();
+
+    output.clear();
+    output.reserve(Count(bytes, length));
+
+    bool sorted = true;
 
-    output.reserve(entry->second.size() / kEntrySize);
+    size_t ptr = 0;
+    while (ptr < length) {
+        size_t count = DecodeBlock(bytes, &ptr, locations, offsets);
 
-    const char *bytes = entry->second.data();
-    for (size_t i = 0; i < entry->second.size(); i += kEntrySize) {
-        int64_t location = ReadInt64(bytes, i);
-        length_t offset = ReadUInt16(bytes, i + 8);
+        for (size_t i = 0; i < count; ++i) {
+            assert(locations[i] >= 0 && locations[i] < (1LL << 48));
 
-        output[location].insert(offset);
+            uint64_t entry = (((uint64_t) locations[i]) << 16) | offsets[i];
+            if (!output.empty() && output.back() > entry)
+                sorted = false;
+
+            output.push_back(entry);
+        }
+    }
+
+    // Blocks are usually appended in increasing pointer order
+    if (!sorted)
+        sort(output.begin(), output.end());
+}
+
+// Returns the first index i in [begin, end) such that v[i] >= value,
+// by doubling the search step before the binary search
+static inline size_t Gallop(const vector<uint64_t> &v, size_t begin, size_t end, uint64_t value) {
+    size_t step = 1;
+    size_t low = begin;
+    size_t high = begin;
+
+    while (high < end && v[high] < value) {
+        low = high + 1;
+        high = begin + step;
+        step *= 2;
+    }
+
+    return (size_t) (lower_bound(v.begin() + low, v.begin() + min(high, end), value) - v.begin());
+}
+
+void PostingList::Intersect(const vector<uint64_t> &entries, const vector<uint64_t> &successors, size_t start,
+                            vector<uint64_t> &output) {
+    // An entry (pointer, offset) is retained if successors contains (pointer, offset + start):
+    // with the packed representation this is entry + start, as long as the offset does not overflow.
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < entries.size() && j < successors.size()) {
+        uint64_t entry = entries[i];
+
+        if ((entry & 0xFFFF) + start > 0xFFFF) {
+            ++i;
+            continue;
+        }
+
+        uint64_t target = entry + start;
+        uint64_t successor = successors[j];
+
+        if (successor < target) {
+            j = Gallop(successors, j + 1, successors.size(), target);
+        } else if (successor > target) {
+            i = successor < start ? i + 1 : Gallop(entries, i + 1, entries.size(), successor - start);
+        } else {
+            output.push_back(entry);
+            ++i;
+        }
     }
 }
 
 void PostingList::Retain(const PostingList *other, size_t start) {
+    vector<uint64_t> entries;
+    vector<uint64_t> successors;
+    vector<uint64_t> retained;
+
     auto entry = datamap.begin();
     while (entry != datamap.end()) {
-        bool deleteEntry;
+        domain_t domain = entry->first;
 
-        if (other->datamap.find(entry->first) == other->datamap.end()) {
-            deleteEntry = true;
-        } else {
-            unordered_map<int64_t, unordered_set<length_t>> successors;
-            other->GetLocationMap(entry->first, successors);
-
-            size_t tail = 0;
-
-            char *bytes = entry->second.data();
-            for (size_t i = 0; i < entry->second.size(); i += kEntrySize) {
-                int64_t location = ReadInt64(bytes, i);
-                length_t offset = ReadUInt16(bytes, i + 8);
-
-                bool remove;
-
-                auto successor = successors.find(location);
-                if (successor == successors.end()) {
-                    remove = true;
-                } else {
-                    unordered_set<length_t> &successors_offsets = successor->second;
-                    remove = successors_offsets.find((length_t) (offset + start)) == successors_offsets.end();
-                }
-
-                if (!remove) {
-                    memcpy(&bytes[tail], &bytes[i], kEntrySize);
-                    tail += kEntrySize;
-                } else {
-                    entryCount--;
-                }
-            }
+        retained.clear();
+
+        auto successor = other->datamap.find(domain);
+        if (successor != other->datamap.end()) {
+            GetSortedEntries(entry->second, entries);
+            GetSortedEntries(successor->second, successors);
 
-            deleteEntry = (tail == 0);
-            entry->second.resize(tail);
+            Intersect(entries, successors, start, retained);
         }
 
-        if (deleteEntry) {
-            entryCount -= entry->second.size() / kEntrySize;
+        entryCount -= Count(entry->second.data(), entry->second.size());
+        openBlocks.erase(domain);
+
+        if (retained.empty()) {
             entry = datamap.erase(entry);
         } else {
+            entry->second = chunk_t();
+
+            for (auto e = retained.begin(); e != retained.end(); ++e)
+                Append(domain, (int64_t) (*e >> 16), (length_t) (*e & 0xFFFF));
+
             ++entry;
         }
     }
@@ -130,11 +263,15 @@ string PostingList::Serialize() const {
 }
 
 void PostingList::Deserialize(const char *data, size_t length, vector<location_t> &output) {
-    for (size_t i = 0; i < length; i += kEntrySize) {
-        int64_t location = ReadInt64(data, i);
-        length_t offset = ReadUInt16(data, i + 8);
+    int64_t locations[kMaxBlockEntries];
+    length_t offsets[kMaxBlockEntries];
 
-        output.push_back(location_t(location, offset));
+    size_t ptr = 0;
+    while (ptr < length) {
+        size_t count = DecodeBlock(data, &ptr, locations, offsets);
+
+        for (size_t i = 0; i < count; ++i)
+            output.push_back(location_t(locations[i], offsets[i]));
     }
 }
 
@@ -144,15 +281,21 @@ void PostingList::GetLocations(vector<location_t> &output, size_t limit, unsigne
 
     output.reserve(limit == 0 ? size() : limit);
 
+    int64_t locations[kMaxBlockEntries];
+    length_t offsets[kMaxBlockEntries];
+
     if (limit == 0 || size() <= limit) {
         // Collect all
         for (auto entry = datamap.begin(); entry != datamap.end(); ++entry) {
-            for (size_t i = 0; i < entry->second.size(); i += kEntrySize) {
-                int64_t location;
-                length_t offset;
+            const char *bytes = entry->second.data();
+            size_t length = entry->second.size();
 
-                Get(entry->second, i, &location, &offset);
-                output.push_back(location_t(location, offset, entry->first));
+            size_t ptr = 0;
+            while (ptr < length) {
+                size_t count = DecodeBlock(bytes, &ptr, locations, offsets);
+
+                for (size_t i = 0; i < count; ++i)
+                    output.push_back(location_t(locations[i], offsets[i], entry->first));
             }
         }
     } else {
@@ -163,31 +306,41 @@ void PostingList::GetLocations(vector<location_t> &output, size_t limit, unsigne
         GenerateRandomSequence(size(), limit, seed, sequence);
         sort(sequence.begin(), sequence.end());
 
-        auto sequencePtr = sequence.begin();
+        vector<size_t>::const_iterator sequencePtr = sequence.begin();
         size_t dataOffset = 0;
 
+        for (auto entry = datamap.begin(); entry != datamap.end() && sequencePtr != sequence.end(); ++entry) {
+            SelectLocations(entry->second.data(), entry->second.size(), entry->first,
+                            sequencePtr, sequence.end(), dataOffset, output);
+        }
+    }
+}
+
+void PostingList::SelectLocations(const char *bytes, size_t length, domain_t domain,
+                                  vector<size_t>::const_iterator &sequencePtr,
+                                  const vector<size_t>::const_iterator &sequenceEnd,
+                                  size_t &dataOffset, vector<location_t> &output) {
+    int64_t locations[kMaxBlockEntries];
+    length_t offsets[kMaxBlockEntries];
 
-        for (auto entry = datamap.begin(); entry != datamap.end() && sequencePtr != sequence.end(); ++entry) {//
-            size_t i;
+    size_t ptr = 0;
+    while (ptr < length) {
+        size_t count = ReadUInt16(bytes, ptr);
 
-            while ((i = (*sequencePtr) * kEntrySize) < dataOffset + entry->second.size()
-                   && sequencePtr != sequence.end()) {
-                int64_t location;
-                length_t offset;
+        if (sequencePtr != sequenceEnd && *sequencePtr < dataOffset + count) {
+            DecodeBlock(bytes, &ptr, locations, offsets);
 
-                Get(entry->second, i - dataOffset, &location, &offset);
-                output.push_back(location_t(location, offset, entry->first));
+            while (sequencePtr != sequenceEnd && *sequencePtr < dataOffset + count) {
+                size_t i = *sequencePtr - dataOffset;
+                output.push_back(location_t(locations[i], offsets[i], domain));
 
                 sequencePtr++;
             }
-
-            dataOffset += entry->second.size();
+        } else {
+            // skip the whole block without decoding
+            ptr += kBlockHeaderSize + ReadUInt16(bytes, ptr + 2);
         }
-    }
-}
 
-inline void PostingList::Get(const vector<char> &chunk, size_t index, int64_t *outLocation, length_t *outOffset) {
-    const char *bytes = chunk.data();
-    *outLocation = ReadInt64(bytes, index);
-    *outOffset = ReadUInt16(bytes, index + 8);
+        dataOffset += count;
+    }
 }
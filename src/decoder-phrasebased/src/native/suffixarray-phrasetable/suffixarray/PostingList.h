@@ -7,8 +7,8 @@
 
 #include <string>
 #include <mmt/sentence.h>
-#include <unordered_set>
 #include <map>
+#include <memory>
 
 using namespace std;
 
@@ -24,14 +24,33 @@ namespace mmt {
                     : pointer(pointer), offset(offset), domain(domain) {}
         };
 
+        // The posting list of a domain is serialized as a sequence of independent blocks,
+        // so that two serialized lists can be concatenated (i.e. merged) without decoding.
+        // Every block has a fixed size header followed by the encoded entries:
+        //
+        //   [uint16 count][uint16 payload length][int64 first pointer][payload]
+        //
+        // Every entry in the payload is encoded as VBE(pointer - previous pointer) VBE(offset),
+        // where the first delta is relative to the block first pointer; pointers are therefore
+        // non-decreasing within a block. The header allows to count entries and to skip
+        // a whole block without decoding its payload.
         class PostingList {
         public:
 
-            static const size_t kEntrySize = sizeof(int64_t) + sizeof(length_t);
+            static const size_t kBlockHeaderSize = 2 * sizeof(uint16_t) + sizeof(int64_t);
+            static const size_t kMaxBlockEntries = 128;
 
             PostingList();
 
-            void Append(domain_t domain, const string &value);
+            void Append(domain_t domain, const string &value) {
+                Append(domain, value.data(), value.size());
+            }
+
+            void Append(domain_t domain, const char *data, size_t length);
+
+            // References the given bytes without copying them: "pin" is retained
+            // by the posting list and must keep the referenced memory valid.
+            void Append(domain_t domain, const char *data, size_t length, const shared_ptr<void> &pin);
 
             void Append(domain_t domain, int64_t location, length_t offset);
 
@@ -47,13 +66,56 @@ namespace mmt {
 
             static void Deserialize(const char *data, size_t length, vector<location_t> &output);
 
+            static size_t Count(const char *data, size_t length);
+
+            // Appends to output the entries of the serialized list whose index (counted from
+            // "dataOffset") is in the sorted sequence: blocks without selected entries are
+            // skipped without decoding. "sequence" and "dataOffset" are moved past this list.
+            static void SelectLocations(const char *data, size_t length, domain_t domain,
+                                        vector<size_t>::const_iterator &sequence,
+                                        const vector<size_t>::const_iterator &sequenceEnd,
+                                        size_t &dataOffset, vector<location_t> &output);
+
         private:
+            struct block_t {
+                size_t header;
+                int64_t lastPointer;
+
+                block_t(size_t header = 0, int64_t lastPointer = 0) : header(header), lastPointer(lastPointer) {};
+            };
+
+            struct chunk_t {
+                vector<char> buffer;
+                shared_ptr<void> pin;
+                const char *pinnedData;
+                size_t pinnedLength;
+
+                chunk_t() : pinnedData(NULL), pinnedLength(0) {};
+
+                inline const char *data() const {
+                    return pin ? pinnedData : buffer.data();
+                }
+
+                inline size_t size() const {
+                    return pin ? pinnedLength : buffer.size();
+                }
+            };
+
             size_t entryCount;
-            map<domain_t, vector<char>> datamap;
+            map<domain_t, chunk_t> datamap;
+            map<domain_t, block_t> openBlocks;
+
+            static vector<char> &GetBuffer(chunk_t &chunk);
+
+            // Entries are packed as (pointer << 16 | offset), so that the
+            // integer order is the (pointer, offset) order
+            static void GetSortedEntries(const chunk_t &chunk, vector<uint64_t> &output);
 
-            void GetLocationMap(domain_t domain, unordered_map<int64_t, unordered_set<length_t>> &output) const;
+            static void Intersect(const vector<uint64_t> &entries, const vector<uint64_t> &successors, size_t start,
+                                  vector<uint64_t> &output);
 
-            inline void Get(const vector<char> &chunk, size_t index, int64_t *outLocation, length_t *outOffset);
+            static inline size_t DecodeBlock(const char *data, size_t *ptr, int64_t *outLocations,
+                                             length_t *outOffsets);
         };
 
     }
@@ -2,8 +2,12 @@
 // Created by Davide Caroselli on 03/10/16.
 //
 
+#include <algorithm>
+#include <ctime>
+#include <util/randutils.h>
 #include "PrefixCursor.h"
 #include "dbkv.h"
+#include "storage/StorageManifest.h"
 
 using namespace mmt;
 using namespace mmt::sapt;
@@ -15,29 +19,73 @@ namespace mmt {
         class DomainCursor : public PrefixCursor {
         public:
 
-            DomainCursor(rocksdb::DB *db, length_t prefixLength, domain_t domain)
-                    : db(db), domain(domain), prefixLength(prefixLength) {
+            DomainCursor(rocksdb::DB *db, length_t prefixLength, domain_t domain, const DomainTombstones *tombstones)
+                    : db(db), domain(domain), prefixLength(prefixLength), tombstones(tombstones) {
             }
 
             virtual void Seek(const vector<wid_t> &phrase, size_t offset, size_t length) override {
+                if (tombstones && tombstones->Contains(domain)) {
+                    value.reset();
+                    return;
+                }
+
                 string key = MakePrefixKey(prefixLength, domain, phrase, offset, length);
-                db->Get(ReadOptions(), key, &value);
+
+                // The value may still be referenced by a PostingList: in that case
+                // a new slice is allocated instead of resetting the current one
+                if (value.use_count() == 1)
+                    value->Reset();
+                else
+                    value.reset(new PinnableSlice());
+
+                Status status = db->Get(ReadOptions(), db->DefaultColumnFamily(), key, value.get());
+                if (!status.ok())
+                    value.reset();
             }
 
             virtual bool HasNext() override {
-                return value.size() > 0;
+                return value && value->size() > 0;
             }
 
             virtual void Next() override {
-                value.resize(0);
+                value.reset();
             }
 
             virtual void CollectValue(PostingList *output) override {
-                output->Append(domain, value);
+                output->Append(domain, value->data(), value->size(), value);
             }
 
             virtual size_t CountValue() override {
-                return value.size() / PostingList::kEntrySize;
+                return PostingList::Count(value->data(), value->size());
+            }
+
+            virtual Slice GetValue(domain_t *outDomain) override {
+                *outDomain = domain;
+                return Slice(value->data(), value->size());
+            }
+
+            virtual size_t SampleLocations(const vector<wid_t> &phrase, size_t offset, size_t length,
+                                           size_t limit, unsigned int seed, vector<location_t> &output) override {
+                // Entries are counted and selected on the same value, read just once
+                Seek(phrase, offset, length);
+                if (!HasNext())
+                    return 0;
+
+                size_t total = CountValue();
+                if (total == 0)
+                    return 0;
+
+                vector<size_t> sequence;
+                MakeSampleSequence(total, limit, seed, sequence);
+
+                output.reserve(output.size() + sequence.size());
+
+                auto sequencePtr = sequence.cbegin();
+                size_t dataOffset = 0;
+                PostingList::SelectLocations(value->data(), value->size(), domain,
+                                             sequencePtr, sequence.cend(), dataOffset, output);
+
+                return total;
             }
 
         private:
@@ -45,14 +93,17 @@ namespace mmt {
 
             const domain_t domain;
             const length_t prefixLength;
+            const DomainTombstones *tombstones;
 
-            string value;
+            shared_ptr<PinnableSlice> value;
         };
 
         class GlobalCursor : public PrefixCursor {
         public:
-            GlobalCursor(rocksdb::DB *db, length_t prefixLength, unordered_set<domain_t> *_skipList)
-                    : skipDomains(_skipList != NULL), prefixLength(prefixLength), it(db->NewIterator(ReadOptions())) {
+            GlobalCursor(rocksdb::DB *db, length_t prefixLength, unordered_set<domain_t> *_skipList,
+                         const DomainTombstones *tombstones)
+                    : db(db), skipDomains(_skipList != NULL), prefixLength(prefixLength), tombstones(tombstones),
+                      it(db->NewIterator(ReadOptions())) {
                 if (_skipList)
                     skipList.insert(_skipList->begin(), _skipList->end());
             }
@@ -71,7 +122,7 @@ namespace mmt {
                 while (it->Valid() && (currentKey = it->key()).starts_with(key)) {
                     domain = GetDomainFromKey(currentKey.data(), prefixLength);
 
-                    if (!skipDomains || skipList.find(domain) == skipList.end()) {
+                    if (!IsSkipped(domain)) {
                         hasNext = true;
                         break;
                     } else {
@@ -87,12 +138,40 @@ namespace mmt {
             }
 
             virtual void CollectValue(PostingList *output) override {
+                // Iterator values are invalidated by Next(), they are copied just once
                 Slice value = it->value();
-                output->Append(domain, string(value.data(), value.size()));
+                output->Append(domain, value.data(), value.size());
             }
 
             virtual size_t CountValue() override {
-                return it->value().size() / PostingList::kEntrySize;
+                Slice value = it->value();
+                return PostingList::Count(value.data(), value.size());
+            }
+
+            virtual Slice GetValue(domain_t *outDomain) override {
+                *outDomain = domain;
+                return it->value();
+            }
+
+            virtual size_t SampleLocations(const vector<wid_t> &phrase, size_t offset, size_t length,
+                                           size_t limit, unsigned int seed, vector<location_t> &output) override {
+                // Both the counting and the selection pass read the same snapshot
+                const Snapshot *snapshot = db->GetSnapshot();
+
+                ReadOptions options;
+                options.snapshot = snapshot;
+
+                size_t total;
+
+                try {
+                    total = SampleLocations(options, phrase, offset, length, limit, seed, output);
+                } catch (...) {
+                    db->ReleaseSnapshot(snapshot);
+                    throw;
+                }
+
+                db->ReleaseSnapshot(snapshot);
+                return total;
             }
 
             virtual ~GlobalCursor() {
@@ -100,27 +179,226 @@ namespace mmt {
             }
 
         private:
+            rocksdb::DB *db;
             const bool skipDomains;
             const length_t prefixLength;
             unordered_set<domain_t> skipList;
+            const DomainTombstones *tombstones;
 
             Iterator *it;
             string key;
             domain_t domain;
+
+            inline bool IsSkipped(domain_t domain) const {
+                return (skipDomains && skipList.find(domain) != skipList.end()) ||
+                       (tombstones && tombstones->Contains(domain));
+            }
+
+            size_t SampleLocations(const ReadOptions &options, const vector<wid_t> &phrase, size_t offset,
+                                   size_t length, size_t limit, unsigned int seed, vector<location_t> &output) {
+                string value;
+
+                // The global count includes the skipped and deleted domains: if it does not
+                // exceed the limit, all the entries are selected and read in a single pass
+                string countKey = MakeCountKey(kSourceCountKeyType, prefixLength, phrase, offset, length);
+                if (!db->Get(options, countKey, &value).ok())
+                    return 0;
+
+                size_t globalCount = (size_t) DeserializeCount(value.data(), value.size());
+                if (globalCount == 0)
+                    return 0;
+
+                if (limit == 0 || globalCount <= limit)
+                    return CollectLocations(options, phrase, offset, length, globalCount, output);
+
+                // Candidate domains are the ones of the storage manifest, sorted
+                // in order to keep the same entry numbering of the posting lists
+                value.clear();
+                db->Get(options, MakeEmptyKey(kStorageManifestKeyType), &value);
+
+                StorageManifest *manifest = StorageManifest::Deserialize(value.data(), value.size());
+                unordered_set<domain_t> manifestDomains;
+                manifest->GetDomains(&manifestDomains);
+                delete manifest;
+
+                vector<domain_t> domains;
+                domains.reserve(manifestDomains.size());
+                for (auto domain = manifestDomains.begin(); domain != manifestDomains.end(); ++domain) {
+                    if (!IsSkipped(*domain))
+                        domains.push_back(*domain);
+                }
+
+                if (domains.empty())
+                    return 0;
+
+                sort(domains.begin(), domains.end());
+
+                // Legacy domains have no per-domain counts, their posting lists are read
+                // and kept for the selection pass
+                unordered_set<domain_t> legacyDomains;
+                {
+                    string legacyEnd = MakeEmptyKey(kLegacyDomainKeyType + 1);
+                    Iterator *legacyIt = db->NewIterator(options);
+
+                    for (legacyIt->Seek(MakeEmptyKey(kLegacyDomainKeyType));
+                         legacyIt->Valid() && legacyIt->key().compare(legacyEnd) < 0; legacyIt->Next()) {
+                        legacyDomains.insert(ReadUInt32(legacyIt->key().data(), (size_t) 1));
+                    }
+
+                    delete legacyIt;
+                }
+
+                vector<string> keys(domains.size());
+                vector<Slice> keySlices(domains.size());
+                for (size_t i = 0; i < domains.size(); ++i) {
+                    keys[i] = MakeDomainCountKey(kDomainSourceCountKeyType, prefixLength, domains[i],
+                                                 phrase, offset, length);
+                    keySlices[i] = keys[i];
+                }
+
+                vector<string> values;
+                vector<Status> statuses = db->MultiGet(options, keySlices, &values);
+
+                vector<size_t> counts(domains.size(), 0);
+                size_t total = 0;
+
+                for (size_t i = 0; i < domains.size(); ++i) {
+                    if (legacyDomains.find(domains[i]) != legacyDomains.end()) {
+                        values[i].clear();
+                        db->Get(options, MakePrefixKey(prefixLength, domains[i], phrase, offset, length), &values[i]);
+                        counts[i] = PostingList::Count(values[i].data(), values[i].size());
+                    } else {
+                        if (statuses[i].ok())
+                            counts[i] = (size_t) DeserializeCount(values[i].data(), values[i].size());
+                        values[i].clear();
+                    }
+
+                    total += counts[i];
+                }
+
+                if (total == 0)
+                    return 0;
+
+                vector<size_t> sequence;
+                MakeSampleSequence(total, limit, seed, sequence);
+
+                output.reserve(output.size() + sequence.size());
+
+                // Only the posting lists holding at least one selected entry are read
+                auto sequencePtr = sequence.cbegin();
+                size_t base = 0;
+
+                for (size_t i = 0; i < domains.size() && sequencePtr != sequence.cend(); base += counts[i], ++i) {
+                    size_t end = base + counts[i];
+                    if (*sequencePtr >= end)
+                        continue;
+
+                    if (legacyDomains.find(domains[i]) == legacyDomains.end())
+                        db->Get(options, MakePrefixKey(prefixLength, domains[i], phrase, offset, length), &values[i]);
+
+                    size_t dataOffset = base;
+                    PostingList::SelectLocations(values[i].data(), values[i].size(), domains[i],
+                                                 sequencePtr, sequence.cend(), dataOffset, output);
+                    values[i].clear();
+
+                    // Entries missing from the posting list can not be selected
+                    while (sequencePtr != sequence.cend() && *sequencePtr < end)
+                        ++sequencePtr;
+                }
+
+                return total;
+            }
+
+            size_t CollectLocations(const ReadOptions &options, const vector<wid_t> &phrase, size_t offset,
+                                    size_t length, size_t maxCount, vector<location_t> &output) {
+                vector<size_t> sequence(maxCount);
+                for (size_t i = 0; i < maxCount; ++i)
+                    sequence[i] = i;
+
+                output.reserve(output.size() + maxCount);
+
+                string prefix = MakePrefixKey(prefixLength, 0, phrase, offset, length);
+                prefix.resize(prefix.size() - sizeof(domain_t));
+
+                auto sequencePtr = sequence.cbegin();
+                size_t dataOffset = 0;
+
+                Iterator *scanIt = db->NewIterator(options);
+
+                for (scanIt->Seek(prefix); scanIt->Valid() && scanIt->key().starts_with(prefix); scanIt->Next()) {
+                    domain_t valueDomain = GetDomainFromKey(scanIt->key().data(), prefixLength);
+                    if (IsSkipped(valueDomain))
+                        continue;
+
+                    Slice value = scanIt->value();
+                    PostingList::SelectLocations(value.data(), value.size(), valueDomain,
+                                                 sequencePtr, sequence.cend(), dataOffset, output);
+                }
+
+                delete scanIt;
+
+                return dataOffset;
+            }
         };
     }
 }
 
-PrefixCursor *PrefixCursor::NewDomainCursor(rocksdb::DB *db, length_t prefixLength, domain_t domain) {
-    return new DomainCursor(db, prefixLength, domain);
+PrefixCursor *PrefixCursor::NewDomainCursor(rocksdb::DB *db, length_t prefixLength, domain_t domain,
+                                            const DomainTombstones *tombstones) {
+    return new DomainCursor(db, prefixLength, domain, tombstones);
 }
 
-PrefixCursor *PrefixCursor::NewGlobalCursor(rocksdb::DB *db, length_t prefixLength, const context_t *skipDomains) {
+PrefixCursor *PrefixCursor::NewGlobalCursor(rocksdb::DB *db, length_t prefixLength, const context_t *skipDomains,
+                                            const DomainTombstones *tombstones) {
     unordered_set<domain_t> domains;
     if (skipDomains) {
         for (auto score = skipDomains->begin(); score != skipDomains->end(); ++score)
             domains.insert(score->domain);
     }
 
-    return new GlobalCursor(db, prefixLength, skipDomains ? &domains : NULL);
+    return new GlobalCursor(db, prefixLength, skipDomains ? &domains : NULL, tombstones);
+}
+
+void PrefixCursor::MakeSampleSequence(size_t total, size_t limit, unsigned int seed, vector<size_t> &sequence) {
+    if (limit == 0 || total <= limit) {
+        // Nothing to sample: all the entries are selected
+        sequence.resize(total);
+        for (size_t i = 0; i < total; ++i)
+            sequence[i] = i;
+    } else {
+        if (seed == 0)
+            seed = (unsigned int) time(NULL);
+
+        GenerateRandomSequence(total, limit, seed, sequence);
+        sort(sequence.begin(), sequence.end());
+    }
+}
+
+size_t PrefixCursor::SampleLocations(const vector<wid_t> &phrase, size_t offset, size_t length,
+                                     size_t limit, unsigned int seed, vector<location_t> &output) {
+    size_t total = 0;
+    for (Seek(phrase, offset, length); HasNext(); Next())
+        total += CountValue();
+
+    if (total == 0)
+        return 0;
+
+    vector<size_t> sequence;
+    MakeSampleSequence(total, limit, seed, sequence);
+
+    output.reserve(output.size() + sequence.size());
+
+    // Entries are visited in the same order as the counting pass, the
+    // scan stops as soon as the last selected entry has been reached
+    auto sequencePtr = sequence.cbegin();
+    size_t dataOffset = 0;
+    domain_t domain;
+
+    for (Seek(phrase, offset, length); HasNext() && sequencePtr != sequence.cend(); Next()) {
+        Slice value = GetValue(&domain);
+        PostingList::SelectLocations(value.data(), value.size(), domain,
+                                     sequencePtr, sequence.cend(), dataOffset, output);
+    }
+
+    return total;
 }
@@ -7,6 +7,7 @@
 
 #include <rocksdb/db.h>
 #include <mmt/sentence.h>
+#include <mmt/DomainTombstones.h>
 #include "PostingList.h"
 
 using namespace std;
@@ -17,10 +18,13 @@ namespace mmt {
         class PrefixCursor {
         public:
 
-            static PrefixCursor *NewDomainCursor(rocksdb::DB *db, length_t prefixLength, domain_t domain);
+            // Entries of the domains in "tombstones" (if not NULL) are never returned
+            static PrefixCursor *NewDomainCursor(rocksdb::DB *db, length_t prefixLength, domain_t domain,
+                                                 const DomainTombstones *tombstones = NULL);
 
             static PrefixCursor *NewGlobalCursor(rocksdb::DB *db, length_t prefixLength,
-                                                 const context_t *skipDomains = NULL);
+                                                 const context_t *skipDomains = NULL,
+                                                 const DomainTombstones *tombstones = NULL);
 
             virtual ~PrefixCursor() {};
 
@@ -37,6 +41,24 @@ namespace mmt {
             virtual void CollectValue(PostingList *output) = 0;
 
             virtual size_t CountValue() = 0;
+
+            // Returns the serialized posting list of the current entry; the slice is
+            // valid until the next call to Seek() or Next()
+            virtual rocksdb::Slice GetValue(domain_t *outDomain) = 0;
+
+            // Samples at most "limit" locations of the phrase without collecting the whole
+            // posting list: the entries are counted first, then only the blocks containing
+            // the randomly selected entries are decoded. The default implementation counts
+            // the entries by reading the block headers of every value; the cursors over the
+            // index read the per-domain counts instead and fetch just the posting lists
+            // holding the selected entries.
+            // Returns the total number of locations available for the phrase.
+            virtual size_t SampleLocations(const vector<wid_t> &phrase, size_t offset, size_t length,
+                                           size_t limit, unsigned int seed, vector<location_t> &output);
+
+        protected:
+            // Sorted offsets of the entries to select out of "total" ones
+            static void MakeSampleSequence(size_t total, size_t limit, unsigned int seed, vector<size_t> &sequence);
         };
 
     }
@@ -4,8 +4,10 @@
 
 #include "SuffixArray.h"
 #include "dbkv.h"
+#include <util/chrono.h>
 #include <rocksdb/slice_transform.h>
 #include <rocksdb/merge_operator.h>
+#include <rocksdb/compaction_filter.h>
 #include <boost/filesystem.hpp>
 #include <thread>
 #include <fstream>
@@ -19,6 +21,16 @@ using namespace mmt::sapt;
 
 static const string kStreamsKey = MakeEmptyKey(kStreamsKeyType);
 static const string kStorageManifestKey = MakeEmptyKey(kStorageManifestKeyType);
+static const string kIndexFormatKey = MakeEmptyKey(kIndexFormatKeyType);
+
+// Version 1 is the block-encoded posting list format (see PostingList),
+// indexes without a format key store raw (int64 pointer, uint16 offset) entries.
+// Version 2 adds the global count of every source prefix (kSourceCountKeyType).
+// Version 3 adds the per-domain source and target counts (kDomainSourceCountKeyType and
+// kDomainTargetCountKeyType); domains indexed before the upgrade are marked as legacy.
+static const int64_t kIndexFormatVersion = 3;
+static const size_t kLegacyEntrySize = sizeof(int64_t) + sizeof(length_t);
+static const size_t kUpgradeBatchSize = 100000;
 
 /*
  * MergePositionOperator
@@ -35,7 +47,10 @@ namespace mmt {
                     case kSourcePrefixKeyType:
                         MergePositionLists(existing_value, value, new_value);
                         return true;
+                    case kSourceCountKeyType:
                     case kTargetCountKeyType:
+                    case kDomainSourceCountKeyType:
+                    case kDomainTargetCountKeyType:
                         MergeCounts(existing_value, value, new_value);
                         return true;
                     default:
@@ -44,6 +59,7 @@ namespace mmt {
             }
 
             inline void MergePositionLists(const Slice *existing_value, const Slice &value, string *new_value) const {
+                // Posting list blocks are self-delimiting, concatenation is a valid merge
                 if (existing_value)
                     *new_value = existing_value->ToString() + value.ToString();
                 else
@@ -66,13 +82,53 @@ namespace mmt {
     }
 }
 
+/*
+ * DomainTombstoneFilter
+ */
+
+namespace mmt {
+    namespace sapt {
+
+        // Drops the source prefixes of the deleted domains; the per-domain
+        // counts are kept, they are needed by the garbage collector
+        class DomainTombstoneFilter : public CompactionFilter {
+        public:
+            DomainTombstoneFilter(const DomainTombstones *tombstones, uint8_t prefixLength)
+                    : tombstones(tombstones), prefixLength(prefixLength) {};
+
+            virtual bool Filter(int level, const Slice &key, const Slice &existing_value, string *new_value,
+                                bool *value_changed) const override {
+                return IsDeleted(key);
+            }
+
+            virtual bool FilterMergeOperand(int level, const Slice &key, const Slice &operand) const override {
+                return IsDeleted(key);
+            }
+
+            virtual const char *Name() const override {
+                return "DomainTombstoneFilter";
+            }
+
+        private:
+            const DomainTombstones *tombstones;
+            const uint8_t prefixLength;
+
+            inline bool IsDeleted(const Slice &key) const {
+                return key.size() > 0 && key.data()[0] == kSourcePrefixKeyType &&
+                       tombstones->Contains(GetDomainFromKey(key.data(), prefixLength));
+            }
+        };
+
+    }
+}
+
 /*
  * SuffixArray - Initialization
  */
 
 SuffixArray::SuffixArray(const string &modelPath, uint8_t prefixLength, double gcTimeout, size_t gcBatchSize,
                          bool prepareForBulkLoad) throw(index_exception, storage_exception) :
-        logger("sapt.SuffixArray"), openForBulkLoad(prepareForBulkLoad), prefixLength(prefixLength) {
+        logger("sapt.SuffixArray"), openForBulkLoad(prepareForBulkLoad), prefixLength(prefixLength), version(0) {
     fs::path modelDir(modelPath);
 
     if (!fs::is_directory(modelDir))
@@ -84,6 +140,9 @@ SuffixArray::SuffixArray(const string &modelPath, uint8_t prefixLength, double g
     rocksdb::Options options;
     options.create_if_missing = true;
     options.merge_operator.reset(new MergePositionOperator);
+
+    compactionFilter = new DomainTombstoneFilter(&tombstones, prefixLength);
+    options.compaction_filter = compactionFilter;
     options.max_open_files = -1;
     options.compaction_style = kCompactionStyleLevel;
 
@@ -108,8 +167,13 @@ SuffixArray::SuffixArray(const string &modelPath, uint8_t prefixLength, double g
     }
 
     Status status = DB::Open(options, indexPath.string(), &db);
-    if (!status.ok())
+    if (!status.ok()) {
+        delete compactionFilter;
         throw index_exception(status.ToString());
+    }
+
+    // Upgrade legacy posting lists
+    UpgradeIndexFormat();
 
     // Read streams
     string raw_streams;
@@ -126,54 +190,214 @@ SuffixArray::SuffixArray(const string &modelPath, uint8_t prefixLength, double g
     storage = new CorporaStorage(storageFolder.string(), manifest);
 
     // Garbage collector
-    garbageCollector = new GarbageCollector(storage, db, prefixLength, gcBatchSize, gcTimeout);
+    garbageCollector = new GarbageCollector(storage, db, &tombstones, prefixLength, gcBatchSize, gcTimeout);
 }
 
 SuffixArray::~SuffixArray() {
     delete garbageCollector;
     delete db;
+    delete compactionFilter;
     delete storage;
 }
 
-/*
- * SuffixArray - Indexing
- */
+void SuffixArray::UpgradeIndexFormat() throw(index_exception) {
+    // The format key contains either the current format version or, if a previous
+    // upgrade has been interrupted, the version being upgraded followed by the last
+    // source prefix key already processed.
+    string state;
+    db->Get(ReadOptions(), kIndexFormatKey, &state);
 
-void SuffixArray::ForceCompaction() throw(index_exception) {
-    if (openForBulkLoad) {
-        WriteBatch writeBatch;
+    int64_t version = 0;
+    string resumeKey;
 
-        // Write streams
-        writeBatch.Put(kStreamsKey, SerializeStreams(streams));
+    if (state.size() >= sizeof(int64_t)) {
+        version = ReadInt64(state.data(), (size_t) 0);
+        resumeKey = state.substr(sizeof(int64_t));
+    }
 
-        // Write storage manifest
-        storage->Flush();
-        string manifest = storage->GetManifest()->Serialize();
-        writeBatch.Put(kStorageManifestKey, manifest);
+    if (version == kIndexFormatVersion)
+        return;
+
+    if (version == 2) {
+        rocksdb::WriteBatch writeBatch;
+        AddLegacyDomainsToBatch(writeBatch);
+        writeBatch.Put(kIndexFormatKey, SerializeCount(kIndexFormatVersion));
 
-        // Commit write batch
         Status status = db->Write(WriteOptions(), &writeBatch);
         if (!status.ok())
             throw index_exception("Unable to write to index: " + status.ToString());
+
+        return;
+    }
+
+    bool convertPostingLists = version < 1;
+
+    double beginTime = GetTime();
+    size_t count = 0;
+    size_t batchCount = 0;
+
+    string prefix = MakeEmptyKey(kSourcePrefixKeyType);
+    Iterator *it = db->NewIterator(ReadOptions());
+
+    if (resumeKey.empty()) {
+        it->Seek(prefix);
+    } else {
+        it->Seek(resumeKey);
+        if (it->Valid() && it->key().compare(resumeKey) == 0)
+            it->Next();
     }
 
+    rocksdb::WriteBatch writeBatch;
+
+    // Source prefix keys are sorted by phrase first, so that all the domains
+    // of a phrase are consecutive and its global count can be written at once.
+    size_t phraseKeySize = 1 + prefixLength * sizeof(wid_t);
+    string phraseKey;
+    string lastKey;
+    int64_t phraseCount = 0;
+
+    Slice key;
+    while (it->Valid() && (key = it->key()).starts_with(prefix)) {
+        if (count == 0)
+            LogInfo(logger) << "Upgrading index to format version " << kIndexFormatVersion;
+
+        if (phraseKey.empty() || Slice(phraseKey).compare(Slice(key.data(), phraseKeySize)) != 0) {
+            if (!phraseKey.empty()) {
+                vector<wid_t> words;
+                GetWordsFromKey(phraseKey.data(), prefixLength, words);
+                writeBatch.Put(MakeCountKey(kSourceCountKeyType, prefixLength, words, 0, words.size()),
+                               SerializeCount(phraseCount));
+
+                // The state is saved on phrase boundaries only
+                if (batchCount >= kUpgradeBatchSize) {
+                    writeBatch.Put(kIndexFormatKey, SerializeCount(version) + lastKey);
+
+                    Status status = db->Write(WriteOptions(), &writeBatch);
+                    if (!status.ok()) {
+                        delete it;
+                        throw index_exception("Unable to write to index: " + status.ToString());
+                    }
+
+                    writeBatch.Clear();
+                    batchCount = 0;
+                }
+            }
+
+            phraseKey.assign(key.data(), phraseKeySize);
+            phraseCount = 0;
+        }
+
+        Slice value = it->value();
+
+        if (convertPostingLists) {
+            domain_t domain = GetDomainFromKey(key.data(), prefixLength);
+
+            PostingList postingList;
+            for (size_t i = 0; i + kLegacyEntrySize <= value.size(); i += kLegacyEntrySize)
+                postingList.Append(domain, ReadInt64(value.data(), i), ReadUInt16(value.data(), i + 8));
+
+            writeBatch.Put(key, postingList.Serialize());
+            phraseCount += postingList.size();
+        } else {
+            phraseCount += PostingList::Count(value.data(), value.size());
+        }
+
+        lastKey = key.ToString();
+        count++;
+        batchCount++;
+
+        it->Next();
+    }
+
+    Status status = it->status();
+    delete it;
+
+    if (!status.ok())
+        throw index_exception(status.ToString());
+
+    if (!phraseKey.empty()) {
+        vector<wid_t> words;
+        GetWordsFromKey(phraseKey.data(), prefixLength, words);
+        writeBatch.Put(MakeCountKey(kSourceCountKeyType, prefixLength, words, 0, words.size()),
+                       SerializeCount(phraseCount));
+    }
+
+    AddLegacyDomainsToBatch(writeBatch);
+    writeBatch.Put(kIndexFormatKey, SerializeCount(kIndexFormatVersion));
+
+    status = db->Write(WriteOptions(), &writeBatch);
+    if (!status.ok())
+        throw index_exception("Unable to write to index: " + status.ToString());
+
+    if (count > 0)
+        LogInfo(logger) << "Upgraded " << count << " source prefixes in " << GetElapsedTime(beginTime) << "s";
+}
+
+void SuffixArray::AddLegacyDomainsToBatch(rocksdb::WriteBatch &writeBatch) throw(index_exception) {
+    // Legacy domains have no per-domain counts, the garbage collector
+    // must read their content from the storage in order to delete them
+    string raw_manifest;
+    db->Get(ReadOptions(), kStorageManifestKey, &raw_manifest);
+
+    StorageManifest *manifest;
+
+    try {
+        manifest = StorageManifest::Deserialize(raw_manifest.data(), raw_manifest.size());
+    } catch (storage_exception &e) {
+        throw index_exception(e.what());
+    }
+
+    unordered_set<domain_t> domains;
+    manifest->GetDomains(&domains);
+    delete manifest;
+
+    for (auto domain = domains.begin(); domain != domains.end(); ++domain)
+        writeBatch.Put(MakeLegacyDomainKey(*domain), "");
+}
+
+/*
+ * SuffixArray - Indexing
+ */
+
+void SuffixArray::ForceCompaction() throw(index_exception) {
+    if (openForBulkLoad)
+        WriteState();
+
     db->CompactRange(CompactRangeOptions(), NULL, NULL);
 }
 
+void SuffixArray::WriteState() throw(index_exception) {
+    WriteBatch writeBatch;
+
+    // Write streams
+    writeBatch.Put(kStreamsKey, SerializeStreams(streams));
+
+    // Write storage manifest
+    storage->Flush();
+    string manifest = storage->GetManifest()->Serialize();
+    writeBatch.Put(kStorageManifestKey, manifest);
+
+    // Commit write batch
+    Status status = db->Write(WriteOptions(), &writeBatch);
+    if (!status.ok())
+        throw index_exception("Unable to write to index: " + status.ToString());
+}
+
 void SuffixArray::PutBatch(UpdateBatch &batch) throw(index_exception, storage_exception) {
     LogInfo(logger) << "Importing batch of " << batch.data.size() << " sentence pairs.";
     WriteBatch writeBatch;
 
     // Compute prefixes
     unordered_map <string, PostingList> sourcePrefixes;
-    unordered_map <string, int64_t> targetCounts;
+    unordered_map <string, int64_t> counts;
 
     for (auto entry = batch.data.begin(); entry != batch.data.end(); ++entry) {
         domain_t domain = entry->domain;
 
         int64_t offset = storage->Append(domain, entry->source, entry->target, entry->alignment);
         AddPrefixesToBatch(domain, entry->source, offset, sourcePrefixes);
-        AddTargetCountsToBatch(entry->target, targetCounts);
+        AddCountsToBatch(domain, true, entry->source, counts);
+        AddCountsToBatch(domain, false, entry->target, counts);
     }
 
     // Add prefixes to write batch
@@ -182,8 +406,8 @@ void SuffixArray::PutBatch(UpdateBatch &batch) throw(index_exception, storage_ex
         writeBatch.Merge(prefix->first, value);
     }
 
-    // Add target counts to write batch
-    for (auto count = targetCounts.begin(); count != targetCounts.end(); ++count) {
+    // Add source and target counts to write batch
+    for (auto count = counts.begin(); count != counts.end(); ++count) {
         string value = SerializeCount(count->second);
         writeBatch.Merge(count->first, value);
     }
@@ -209,6 +433,7 @@ void SuffixArray::PutBatch(UpdateBatch &batch) throw(index_exception, storage_ex
 
     // Reset streams and domains
     streams = batch.GetStreams();
+    version++;
     garbageCollector->MarkForDeletion(batch.deletions);
 }
 
@@ -227,16 +452,24 @@ void SuffixArray::AddPrefixesToBatch(domain_t domain, const vector <wid_t> &sent
     }
 }
 
-void SuffixArray::AddTargetCountsToBatch(const vector <wid_t> &sentence, unordered_map <string, int64_t> &outBatch) {
+void SuffixArray::AddCountsToBatch(domain_t domain, bool isSource, const vector <wid_t> &sentence,
+                                   unordered_map <string, int64_t> &outBatch) {
     size_t size = sentence.size();
 
+    KeyType type = isSource ? kSourceCountKeyType : kTargetCountKeyType;
+    KeyType domainType = isSource ? kDomainSourceCountKeyType : kDomainTargetCountKeyType;
+
     for (size_t start = 0; start < size; ++start) {
         for (size_t length = 1; length <= prefixLength; ++length) {
             if (start + length > size)
                 break;
 
-            string dkey = MakeCountKey(prefixLength, sentence, start, length);
+            string dkey = MakeCountKey(type, prefixLength, sentence, start, length);
             outBatch[dkey]++;
+
+            // Per-domain counts let the garbage collector delete a domain without reading the storage
+            string domainKey = MakeDomainCountKey(domainType, prefixLength, domain, sentence, start, length);
+            outBatch[domainKey]++;
         }
     }
 }
@@ -249,32 +482,57 @@ size_t SuffixArray::CountOccurrences(bool isSource, const vector <wid_t> &phrase
     if (phrase.size() > prefixLength)
         return 1; // Approximate higher order n-grams to singletons
 
-    int64_t count = 0;
+    string key = MakeCountKey(isSource ? kSourceCountKeyType : kTargetCountKeyType,
+                              prefixLength, phrase, 0, phrase.size());
+    string value;
 
-    if (isSource) {
-        PrefixCursor *cursor = PrefixCursor::NewGlobalCursor(db, prefixLength);
-        for (cursor->Seek(phrase); cursor->HasNext(); cursor->Next())
-            count += cursor->CountValue();
-        delete cursor;
-    } else {
-        string key = MakeCountKey(prefixLength, phrase, 0, phrase.size());
-        string value;
+    db->Get(ReadOptions(), key, &value);
+    int64_t count = DeserializeCount(value.data(), value.size());
+
+    return (size_t) std::max(count, (int64_t) 1);
+}
+
+void SuffixArray::CountOccurrences(bool isSource, const vector <vector<wid_t>> &phrases, vector <size_t> &outCounts) {
+    outCounts.assign(phrases.size(), 1); // Approximate higher order n-grams to singletons
+
+    vector <string> keys;
+    vector <size_t> indexes;
+    keys.reserve(phrases.size());
+    indexes.reserve(phrases.size());
 
-        db->Get(ReadOptions(), key, &value);
-        count = DeserializeCount(value.data(), value.size());
+    for (size_t i = 0; i < phrases.size(); ++i) {
+        const vector <wid_t> &phrase = phrases[i];
+
+        if (phrase.size() <= prefixLength) {
+            keys.push_back(MakeCountKey(isSource ? kSourceCountKeyType : kTargetCountKeyType,
+                                        prefixLength, phrase, 0, phrase.size()));
+            indexes.push_back(i);
+        }
     }
 
-    return (size_t) std::max(count, (int64_t) 1);
+    if (keys.empty())
+        return;
+
+    vector <Slice> slices(keys.begin(), keys.end());
+    vector <string> values;
+    vector <Status> statuses = db->MultiGet(ReadOptions(), slices, &values);
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (statuses[i].ok()) {
+            int64_t count = DeserializeCount(values[i].data(), values[i].size());
+            outCounts[indexes[i]] = (size_t) std::max(count, (int64_t) 1);
+        }
+    }
 }
 
 void SuffixArray::GetRandomSamples(const vector <wid_t> &phrase, size_t limit, vector <sample_t> &outSamples,
                                    const context_t *context, bool searchInBackground) {
-    Collector collector(storage, db, prefixLength, context, searchInBackground);
+    Collector collector(storage, db, prefixLength, &tombstones, context, searchInBackground);
     collector.Extend(phrase, limit, outSamples);
 }
 
 Collector *SuffixArray::NewCollector(const context_t *context, bool searchInBackground) {
-    return new Collector(storage, db, prefixLength, context, searchInBackground);
+    return new Collector(storage, db, prefixLength, &tombstones, context, searchInBackground);
 }
 
 IndexIterator *SuffixArray::NewIterator() const {
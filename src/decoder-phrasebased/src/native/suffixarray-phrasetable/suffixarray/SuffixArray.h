@@ -11,7 +11,9 @@
 #include <mmt/logging/Logger.h>
 #include <unordered_set>
 #include <mutex>
+#include <atomic>
 #include <mmt/sentence.h>
+#include <mmt/DomainTombstones.h>
 #include <suffixarray/storage/CorporaStorage.h>
 #include "UpdateBatch.h"
 #include "PostingList.h"
@@ -50,6 +52,8 @@ namespace mmt {
         };
 
         class SuffixArray {
+            friend class SuffixArrayBulkLoader;
+
         public:
             SuffixArray(const string &path, uint8_t prefixLength, double gcTimeout, size_t gcBatchSize,
                         bool prepareForBulkLoad = false) throw(index_exception, storage_exception);
@@ -63,6 +67,10 @@ namespace mmt {
 
             size_t CountOccurrences(bool isSource, const vector<wid_t> &phrase);
 
+            // Batch version of CountOccurrences(): all counts are retrieved
+            // with a single lookup, outCounts[i] is the count of phrases[i].
+            void CountOccurrences(bool isSource, const vector<vector<wid_t>> &phrases, vector<size_t> &outCounts);
+
             void PutBatch(UpdateBatch &batch) throw(index_exception, storage_exception);
 
             void ForceCompaction() throw(index_exception);
@@ -71,6 +79,13 @@ namespace mmt {
                 return streams;
             }
 
+            // Monotonic version of the index content: it changes every time
+            // an update batch is written or the garbage collector removes
+            // entries from the index.
+            uint64_t GetVersion() const {
+                return version + garbageCollector->GetVersion();
+            }
+
             CorporaStorage *GetStorage() const {
                 return storage;
             }
@@ -83,15 +98,26 @@ namespace mmt {
             const uint8_t prefixLength;
 
             rocksdb::DB *db;
+            rocksdb::CompactionFilter *compactionFilter;
             CorporaStorage *storage;
             vector<seqid_t> streams;
+            atomic<uint64_t> version;
 
+            DomainTombstones tombstones;
             GarbageCollector *garbageCollector;
 
+            void UpgradeIndexFormat() throw(index_exception);
+
+            void AddLegacyDomainsToBatch(rocksdb::WriteBatch &writeBatch) throw(index_exception);
+
+            // Writes the streams and the storage manifest
+            void WriteState() throw(index_exception);
+
             void AddPrefixesToBatch(domain_t domain, const vector<wid_t> &sentence,
                                     int64_t location, unordered_map<string, PostingList> &outBatch);
 
-            void AddTargetCountsToBatch(const vector<wid_t> &sentence, unordered_map<string, int64_t> &outBatch);
+            void AddCountsToBatch(domain_t domain, bool isSource, const vector<wid_t> &sentence,
+                                  unordered_map<string, int64_t> &outBatch);
         };
 
     }
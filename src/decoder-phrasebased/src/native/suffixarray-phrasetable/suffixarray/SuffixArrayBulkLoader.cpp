@@ -0,0 +1,251 @@
+//
+// Created by Davide  Caroselli on 21/06/17.
+//
+
+#include <algorithm>
+#include <exception>
+#include <boost/filesystem.hpp>
+#include <rocksdb/sst_file_writer.h>
+#include <util/chrono.h>
+#include "SuffixArrayBulkLoader.h"
+#include "dbkv.h"
+
+namespace fs = boost::filesystem;
+
+using namespace std;
+using namespace rocksdb;
+using namespace mmt;
+using namespace mmt::sapt;
+
+// Maximum number of runs merged in a single pass
+static const size_t kMaxMergeWidth = 64;
+// SST files are closed when they reach this size
+static const uint64_t kMaxTableFileSize = 256ULL * 1024ULL * 1024ULL;
+
+// Same semantic of the MergePositionOperator of the index
+static void MergeValues(const string &key, string &existing, const string &value) {
+    switch (key[0]) {
+        case kSourcePrefixKeyType:
+            // Posting list blocks are self-delimiting, concatenation is a valid merge
+            existing.append(value);
+            break;
+        case kSourceCountKeyType:
+        case kTargetCountKeyType:
+        case kDomainSourceCountKeyType:
+        case kDomainTargetCountKeyType:
+            existing = SerializeCount(DeserializeCount(existing.data(), existing.size()) +
+                                      DeserializeCount(value.data(), value.size()));
+            break;
+        default:
+            existing = value;
+            break;
+    }
+}
+
+/* Shard */
+
+SuffixArrayBulkLoader::Shard::Shard(SuffixArrayBulkLoader *loader, size_t bufferSize)
+        : loader(loader), bufferSize(bufferSize), size(0) {
+}
+
+void SuffixArrayBulkLoader::Shard::Add(domain_t domain, const vector<wid_t> &source, const vector<wid_t> &target,
+                                       const alignment_t &alignment) throw(storage_exception) {
+    SuffixArray *index = loader->index;
+
+    int64_t offset = index->storage->Append(domain, source, target, alignment);
+    index->AddPrefixesToBatch(domain, source, offset, prefixes);
+    index->AddCountsToBatch(domain, true, source, counts);
+    index->AddCountsToBatch(domain, false, target, counts);
+
+    if (++size >= bufferSize)
+        Flush();
+}
+
+void SuffixArrayBulkLoader::Shard::Flush() {
+    if (size == 0)
+        return;
+
+    vector<pair<string, string>> entries;
+    entries.reserve(prefixes.size() + counts.size());
+
+    for (auto prefix = prefixes.begin(); prefix != prefixes.end(); ++prefix)
+        entries.push_back(make_pair(prefix->first, prefix->second.Serialize()));
+    for (auto count = counts.begin(); count != counts.end(); ++count)
+        entries.push_back(make_pair(count->first, SerializeCount(count->second)));
+
+    prefixes.clear();
+    counts.clear();
+    size = 0;
+
+    sort(entries.begin(), entries.end(), [](const pair<string, string> &a, const pair<string, string> &b) {
+        return a.first < b.first;
+    });
+
+    string path = loader->NewTempFile("prefixes");
+    SortedRunWriter writer(path);
+
+    for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+        writer.Append(entry->first, entry->second);
+
+    writer.Close();
+
+    loader->AddRun(path);
+}
+
+/* SuffixArrayBulkLoader */
+
+SuffixArrayBulkLoader::SuffixArrayBulkLoader(SuffixArray *index, const string &tempPath,
+                                             size_t bufferSize) throw(index_exception)
+        : logger("sapt.SuffixArrayBulkLoader"), index(index), tempPath(tempPath), bufferSize(bufferSize),
+          fileCount(0) {
+    // Ingested files replace existing values, the index must not contain any prefix or count
+    bool empty = true;
+
+    Iterator *it = index->db->NewIterator(ReadOptions());
+    for (it->SeekToFirst(); it->Valid() && empty; it->Next()) {
+        switch (it->key().data()[0]) {
+            case kStreamsKeyType:
+            case kStorageManifestKeyType:
+            case kIndexFormatKeyType:
+                break;
+            default:
+                empty = false;
+                break;
+        }
+    }
+    delete it;
+
+    if (!empty)
+        throw index_exception("Bulk load requires an empty index");
+
+    fs::create_directories(tempPath);
+}
+
+SuffixArrayBulkLoader::~SuffixArrayBulkLoader() {
+    boost::system::error_code error;
+    fs::remove_all(tempPath, error);
+}
+
+SuffixArrayBulkLoader::Shard *SuffixArrayBulkLoader::NewShard() {
+    return new Shard(this, bufferSize);
+}
+
+string SuffixArrayBulkLoader::NewTempFile(const string &prefix) {
+    lock_guard<mutex> lock(runsAccess);
+    return (fs::path(tempPath) / fs::path(prefix + "." + to_string(fileCount++))).string();
+}
+
+void SuffixArrayBulkLoader::AddRun(const string &path) {
+    lock_guard<mutex> lock(runsAccess);
+    runs.push_back(path);
+}
+
+void SuffixArrayBulkLoader::ReduceRuns(vector<string> &runs) {
+    while (runs.size() > kMaxMergeWidth) {
+        size_t groups = (runs.size() + kMaxMergeWidth - 1) / kMaxMergeWidth;
+        vector<string> reduced(groups);
+        exception_ptr error;
+
+#pragma omp parallel for schedule(dynamic)
+        for (size_t g = 0; g < groups; ++g) {
+            auto begin = runs.begin() + g * kMaxMergeWidth;
+            auto end = runs.begin() + min((g + 1) * kMaxMergeWidth, runs.size());
+
+            vector<string> group(begin, end);
+            reduced[g] = NewTempFile("merge");
+
+            try {
+                SortedRunMerger merger(group, MergeValues);
+                SortedRunWriter writer(reduced[g]);
+
+                string key, value;
+                while (merger.Next(&key, &value))
+                    writer.Append(key, value);
+
+                writer.Close();
+
+                for (auto run = group.begin(); run != group.end(); ++run)
+                    fs::remove(*run);
+            } catch (...) {
+#pragma omp critical(sapt_bulk_error)
+                if (!error)
+                    error = current_exception();
+            }
+        }
+
+        // exceptions can not escape the parallel region
+        if (error)
+            rethrow_exception(error);
+
+        runs.swap(reduced);
+    }
+}
+
+void SuffixArrayBulkLoader::WriteTables(const vector<string> &runs, vector<string> &outTables) throw(index_exception) {
+    SstFileWriter *writer = NULL;
+    Status status;
+
+    SortedRunMerger merger(runs, MergeValues);
+
+    string key, value;
+    while (merger.Next(&key, &value)) {
+        if (writer == NULL) {
+            outTables.push_back(NewTempFile("table") + ".sst");
+
+            writer = new SstFileWriter(EnvOptions(), index->db->GetOptions());
+            status = writer->Open(outTables.back());
+        }
+
+        if (status.ok())
+            status = writer->Put(key, value);
+
+        if (status.ok() && writer->FileSize() >= kMaxTableFileSize) {
+            status = writer->Finish();
+
+            delete writer;
+            writer = NULL;
+        }
+
+        if (!status.ok()) {
+            delete writer;
+            throw index_exception("Unable to write table: " + status.ToString());
+        }
+    }
+
+    if (writer) {
+        status = writer->Finish();
+        delete writer;
+
+        if (!status.ok())
+            throw index_exception("Unable to write table: " + status.ToString());
+    }
+}
+
+void SuffixArrayBulkLoader::Load() throw(index_exception, storage_exception) {
+    double beginTime = GetTime();
+    LogInfo(logger) << "Merging " << runs.size() << " runs";
+
+    ReduceRuns(runs);
+
+    vector<string> tables;
+    WriteTables(runs, tables);
+
+    for (auto run = runs.begin(); run != runs.end(); ++run)
+        fs::remove(*run);
+    runs.clear();
+
+    LogInfo(logger) << "Ingesting " << tables.size() << " tables, prepared in " << GetElapsedTime(beginTime) << "s";
+
+    if (!tables.empty()) {
+        IngestExternalFileOptions options;
+        options.move_files = true;
+
+        Status status = index->db->IngestExternalFile(tables, options);
+        if (!status.ok())
+            throw index_exception("Unable to ingest tables: " + status.ToString());
+    }
+
+    index->WriteState();
+
+    LogInfo(logger) << "Bulk load completed in " << GetElapsedTime(beginTime) << "s";
+}
@@ -0,0 +1,89 @@
+//
+// Created by Davide  Caroselli on 21/06/17.
+//
+
+#ifndef SAPT_SUFFIXARRAYBULKLOADER_H
+#define SAPT_SUFFIXARRAYBULKLOADER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <mmt/sentence.h>
+#include <mmt/logging/Logger.h>
+#include <mmt/io/SortedRun.h>
+#include "SuffixArray.h"
+#include "PostingList.h"
+#include "index_exception.h"
+
+using namespace std;
+
+namespace mmt {
+    namespace sapt {
+
+        // Builds a new index from large corpora without passing through the write path:
+        // prefixes and counts are collected in memory by independent shards (one per thread)
+        // and spilled to disk as sorted runs; the runs are then merged and written as sorted,
+        // fully merged SST files that are ingested in the index. No compaction is needed after the load.
+        class SuffixArrayBulkLoader {
+        public:
+
+            class Shard {
+                friend class SuffixArrayBulkLoader;
+
+            public:
+                void Add(domain_t domain, const vector<wid_t> &source, const vector<wid_t> &target,
+                         const alignment_t &alignment) throw(storage_exception);
+
+                // Writes the buffered prefixes and counts to a new sorted run: it must be
+                // called before deleting the shard, that does not flush its data by itself
+                void Flush();
+
+            private:
+                SuffixArrayBulkLoader *loader;
+                const size_t bufferSize;
+
+                size_t size;
+                unordered_map<string, PostingList> prefixes;
+                unordered_map<string, int64_t> counts;
+
+                Shard(SuffixArrayBulkLoader *loader, size_t bufferSize);
+            };
+
+            // "bufferSize" is the number of sentence pairs buffered by every shard
+            SuffixArrayBulkLoader(SuffixArray *index, const string &tempPath,
+                                  size_t bufferSize) throw(index_exception);
+
+            ~SuffixArrayBulkLoader();
+
+            // Shards are independent, every thread must use its own
+            Shard *NewShard();
+
+            // Merges the runs of all the shards, ingests the result in the index (that must
+            // be empty) and writes the storage manifest; all the shards must have been flushed before.
+            void Load() throw(index_exception, storage_exception);
+
+        private:
+            const logging::Logger logger;
+            SuffixArray *index;
+            const string tempPath;
+            const size_t bufferSize;
+
+            mutex runsAccess;
+            vector<string> runs;
+            size_t fileCount;
+
+            string NewTempFile(const string &prefix);
+
+            void AddRun(const string &path);
+
+            // Merges groups of runs in parallel until they can be merged in a single pass
+            void ReduceRuns(vector<string> &runs);
+
+            void WriteTables(const vector<string> &runs, vector<string> &outTables) throw(index_exception);
+        };
+
+    }
+}
+
+#endif //SAPT_SUFFIXARRAYBULKLOADER_H
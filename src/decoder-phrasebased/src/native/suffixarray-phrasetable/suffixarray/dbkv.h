@@ -6,6 +6,7 @@
 #define SAPT_DBKV_H
 
 #include <string>
+#include <limits>
 #include <util/ioutils.h>
 #include <mmt/sentence.h>
 #include "SuffixArray.h"
@@ -27,6 +28,14 @@ namespace mmt {
 
             kSourcePrefixKeyType = 4,
             kTargetCountKeyType = 5,
+
+            kIndexFormatKeyType = 6,
+
+            kSourceCountKeyType = 7,
+
+            kDomainSourceCountKeyType = 8,
+            kDomainTargetCountKeyType = 9,
+            kLegacyDomainKeyType = 10,
         };
 
         /* Keys */
@@ -61,10 +70,10 @@ namespace mmt {
         }
 
         static inline string
-        MakeCountKey(length_t prefixLength, const vector<wid_t> &phrase, size_t offset, size_t length) {
+        MakeCountKey(KeyType type, length_t prefixLength, const vector<wid_t> &phrase, size_t offset, size_t length) {
             size_t size = 1 + sizeof(domain_t) + prefixLength * sizeof(wid_t);
             char *bytes = new char[size];
-            bytes[0] = kTargetCountKeyType;
+            bytes[0] = type;
 
             size_t ptr = 1;
 
@@ -91,6 +100,72 @@ namespace mmt {
             return string(bytes, 5);
         }
 
+        // Per-domain counts start with the domain (big-endian), so that all the
+        // counts of a domain are a contiguous range of keys
+        static inline void WriteDomainCountKeyPrefix(char *bytes, KeyType type, domain_t domain) {
+            bytes[0] = type;
+            bytes[1] = (char) ((domain >> 24) & 0xFF);
+            bytes[2] = (char) ((domain >> 16) & 0xFF);
+            bytes[3] = (char) ((domain >> 8) & 0xFF);
+            bytes[4] = (char) (domain & 0xFF);
+        }
+
+        static inline string
+        MakeDomainCountKey(KeyType type, length_t prefixLength, domain_t domain,
+                           const vector<wid_t> &phrase, size_t offset, size_t length) {
+            size_t size = 1 + sizeof(domain_t) + prefixLength * sizeof(wid_t);
+            char *bytes = new char[size];
+            WriteDomainCountKeyPrefix(bytes, type, domain);
+
+            size_t ptr = 1 + sizeof(domain_t);
+
+            for (size_t i = 0; i < length; ++i)
+                WriteUInt32(bytes, &ptr, phrase[offset + i]);
+            for (size_t i = length; i < prefixLength; ++i)
+                WriteUInt32(bytes, &ptr, 0);
+
+            string key(bytes, size);
+            delete[] bytes;
+
+            return key;
+        }
+
+        // Bounds of the range [begin, end) of the per-domain count keys of a domain
+        static inline string MakeDomainCountRangeBegin(KeyType type, domain_t domain) {
+            char bytes[5];
+            WriteDomainCountKeyPrefix(bytes, type, domain);
+
+            return string(bytes, 5);
+        }
+
+        static inline string MakeDomainCountRangeEnd(KeyType type, domain_t domain) {
+            if (domain == numeric_limits<domain_t>::max())
+                return MakeEmptyKey((char) (type + 1));
+
+            return MakeDomainCountRangeBegin(type, domain + 1);
+        }
+
+        // Converts a per-domain count key to the global count key of the same phrase
+        static inline string MakeCountKeyFromDomainCountKey(KeyType type, length_t prefixLength, const char *data) {
+            size_t size = 1 + sizeof(domain_t) + prefixLength * sizeof(wid_t);
+
+            string key(size, '\0');
+            key[0] = type;
+            key.replace(1, prefixLength * sizeof(wid_t), data + 1 + sizeof(domain_t), prefixLength * sizeof(wid_t));
+
+            return key;
+        }
+
+        static inline string MakeLegacyDomainKey(domain_t domain) {
+            char bytes[5];
+            bytes[0] = kLegacyDomainKeyType;
+
+            size_t ptr = 1;
+            WriteUInt32(bytes, &ptr, domain);
+
+            return string(bytes, 5);
+        }
+
         static inline KeyType GetKeyTypeFromKey(const char *data, length_t prefixLength) {
             return (KeyType) data[0];
         }
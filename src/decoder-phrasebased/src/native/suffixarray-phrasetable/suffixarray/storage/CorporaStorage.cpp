@@ -56,6 +56,16 @@ bool CorporaStorage::Retrieve(domain_t domain, int64_t offset, std::vector<wid_t
     return bucket->Retrieve(offset, outSourceSentence, outTargetSentence, outAlignment) >= 0;
 }
 
+void CorporaStorage::RetrieveMany(domain_t domain, const std::vector<int64_t> &offsets,
+                                  const std::vector<sample_t *> &outSamples, std::vector<bool> &outRetrieved) {
+    std::shared_ptr<StorageBucket> bucket = GetBucket(domain);
+
+    if (bucket == nullptr)
+        outRetrieved.assign(offsets.size(), false);
+    else
+        bucket->RetrieveMany(offsets, outSamples, outRetrieved);
+}
+
 int64_t CorporaStorage::Append(domain_t domain, const std::vector<wid_t> &sourceSentence,
                                const std::vector<wid_t> &targetSentence,
                                const alignment_t &alignment) throw(storage_exception) {
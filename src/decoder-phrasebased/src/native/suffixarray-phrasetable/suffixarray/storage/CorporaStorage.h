@@ -30,6 +30,12 @@ namespace mmt {
                           std::vector<wid_t> *outSourceSentence, std::vector<wid_t> *outTargetSentence,
                           alignment_t *outAlignment);
 
+            // Batch version of Retrieve(): the bucket of the domain is resolved once and
+            // all the sentence pairs are decoded in a single pass. Offsets must be sorted
+            // in increasing order, outRetrieved[i] tells whether outSamples[i] has been filled.
+            void RetrieveMany(domain_t domain, const std::vector<int64_t> &offsets,
+                              const std::vector<sample_t *> &outSamples, std::vector<bool> &outRetrieved);
+
             int64_t Append(domain_t domain, const std::vector<wid_t> &sourceSentence,
                            const std::vector<wid_t> &targetSentence,
                            const alignment_t &alignment) throw(storage_exception);
@@ -36,17 +36,26 @@ static inline void WriteAlignment(char *data, size_t *ptr, const mmt::alignment_
 }
 
 static inline bool ReadSentence(const char *data, size_t data_length, size_t *ptr, vector<mmt::wid_t> *outSentence) {
+    // Find the sentence length first, so that the output is resized only once
+    size_t end = *ptr;
     bool endSymbolFound = false;
 
-    while (!endSymbolFound && (*ptr + 4 <= data_length)) {
-        mmt::wid_t word = ReadUInt32(data, ptr);
-
-        if (word == kEndOfSentenceSymbol)
+    while (!endSymbolFound && (end + 4 <= data_length)) {
+        if (ReadUInt32(data, end) == kEndOfSentenceSymbol)
             endSymbolFound = true;
         else
-            outSentence->push_back(word);
+            end += 4;
     }
 
+    size_t size = outSentence->size();
+    outSentence->resize(size + (end - *ptr) / 4);
+
+    for (size_t i = size; i < outSentence->size(); ++i)
+        (*outSentence)[i] = ReadUInt32(data, ptr);
+
+    if (endSymbolFound)
+        *ptr += 4;
+
     return endSymbolFound;
 }
 
@@ -112,6 +121,55 @@ int64_t StorageBucket::Retrieve(int64_t offset, std::vector<wid_t> *outSourceSen
     return ReadAlignment(data, dataLength, &ptr, outAlignment) ? (int64_t) ptr : -1;
 }
 
+void StorageBucket::RetrieveMany(const std::vector<int64_t> &offsets, const std::vector<sample_t *> &outSamples,
+                                 std::vector<bool> &outRetrieved) const {
+    outRetrieved.assign(offsets.size(), false);
+
+    if (data == NULL)
+        return;
+
+    // Hint the kernel about all the pages of the batch before decoding: on cold buckets
+    // pages are read ahead together instead of faulting one at a time. Offsets are
+    // sorted, so that contiguous pages are merged into a single range.
+    static const size_t kPageSize = (size_t) sysconf(_SC_PAGESIZE);
+
+    size_t rangeBegin = 0;
+    size_t rangeEnd = 0;
+
+    for (auto offset = offsets.begin(); offset != offsets.end(); ++offset) {
+        if (*offset < 0 || (size_t) *offset >= dataLength)
+            continue;
+
+        size_t begin = ((size_t) *offset) & ~(kPageSize - 1);
+        size_t end = min((size_t) *offset + kPageSize, dataLength);
+
+        if (rangeEnd > rangeBegin && begin <= rangeEnd) {
+            rangeEnd = max(rangeEnd, end);
+        } else {
+            if (rangeEnd > rangeBegin)
+                madvise(data + rangeBegin, rangeEnd - rangeBegin, MADV_WILLNEED);
+
+            rangeBegin = begin;
+            rangeEnd = end;
+        }
+    }
+
+    if (rangeEnd > rangeBegin)
+        madvise(data + rangeBegin, rangeEnd - rangeBegin, MADV_WILLNEED);
+
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        if (i + 1 < offsets.size() && offsets[i + 1] >= 0 && (size_t) offsets[i + 1] < dataLength)
+            __builtin_prefetch(data + offsets[i + 1]);
+
+        sample_t *sample = outSamples[i];
+        sample->source.clear();
+        sample->target.clear();
+        sample->alignment.clear();
+
+        outRetrieved[i] = Retrieve(offsets[i], &sample->source, &sample->target, &sample->alignment) >= 0;
+    }
+}
+
 int64_t StorageBucket::Append(const std::vector<wid_t> &sourceSentence, const std::vector<wid_t> &targetSentence,
                               const alignment_t &alignment) throw(storage_exception) {
     size_t size = SentenceLengthInBytes(sourceSentence) + SentenceLengthInBytes(targetSentence) +
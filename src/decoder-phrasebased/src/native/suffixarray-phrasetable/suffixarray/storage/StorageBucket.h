@@ -9,6 +9,7 @@
 #include <mutex>
 #include <mmt/sentence.h>
 #include <util/ioutils.h>
+#include <suffixarray/sample.h>
 #include "storage_exception.h"
 
 namespace mmt {
@@ -37,6 +38,11 @@ namespace mmt {
             int64_t Retrieve(int64_t offset, std::vector<wid_t> *outSourceSentence,
                              std::vector<wid_t> *outTargetSentence, alignment_t *outAlignment) const;
 
+            // Offsets must be sorted in increasing order: outSamples[i] is filled with the
+            // sentence pair at offsets[i], outRetrieved[i] is false if the offset is not valid.
+            void RetrieveMany(const std::vector<int64_t> &offsets, const std::vector<sample_t *> &outSamples,
+                              std::vector<bool> &outRetrieved) const;
+
             int64_t Append(const std::vector<wid_t> &sourceSentence, const std::vector<wid_t> &targetSentence,
                            const alignment_t &alignment) throw(storage_exception);
 
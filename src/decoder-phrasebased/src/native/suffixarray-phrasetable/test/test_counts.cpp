@@ -90,6 +90,9 @@ NGramTable LoadTable(const args_t &args) {
 // ------ Testing
 
 bool RunTest(bool isSource, SuffixArray &index, const unordered_map<vector<wid_t>, size_t, phrase_hash> &ngrams) {
+    vector<vector<wid_t>> phrases;
+    vector<size_t> expectedCounts;
+
     for (auto entry = ngrams.begin(); entry != ngrams.end(); ++entry) {
         const vector<wid_t> &phrase = entry->first;
         size_t expectedCount = entry->second;
@@ -100,6 +103,19 @@ bool RunTest(bool isSource, SuffixArray &index, const unordered_map<vector<wid_t
             cout << "CountSamples::FAILED (expected = " << expectedCount << " but found " << count << ")" << endl;
             return false;
         }
+
+        phrases.push_back(phrase);
+        expectedCounts.push_back(expectedCount);
+    }
+
+    vector<size_t> counts;
+    index.CountOccurrences(isSource, phrases, counts);
+
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != expectedCounts[i]) {
+            cout << "CountSamples::FAILED on batch (expected = " << expectedCounts[i] << " but found " << counts[i] << ")" << endl;
+            return false;
+        }
     }
 
     cout << "SUCCESS" << endl;
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <cmath>
+#include <set>
+
+#include <mmt/sentence.h>
+#include <suffixarray/PostingList.h>
+#include <suffixarray/PrefixCursor.h>
+#include <boost/program_options.hpp>
+
+using namespace std;
+using namespace mmt;
+using namespace mmt::sapt;
+
+namespace {
+    const size_t ERROR_IN_COMMAND_LINE = 1;
+    const size_t GENERIC_ERROR = 2;
+    const size_t TEST_FAILED = 3;
+    const size_t SUCCESS = 0;
+
+    struct args_t {
+        size_t iterations = 5000;
+        size_t limit = 100;
+    };
+
+    // Maximum deviation (in standard deviations) allowed for the inclusion frequency of a location
+    const double kMaxDeviation = 6.;
+} // namespace
+
+namespace po = boost::program_options;
+
+bool ParseArgs(int argc, const char *argv[], args_t *args) {
+    po::options_description desc("Test the statistical equivalence of early-termination sampling");
+    desc.add_options()
+            ("help,h", "print this help message")
+            ("iterations,n", po::value<size_t>(), "number of sampled sets (default = 5000)")
+            ("limit,l", po::value<size_t>(), "sample size (default = 100)");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            return false;
+        }
+
+        po::notify(vm);
+
+        if (vm.count("iterations"))
+            args->iterations = vm["iterations"].as<size_t>();
+        if (vm.count("limit"))
+            args->limit = vm["limit"].as<size_t>();
+    } catch (po::error &e) {
+        std::cerr << "ERROR: " << e.what() << std::endl << std::endl;
+        std::cerr << desc << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Cursor over in-memory posting lists, it returns the same
+// values of a GlobalCursor without requiring an index
+class MemoryCursor : public PrefixCursor {
+public:
+    MemoryCursor(const vector<pair<domain_t, string>> &values) : values(values), index(0) {}
+
+    virtual void Seek(const vector<wid_t> &phrase, size_t offset, size_t length) override {
+        index = 0;
+    }
+
+    virtual bool HasNext() override {
+        return index < values.size();
+    }
+
+    virtual void Next() override {
+        index++;
+    }
+
+    virtual void CollectValue(PostingList *output) override {
+        output->Append(values[index].first, values[index].second);
+    }
+
+    virtual size_t CountValue() override {
+        return PostingList::Count(values[index].second.data(), values[index].second.size());
+    }
+
+    virtual rocksdb::Slice GetValue(domain_t *outDomain) override {
+        *outDomain = values[index].first;
+        return rocksdb::Slice(values[index].second);
+    }
+
+private:
+    const vector<pair<domain_t, string>> &values;
+    size_t index;
+};
+
+// ------ Testing
+
+bool CheckFrequencies(const char *name, const vector<size_t> &frequencies, size_t iterations, size_t limit) {
+    double p = ((double) limit) / frequencies.size();
+    double expected = iterations * p;
+    double sigma = sqrt(iterations * p * (1. - p));
+
+    for (size_t i = 0; i < frequencies.size(); ++i) {
+        double deviation = fabs(frequencies[i] - expected) / sigma;
+
+        if (deviation > kMaxDeviation) {
+            cout << name << "::FAILED (location " << i << " sampled " << frequencies[i] << " times, expected "
+                 << expected << ")" << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool RunTest(const args_t &args) {
+    const domain_t domains[] = {3, 1, 7, 2};
+    const size_t sizes[] = {40, 300, 1, 500};
+
+    // Locations are identified by their index in the reference list, that is sorted by domain
+    map<pair<domain_t, int64_t>, size_t> ids;
+    vector<pair<domain_t, string>> values;
+    PostingList reference;
+
+    for (size_t d = 0; d < 4; ++d) {
+        PostingList list;
+        for (size_t i = 0; i < sizes[d]; ++i) {
+            list.Append(domains[d], (int64_t) (i * 10), (length_t) (i % 3));
+            reference.Append(domains[d], (int64_t) (i * 10), (length_t) (i % 3));
+        }
+
+        values.push_back(pair<domain_t, string>(domains[d], list.Serialize()));
+    }
+
+    size_t total = reference.size();
+
+    vector<location_t> all;
+    reference.GetLocations(all);
+    for (size_t i = 0; i < all.size(); ++i)
+        ids[make_pair(all[i].domain, all[i].pointer)] = i;
+
+    MemoryCursor cursor(values);
+    vector<wid_t> phrase;
+
+    // Full collection
+    vector<location_t> collected;
+    if (cursor.SampleLocations(phrase, 0, 0, 0, 0, collected) != total || collected.size() != total) {
+        cout << "SampleLocations::FAILED (expected all the " << total << " locations)" << endl;
+        return false;
+    }
+
+    // Sampling
+    vector<size_t> referenceFrequencies(total, 0);
+    vector<size_t> samplingFrequencies(total, 0);
+
+    for (unsigned int seed = 1; seed <= args.iterations; ++seed) {
+        vector<location_t> expected;
+        reference.GetLocations(expected, args.limit, seed);
+
+        vector<location_t> sampled;
+        size_t count = cursor.SampleLocations(phrase, 0, 0, args.limit, seed, sampled);
+
+        if (count != total) {
+            cout << "SampleLocations::FAILED (expected count = " << total << " but found " << count << ")" << endl;
+            return false;
+        }
+
+        if (sampled.size() != expected.size()) {
+            cout << "SampleLocations::FAILED (expected " << expected.size() << " samples but found "
+                 << sampled.size() << ")" << endl;
+            return false;
+        }
+
+        set<size_t> distinct;
+        for (auto location = sampled.begin(); location != sampled.end(); ++location) {
+            auto id = ids.find(make_pair(location->domain, location->pointer));
+            if (id == ids.end()) {
+                cout << "SampleLocations::FAILED (unknown location " << location->pointer << ")" << endl;
+                return false;
+            }
+
+            distinct.insert(id->second);
+            samplingFrequencies[id->second]++;
+        }
+
+        if (distinct.size() != sampled.size()) {
+            cout << "SampleLocations::FAILED (duplicated samples)" << endl;
+            return false;
+        }
+
+        for (auto location = expected.begin(); location != expected.end(); ++location)
+            referenceFrequencies[ids[make_pair(location->domain, location->pointer)]]++;
+    }
+
+    if (!CheckFrequencies("PostingList::GetLocations", referenceFrequencies, args.iterations, args.limit))
+        return false;
+    if (!CheckFrequencies("SampleLocations", samplingFrequencies, args.iterations, args.limit))
+        return false;
+
+    cout << "SUCCESS" << endl;
+
+    return true;
+}
+
+// --------------
+
+int main(int argc, const char *argv[]) {
+    args_t args;
+
+    if (!ParseArgs(argc, argv, &args))
+        return ERROR_IN_COMMAND_LINE;
+
+    if (args.limit == 0 || args.iterations == 0) {
+        cerr << "ERROR: limit and iterations must be greater than zero" << endl;
+        return GENERIC_ERROR;
+    }
+
+    if (!RunTest(args))
+        return TEST_FAILED;
+
+    return SUCCESS;
+}
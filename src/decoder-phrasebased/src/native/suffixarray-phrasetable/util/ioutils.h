@@ -14,6 +14,11 @@ static inline void WriteUInt16(char *buffer, size_t *ptr, uint16_t value) {
     *ptr = *ptr + 2;
 }
 
+static inline void WriteUInt16(char *buffer, size_t i, uint16_t value) {
+    buffer[i] = (char) (value & 0xFF);
+    buffer[i + 1] = (char) ((value >> 8) & 0xFF);
+}
+
 static inline void WriteUInt32(char *buffer, size_t *ptr, uint32_t value) {
     buffer[*ptr] = (char) (value & 0xFF);
     buffer[*ptr + 1] = (char) ((value >> 8) & 0xFF);
@@ -115,4 +120,34 @@ static inline int64_t ReadInt64(const char *data, size_t i) {
     return ReadUInt64(data, i);
 }
 
+// Variable byte encoding
+
+static inline size_t VBEWriteUInt64(char *buffer, size_t *ptr, uint64_t value) {
+    size_t i;
+    for (i = 0; i < 10; ++i) {
+        buffer[(*ptr)++] = (char) (value & 0b1111111);
+        value = value >> 7;
+
+        if (value == 0)
+            break;
+    }
+
+    buffer[*ptr - 1] |= 0b10000000;
+    return i + 1;
+}
+
+static inline uint64_t VBEReadUInt64(const char *buffer, size_t *ptr) {
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < 10; ++i) {
+        char byte = buffer[(*ptr)++];
+        result |= ((uint64_t) (byte & 0b1111111)) << (i * 7);
+
+        if (byte & 0b10000000)
+            break;
+    }
+
+    return result;
+}
+
 #endif //SAPT_IOUTILS_H
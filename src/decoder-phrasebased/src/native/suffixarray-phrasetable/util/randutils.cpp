@@ -32,6 +32,7 @@ void GenerateRandomSequence(size_t size, size_t limit, unsigned int seed, vector
                 index = rand_generator();
             } while (coveredPositions.find(index) != coveredPositions.end());
 
+            coveredPositions.insert(index);
             outSequence[i] = (size_t) index;
         }
     } else {